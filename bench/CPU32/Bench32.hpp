@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+#include <CPU32/CPU32.hpp>
+#include <cstdint>
+
+#ifndef CPUSIMULATOR_BENCH32_HPP
+#define CPUSIMULATOR_BENCH32_HPP
+
+// Benchmarks taking a dispatch mode use its integer value as their first argument
+inline CPU32::DispatchMode benchMode(const benchmark::State& state) {
+    return static_cast<CPU32::DispatchMode>(state.range(0));
+}
+
+inline const char* benchModeName(CPU32::DispatchMode mode) {
+    switch (mode) {
+        case CPU32::DispatchMode::Map: return "Map";
+        case CPU32::DispatchMode::Table: return "Table";
+        case CPU32::DispatchMode::Threaded: return "Threaded";
+        case CPU32::DispatchMode::Blocks: return "Blocks";
+        case CPU32::DispatchMode::JIT: return "JIT";
+    }
+    return "?";
+}
+
+// Reports guest instructions retired as items/s and as a guest_MIPS counter
+inline void reportGuestInstructions(benchmark::State& state, uint64_t instructions) {
+    state.SetItemsProcessed(static_cast<int64_t>(instructions));
+    state.counters["guest_MIPS"] = benchmark::Counter(static_cast<double>(instructions) / 1e6,
+                                                      benchmark::Counter::kIsRate);
+    state.SetLabel(benchModeName(benchMode(state)));
+}
+
+// Every dispatch mode, as benchmark arguments
+#define CPU32_BENCH_MODES DenseRange(static_cast<int>(CPU32::DispatchMode::Map), static_cast<int>(CPU32::DispatchMode::JIT))
+
+#endif //CPUSIMULATOR_BENCH32_HPP
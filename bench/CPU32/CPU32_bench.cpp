@@ -0,0 +1,251 @@
+#include "Bench32.hpp"
+#include <CPU32/Batch32.hpp>
+#include <CPU32/Cluster32.hpp>
+#include <CPU32/LockstepCPU32.hpp>
+#include <CPU32/Scheduler32.hpp>
+#include <vector>
+
+// Instructions retired per benchmark iteration
+static constexpr uint64_t SLICE = 1 << 16;
+
+// Runs `body` followed by a jump back to 0 in SLICE-instruction bounded runs
+static void runLoop(benchmark::State& state, const std::vector<uint32_t>& body,
+                    CPU32::DispatchMode mode, void (*setup)(CPU32&) = nullptr) {
+    std::vector<uint32_t> program = body;
+    program.push_back(0x12000000); // JMP 0
+
+    CPU32 cpu(4096);
+    cpu.SetDispatchMode(mode);
+    cpu.loadProgram(program, 0);
+    if (setup) {
+        setup(cpu);
+    }
+    uint64_t instructions = 0;
+    for (auto _ : state) {
+        RunResult32 result = cpu.run(SLICE);
+        instructions += result.instructions;
+        if (result.reason != StopReason32::BudgetExhausted) {
+            state.SkipWithError("guest program stopped early");
+            break;
+        }
+    }
+    reportGuestInstructions(state, instructions);
+}
+
+// Opcode dispatch alone: a long run of NOPs
+static void BM_Dispatch(benchmark::State& state) {
+    runLoop(state, std::vector<uint32_t>(63, 0x00000000), benchMode(state));
+}
+BENCHMARK(BM_Dispatch)->CPU32_BENCH_MODES;
+
+// One ALU handler repeated; the second argument is the opcode
+static void BM_ALU(benchmark::State& state) {
+    uint32_t opcode = static_cast<uint32_t>(state.range(1));
+    uint32_t instruction = opcode == 0x0A ? 0x0A010000 : (opcode << 24) | 0x010200; // op R1, R2
+    runLoop(state, std::vector<uint32_t>(63, instruction), benchMode(state), [](CPU32& cpu) {
+        cpu.GetRegisters()[1]->loadValue(0x12345678);
+        cpu.GetRegisters()[2]->loadValue(0x9ABCDEF1);
+    });
+}
+BENCHMARK(BM_ALU)->ArgsProduct({{static_cast<int>(CPU32::DispatchMode::Table),
+                                 static_cast<int>(CPU32::DispatchMode::Blocks),
+                                 static_cast<int>(CPU32::DispatchMode::JIT)},
+                                {0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x11, 0x20, 0x23, 0x27, 0x2C}});
+
+// PUSH/POP pairs
+static void BM_PushPop(benchmark::State& state) {
+    runLoop(state, {0x32010000, 0x33020000, 0x32030000, 0x33040000}, benchMode(state));
+}
+BENCHMARK(BM_PushPop)->CPU32_BENCH_MODES;
+
+// CALL into a function that returns immediately
+static void BM_CallRet(benchmark::State& state) {
+    std::vector<uint32_t> program = {
+            0x30000003, // 0: CALL 3
+            0x12000000, // 1: JMP 0
+            0x00000000, // 2: NOP
+            0x31000000  // 3: RET
+    };
+    CPU32 cpu(4096);
+    cpu.SetDispatchMode(benchMode(state));
+    cpu.loadProgram(program, 0);
+    uint64_t instructions = 0;
+    for (auto _ : state) {
+        instructions += cpu.run(SLICE).instructions;
+    }
+    reportGuestInstructions(state, instructions);
+}
+BENCHMARK(BM_CallRet)->CPU32_BENCH_MODES;
+
+// Memory round trips through LOAD and STORE on a data page
+static void BM_LoadStore(benchmark::State& state) {
+    runLoop(state, {0x03030100, 0x04030200, 0x03040200, 0x04040100}, benchMode(state), [](CPU32& cpu) {
+        cpu.GetRegisters()[1]->loadValue(2048); // LOAD R3, [R1]; STORE R3, [R2]; ...
+        cpu.GetRegisters()[2]->loadValue(3072);
+    });
+}
+BENCHMARK(BM_LoadStore)->CPU32_BENCH_MODES;
+
+// Adds two 4-word arrays into a third, with range(1) = 0 four scalar LOAD/ADD/STORE
+// rounds and range(1) = 1 one VLOAD/VADD/VSTORE round; words_per_second compares them
+static void BM_ArrayAdd(benchmark::State& state) {
+    std::vector<uint32_t> program = {
+            0x02010800, // MOV R1, 0x800
+            0x02020804, // MOV R2, 0x804
+            0x02030808  // MOV R3, 0x808
+    };
+    if (state.range(1)) {
+        program.insert(program.end(), {0x80010100, 0x80020200, 0x82010200, 0x81010300});
+    } else {
+        for (int word = 0; word < 4; ++word) {
+            program.insert(program.end(), {0x03040100, 0x03050200, 0x05040500, 0x04040300,
+                                           0xE5010001, 0xE5020001, 0xE5030001});
+        }
+    }
+    program.push_back(0x12000000); // JMP 0
+    uint64_t perRound = program.size();
+
+    CPU32 cpu(4096);
+    cpu.SetDispatchMode(benchMode(state));
+    cpu.loadProgram(program, 0);
+    uint64_t instructions = 0;
+    for (auto _ : state) {
+        instructions += cpu.run(SLICE).instructions;
+    }
+    reportGuestInstructions(state, instructions);
+    state.counters["words_per_second"] = benchmark::Counter(static_cast<double>(instructions / perRound * 4),
+                                                            benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ArrayAdd)->ArgsProduct({{static_cast<int>(CPU32::DispatchMode::Table),
+                                      static_cast<int>(CPU32::DispatchMode::Blocks)},
+                                     {0, 1}});
+
+// Incremental snapshot of a range(0)-word guest that wrote 16 pages since the last one;
+// the cost follows the pages written, not the memory size
+static void BM_Snapshot(benchmark::State& state) {
+    CPU32 cpu(static_cast<size_t>(state.range(0)));
+    auto memory = cpu.GetMemory();
+    uint32_t stride = static_cast<uint32_t>(state.range(0) / 16);
+    uint32_t value = 0;
+    for (auto _ : state) {
+        ++value;
+        for (uint32_t page = 0; page < 16; ++page) {
+            memory->store(page * stride, value);
+        }
+        Snapshot32 snapshot = cpu.snapshot();
+        benchmark::DoNotOptimize(snapshot.words.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Snapshot)->Arg(1 << 20)->Arg(1 << 28);
+
+// Forking a range(0)-word guest with 64 resident pages, then writing one word in the
+// fork (which copies that one page). The cost should barely move with the guest's size,
+// up to the whole address space.
+static void BM_Fork(benchmark::State& state) {
+    CPU32 cpu(static_cast<size_t>(state.range(0)));
+    for (uint32_t page = 0; page < 64; ++page) {
+        cpu.GetMemory()->store(page * Memory32::PAGE_WORDS, page + 1);
+    }
+    for (auto _ : state) {
+        CPU32 child = cpu.fork();
+        child.GetMemory()->store(0, 0);
+        benchmark::DoNotOptimize(child.GetMemory()->load(0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Fork)->Arg(1 << 16)->Arg(1 << 24)->Arg(static_cast<int64_t>(Memory32::ADDRESS_SPACE));
+
+// range(0) cores of a Cluster32 each running a register-only loop for 2^20 instructions;
+// aggregate guest_MIPS should grow with the core count up to the host's
+static void BM_Cluster(benchmark::State& state) {
+    Cluster32 cluster(static_cast<size_t>(state.range(0)), 1 << 20);
+    cluster.loadProgram({0x05010200, 0x06030100, 0x12000000}, 0); // ADD R1, R2; SUB R3, R1; JMP 0
+    uint64_t instructions = 0;
+    for (auto _ : state) {
+        for (const auto& result : cluster.run(1 << 20)) {
+            instructions += result.instructions;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(instructions));
+    state.counters["guest_MIPS"] = benchmark::Counter(static_cast<double>(instructions) / 1e6,
+                                                      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Cluster)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// 1024 jobs summing a 256-word input each, on range(0) BatchRunner32 threads
+static void BM_Batch(benchmark::State& state) {
+    auto program = std::make_shared<const std::vector<uint32_t>>(std::vector<uint32_t>{
+            0x02020000, 0x02070001, 0x10010000, 0x13000009, 0x03030000, 0x05020300,
+            0x05000700, 0x06010700, 0x12000002, 0x04020000, 0xFF000000});
+    std::vector<BatchJob32> jobs(1024, BatchJob32{program, std::vector<uint32_t>(256, 3)});
+    BatchOptions32 options;
+    options.memorySize = 1 << 16;
+    BatchRunner32 runner(static_cast<size_t>(state.range(0)));
+    uint64_t instructions = 0;
+    for (auto _ : state) {
+        for (const auto& result : runner.run(jobs, options)) {
+            instructions += result.instructions;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(instructions));
+    state.counters["guest_MIPS"] = benchmark::Counter(static_cast<double>(instructions) / 1e6,
+                                                      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Batch)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// The same register loop in every lane, so each step issues to all of them
+static void BM_Lockstep(benchmark::State& state) {
+    std::vector<uint32_t> program = {
+            0x02010000, // 0: MOV R1, 0
+            0x02020003, // 1: MOV R2, 3
+            0x05010200, // 2: ADD R1, R2
+            0x09030100, // 3: XOR R3, R1
+            0x06040100, // 4: SUB R4, R1
+            0x10010C00, // 5: CMP R1, 0xC00
+            0x15000002, // 6: JL 2
+            0xFF000000  // 7: HLT
+    };
+    auto lanes = static_cast<size_t>(state.range(0));
+    uint64_t instructions = 0;
+    for (auto _ : state) {
+        LockstepCPU32 lockstep(lanes, 256);
+        lockstep.loadProgram(program, 0);
+        instructions += lockstep.run().laneInstructions;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(instructions));
+    state.counters["guest_MIPS"] = benchmark::Counter(static_cast<double>(instructions) / 1e6,
+                                                      benchmark::Counter::kIsRate);
+    state.SetLabel(LockstepCPU32::vectorISA());
+}
+BENCHMARK(BM_Lockstep)->Arg(16)->Arg(1024);
+
+// Many short guests multiplexed on one thread, a 256-instruction slice at a time
+static void BM_Scheduler(benchmark::State& state) {
+    std::vector<uint32_t> program = {
+            0x02010400, // 0: MOV R1, 0x400
+            0x02070001, // 1: MOV R7, 1
+            0x05020100, // 2: ADD R2, R1
+            0x06010700, // 3: SUB R1, R7
+            0x14000002, // 4: JNZ 2
+            0xFF000000  // 5: HLT
+    };
+    auto guests = static_cast<size_t>(state.range(0));
+    uint64_t instructions = 0;
+    for (auto _ : state) {
+        Scheduler32 scheduler(256);
+        for (size_t i = 0; i < guests; ++i) {
+            auto cpu = std::make_shared<FastCPU32>(256);
+            cpu->loadProgram(program, 0);
+            scheduler.spawn(std::move(cpu));
+        }
+        scheduler.run();
+        for (size_t i = 0; i < guests; ++i) {
+            instructions += scheduler.result(i).instructions;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(instructions));
+    state.counters["guest_MIPS"] = benchmark::Counter(static_cast<double>(instructions) / 1e6,
+                                                      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Scheduler)->Arg(1)->Arg(10000)->Unit(benchmark::kMillisecond);
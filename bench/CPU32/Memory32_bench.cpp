@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include <CPU32/Memory32.hpp>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+// Second argument: 0 for Mode::Checked, 1 for Mode::Guarded
+static Memory32::Mode benchMemoryMode(const benchmark::State& state) {
+    return state.range(1) ? Memory32::Mode::Guarded : Memory32::Mode::Checked;
+}
+
+static void BM_Memory32Load(benchmark::State& state) {
+    Memory32 memory(static_cast<size_t>(state.range(0)), benchMemoryMode(state));
+    if (memory.getMode() != benchMemoryMode(state)) {
+        state.SkipWithError("guard pages are not available in this build");
+        return;
+    }
+    uint32_t mask = static_cast<uint32_t>(state.range(0)) - 1;
+    uint32_t address = 0;
+    uint32_t sum = 0;
+    for (auto _ : state) {
+        sum += memory.load(address);
+        address = (address + 17) & mask;
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Memory32Load)->ArgsProduct({{1 << 10, 1 << 20}, {0, 1}});
+
+// Guarded stores still check their page's entry for watches and dirtiness, so they
+// should cost about what checked ones do
+static void BM_Memory32Store(benchmark::State& state) {
+    Memory32 memory(static_cast<size_t>(state.range(0)), benchMemoryMode(state));
+    if (memory.getMode() != benchMemoryMode(state)) {
+        state.SkipWithError("guard pages are not available in this build");
+        return;
+    }
+    uint32_t mask = static_cast<uint32_t>(state.range(0)) - 1;
+    uint32_t address = 0;
+    for (auto _ : state) {
+        memory.store(address, address);
+        address = (address + 17) & mask;
+    }
+    benchmark::ClobberMemory();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Memory32Store)->ArgsProduct({{1 << 10, 1 << 20}, {0, 1}});
+
+// Stores to a page holding cached code notify the caches
+static void BM_Memory32WatchedStore(benchmark::State& state) {
+    Memory32 memory(1 << 12);
+    memory.watch(0);
+    uint32_t address = 0;
+    for (auto _ : state) {
+        memory.store(address, address);
+        address = (address + 1) & (Memory32::PAGE_WORDS - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Memory32WatchedStore);
+
+// Guest startup from a program image of range(0) words: copying it in word by word
+// versus mapping the file
+static void BM_Memory32StartupCopy(benchmark::State& state) {
+    std::vector<uint32_t> image(static_cast<size_t>(state.range(0)), 0x05010200);
+    for (auto _ : state) {
+        Memory32 memory(Memory32::ADDRESS_SPACE);
+        for (size_t i = 0; i < image.size(); ++i) {
+            memory.store(static_cast<uint32_t>(i), image[i]);
+        }
+        benchmark::DoNotOptimize(memory.load(0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Memory32StartupCopy)->Arg(1 << 12)->Arg(1 << 18);
+
+static void BM_Memory32StartupMap(benchmark::State& state) {
+    std::vector<uint32_t> image(static_cast<size_t>(state.range(0)), 0x05010200);
+    std::string path = "memory32_bench_image.bin";
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size() * sizeof(uint32_t)));
+    }
+    for (auto _ : state) {
+        Memory32 memory(Memory32::ADDRESS_SPACE);
+        memory.mapImage(path);
+        benchmark::DoNotOptimize(memory.load(0));
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Memory32StartupMap)->Arg(1 << 12)->Arg(1 << 18);
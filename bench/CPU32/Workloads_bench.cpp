@@ -0,0 +1,152 @@
+#include "Bench32.hpp"
+#include <vector>
+
+// Whole guest programs run to HLT, reporting guest MIPS. Data lives from DATA up,
+// on pages of its own, so stores never touch cached code.
+static constexpr uint32_t DATA = 2048;
+static constexpr uint32_t MEMORY = 8192;
+
+static void runWorkload(benchmark::State& state, const std::vector<uint32_t>& program,
+                        void (*setup)(CPU32&) = nullptr) {
+    CPU32 cpu(MEMORY);
+    cpu.SetDispatchMode(benchMode(state));
+    uint64_t instructions = 0;
+    for (auto _ : state) {
+        cpu.halted = false;
+        cpu.loadProgram(program, 0);
+        if (setup) {
+            setup(cpu);
+        }
+        RunResult32 result = cpu.run(CPU32::UNLIMITED);
+        if (result.reason != StopReason32::Halted) {
+            state.SkipWithError("workload did not halt");
+            break;
+        }
+        instructions += result.instructions;
+    }
+    reportGuestInstructions(state, instructions);
+}
+
+// Sums 1..65000
+static void BM_WorkloadLoop(benchmark::State& state) {
+    runWorkload(state, {
+            0x02010000, // 0: MOV R1, 0
+            0x02020000, // 1: MOV R2, 0
+            0xE5010001, // 2: ADD R1, 1
+            0x05020100, // 3: ADD R2, R1
+            0x1001FDE8, // 4: CMP R1, 65000
+            0x14000002, // 5: JNZ 2
+            0xFF000000  // 6: HALT
+    });
+}
+BENCHMARK(BM_WorkloadLoop)->CPU32_BENCH_MODES;
+
+// Iterative Fibonacci, 20000 steps (wrapping)
+static void BM_WorkloadFibonacci(benchmark::State& state) {
+    runWorkload(state, {
+            0x02010000, // 0: MOV R1, 0
+            0x02020001, // 1: MOV R2, 1
+            0x02030000, // 2: MOV R3, 0
+            0x01040100, // 3: MOV R4, R1
+            0x05040200, // 4: ADD R4, R2
+            0x01010200, // 5: MOV R1, R2
+            0x01020400, // 6: MOV R2, R4
+            0xE5030001, // 7: ADD R3, 1
+            0x10034E20, // 8: CMP R3, 20000
+            0x14000003, // 9: JNZ 3
+            0xFF000000  // 10: HALT
+    });
+}
+BENCHMARK(BM_WorkloadFibonacci)->CPU32_BENCH_MODES;
+
+// Recursive Fibonacci of 18: CALL/RET and PUSH/POP heavy
+static void BM_WorkloadRecursiveFibonacci(benchmark::State& state) {
+    runWorkload(state, {
+            0x02060001, // 0: MOV R6, 1
+            0x02070002, // 1: MOV R7, 2
+            0x02010012, // 2: MOV R1, 18
+            0x30000005, // 3: CALL fib
+            0xFF000000, // 4: HALT
+            0x10010002, // 5: fib: CMP R1, 2
+            0x15000011, // 6: JL base
+            0x32010000, // 7: PUSH R1
+            0x06010600, // 8: SUB R1, R6
+            0x30000005, // 9: CALL fib
+            0x33010000, // 10: POP R1
+            0x32020000, // 11: PUSH R2
+            0x06010700, // 12: SUB R1, R7
+            0x30000005, // 13: CALL fib
+            0x33030000, // 14: POP R3
+            0x05020300, // 15: ADD R2, R3
+            0x31000000, // 16: RET
+            0x01020100, // 17: base: MOV R2, R1
+            0x31000000  // 18: RET
+    });
+}
+BENCHMARK(BM_WorkloadRecursiveFibonacci)->CPU32_BENCH_MODES;
+
+// Copies 2048 words from DATA to DATA + 2048
+static void BM_WorkloadMemcpy(benchmark::State& state) {
+    runWorkload(state, {
+            0x02010800, // 0: MOV R1, DATA
+            0x02021000, // 1: MOV R2, DATA + 2048
+            0x02031000, // 2: MOV R3, DATA + 2048 (end of source)
+            0x03040100, // 3: LOAD R4, [R1]
+            0x04040200, // 4: STORE R4, [R2]
+            0xE5010001, // 5: ADD R1, 1
+            0xE5020001, // 6: ADD R2, 1
+            0x11010300, // 7: CMP R1, R3
+            0x14000003, // 8: JNZ 3
+            0xFF000000  // 9: HALT
+    });
+}
+BENCHMARK(BM_WorkloadMemcpy)->CPU32_BENCH_MODES;
+
+// The same 2048-word copy as one BMOV, repeated 1000 times
+static void BM_WorkloadBlockMove(benchmark::State& state) {
+    runWorkload(state, {
+            0x02010800, // 0: MOV R1, DATA
+            0x02021000, // 1: MOV R2, DATA + 2048
+            0x02030800, // 2: MOV R3, 2048 (words)
+            0x020403E8, // 3: MOV R4, 1000
+            0x02050001, // 4: MOV R5, 1
+            0x50020103, // 5: BMOV R2, R1, R3
+            0x06040500, // 6: SUB R4, R5
+            0x14000005, // 7: JNZ 5
+            0xFF000000  // 8: HALT
+    });
+}
+BENCHMARK(BM_WorkloadBlockMove)->CPU32_BENCH_MODES;
+
+// Bubble sort of 128 words in descending order (the worst case)
+static constexpr uint32_t SORT_LENGTH = 128;
+
+static void BM_WorkloadBubbleSort(benchmark::State& state) {
+    runWorkload(state, {
+            0x02080001,                      // 0: MOV R8, 1
+            0x02010000 | (SORT_LENGTH - 1),  // 1: MOV R1, N - 1
+            0x02020000 | DATA,               // 2: outer: MOV R2, DATA
+            0x02030000 | DATA,               // 3: MOV R3, DATA
+            0x05030100,                      // 4: ADD R3, R1
+            0x03040200,                      // 5: inner: LOAD R4, [R2]
+            0x01050200,                      // 6: MOV R5, R2
+            0xE5050001,                      // 7: ADD R5, 1
+            0x03060500,                      // 8: LOAD R6, [R5]
+            0x11040600,                      // 9: CMP R4, R6
+            0x1700000D,                      // 10: JLE next
+            0x04060200,                      // 11: STORE R6, [R2]
+            0x04040500,                      // 12: STORE R4, [R5]
+            0xE5020001,                      // 13: next: ADD R2, 1
+            0x11020300,                      // 14: CMP R2, R3
+            0x14000005,                      // 15: JNZ inner
+            0x06010800,                      // 16: SUB R1, R8
+            0x14000002,                      // 17: JNZ outer
+            0xFF000000                       // 18: HALT
+    }, [](CPU32& cpu) {
+        auto memory = cpu.GetMemory();
+        for (uint32_t i = 0; i < SORT_LENGTH; ++i) {
+            memory->store(DATA + i, SORT_LENGTH - i);
+        }
+    });
+}
+BENCHMARK(BM_WorkloadBubbleSort)->CPU32_BENCH_MODES;
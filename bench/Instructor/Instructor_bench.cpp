@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+#include <Instructor/Instructor.hpp>
+#include <string>
+
+// A source of `blocks` small counted loops, each with its own label
+static std::string makeSource(int blocks) {
+    std::string source;
+    for (int i = 0; i < blocks; ++i) {
+        std::string label = "loop" + std::to_string(i);
+        source += "MOV R1 0\n";
+        source += "MOV R2 0x12345678\n";
+        source += label + ":\n";
+        source += "ADD R1 1\n";
+        source += "ADD R2 R1\n";
+        source += "XOR R3 R2\n";
+        source += "CMP R1 100\n";
+        source += "JNZ " + label + "\n";
+    }
+    source += "HLT\n";
+    return source;
+}
+
+static void BM_InstructorAssemble(benchmark::State& state) {
+    std::string source = makeSource(static_cast<int>(state.range(0)));
+    size_t lines = 0;
+    for (auto _ : state) {
+        Instructor instructor;
+        auto program = instructor.assemble(source);
+        benchmark::DoNotOptimize(program.data());
+        lines += static_cast<size_t>(state.range(0)) * 8 + 1;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(lines));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+BENCHMARK(BM_InstructorAssemble)->Arg(16)->Arg(256)->Arg(4096);
@@ -2,6 +2,7 @@
 // Created by John on 6/3/2024.
 //
 #include <CPUComponent.hpp>
+#include <bit>
 #include <cstdint>
 
 #ifndef CPUSIMULATOR_ALU32_HPP
@@ -9,9 +10,19 @@
 
 // setup observer interface?
 
-class ALU32 : public CPUComponent {
+template <typename Policy>
+class BasicALU32 : public Policy::Base {
 public:
-    enum Operation { ADD, SUB, AND, OR, XOR, NOT };
+    using Base = typename Policy::Base;
+
+    // MULH/MULHS give the high word of the unsigned/signed 64-bit product. Division
+    // by zero gives 0 (the CPU faults before it gets here) and INT_MIN / -1 wraps to
+    // INT_MIN with remainder 0. Shift and rotate counts are taken modulo 32.
+    enum Operation {
+        ADD, SUB, AND, OR, XOR, NOT,
+        MUL, MULH, MULHS, DIV, MOD, SDIV, SMOD,
+        SHL, SHR, SAR, ROL, ROR, POPCNT, CLZ
+    };
 
     void setInputs(uint32_t a, uint32_t b) {
         this->a = a;
@@ -25,7 +36,7 @@ public:
     }
 
     // rename
-    void Update(uint32_t) override {
+    void Update(uint32_t) {
         switch (op) {
             case ADD:
                 result = a + b;
@@ -45,19 +56,69 @@ public:
             case NOT:
                 result = ~a;
                 break;
+            case MUL:
+                result = a * b;
+                break;
+            case MULH:
+                result = static_cast<uint32_t>((static_cast<uint64_t>(a) * b) >> 32);
+                break;
+            case MULHS:
+                result = static_cast<uint32_t>(
+                        static_cast<uint64_t>(int64_t{static_cast<int32_t>(a)} * static_cast<int32_t>(b)) >> 32);
+                break;
+            case DIV:
+                result = b ? a / b : 0;
+                break;
+            case MOD:
+                result = b ? a % b : 0;
+                break;
+            case SDIV:
+                result = !b ? 0 : signedOverflow() ? a : static_cast<uint32_t>(static_cast<int32_t>(a) / static_cast<int32_t>(b));
+                break;
+            case SMOD:
+                result = !b || signedOverflow() ? 0 : static_cast<uint32_t>(static_cast<int32_t>(a) % static_cast<int32_t>(b));
+                break;
+            case SHL:
+                result = a << (b & 31);
+                break;
+            case SHR:
+                result = a >> (b & 31);
+                break;
+            case SAR:
+                result = static_cast<uint32_t>(static_cast<int32_t>(a) >> (b & 31));
+                break;
+            case ROL:
+                result = std::rotl(a, static_cast<int>(b & 31));
+                break;
+            case ROR:
+                result = std::rotr(a, static_cast<int>(b & 31));
+                break;
+            case POPCNT:
+                result = static_cast<uint32_t>(std::popcount(a));
+                break;
+            case CLZ:
+                result = static_cast<uint32_t>(std::countl_zero(a));
+                break;
         }
-        Notify();
+        Base::Notify();
     }
 
-    uint32_t GetState() const override {
+    uint32_t GetState() const {
         return result;
     }
 
 private:
-    uint32_t a, b;
-    uint32_t result;
-    Operation op;
+    // INT_MIN / -1, which does not fit
+    bool signedOverflow() const {
+        return a == 0x80000000u && b == 0xFFFFFFFFu;
+    }
+
+    uint32_t a = 0, b = 0;
+    uint32_t result = 0;
+    Operation op = ADD;
 };
 
+using ALU32 = BasicALU32<Observed>;
+
 
 #endif //CPUSIMULATOR_ALU32_HPP
@@ -0,0 +1,62 @@
+#include <CPU32/CPU32.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#ifndef CPUSIMULATOR_BATCH32_HPP
+#define CPUSIMULATOR_BATCH32_HPP
+
+// One guest of a batch. The program is stored at address 0, where execution starts,
+// and the input at the first page boundary after it; the guest finds the input's
+// address in R0 and its length in words in R1. Jobs running the same program can share
+// one copy of it.
+struct BatchJob32 {
+    std::shared_ptr<const std::vector<uint32_t>> program;
+    std::vector<uint32_t> input;
+};
+
+// How every job of a batch is run
+struct BatchOptions32 {
+    size_t memorySize = 1 << 20; // words
+    uint64_t maxInstructions = 1'000'000;
+    DispatchMode32 dispatchMode = DispatchMode32::Blocks;
+    Memory32::Mode memoryMode = Memory32::Mode::Checked;
+};
+
+// Final state of one job. A job that cannot even be set up (its program and input do
+// not fit in memory) is reported as a Fault that retired nothing.
+struct BatchResult32 {
+    StopReason32 reason = StopReason32::Halted;
+    uint64_t instructions = 0;
+    std::string fault;
+    std::array<uint32_t, 16> registers{};
+    uint32_t pc = 0;
+    uint64_t memoryDigest = 0; // Memory32::digest() of the final memory
+};
+
+// Runs batches of independent guests on a pool of host threads, one fresh FastCPU32
+// per job. Jobs are dealt out as one contiguous range per thread; a thread that runs
+// out steals half of the remaining range of another, so uneven jobs still keep every
+// thread busy. Taking and stealing are single compare-and-swaps on a range, and each
+// result goes straight into its own slot, so nothing on the way takes a lock.
+class BatchRunner32 {
+public:
+    // threads == 0: one per host core
+    explicit BatchRunner32(size_t threads = 0);
+
+    size_t threads() const { return threadCount; }
+
+    // Results in job order
+    std::vector<BatchResult32> run(std::span<const BatchJob32> jobs, const BatchOptions32& options = {}) const;
+
+    // One job on the calling thread
+    static BatchResult32 runOne(const BatchJob32& job, const BatchOptions32& options = {});
+
+private:
+    size_t threadCount;
+};
+
+#endif //CPUSIMULATOR_BATCH32_HPP
@@ -0,0 +1,166 @@
+#include <IObserver.hpp>
+#include <CPU32/Memory32.hpp>
+#include <CPU32/DecodeCache32.hpp>
+#include <CPU32/JIT32.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#ifndef CPUSIMULATOR_BLOCKCACHE32_HPP
+#define CPUSIMULATOR_BLOCKCACHE32_HPP
+
+// A straight-line run of decoded instructions ending in a jump, CALL, RET, HLT or trap
+template <typename Handler>
+struct Block32 {
+    using Op = DecodedInstruction32<Handler>;
+
+    uint32_t startPC = 0;
+    uint32_t endPC = 0;            // first address past the last instruction; wraps past 0xFFFFFFFF
+    uint32_t takenPC = 0;          // target of the terminating jump or CALL
+    bool hasTakenPC = false;
+    std::vector<Op> ops;
+
+    // Chained successors, filled in the first time each exit is followed
+    Block32* taken = nullptr;
+    Block32* fallthrough = nullptr;
+
+    // Execution count and native code used by DispatchMode::JIT
+    uint32_t executions = 0;
+    const JITCode32* jit = nullptr;
+};
+
+// Translated blocks keyed by start PC. Writes into a block's words retire it and
+// unchain every block, bumping generation() so a running block can notice and stop.
+template <typename Handler>
+class BlockCache32 : public IObserver {
+public:
+    using Block = Block32<Handler>;
+
+    explicit BlockCache32(std::shared_ptr<Memory32> mem) : memory(std::move(mem)) {
+        memory->Attach(this);
+    }
+
+    ~BlockCache32() override {
+        memory->Detach(this);
+    }
+
+    BlockCache32(const BlockCache32&) = delete;
+    BlockCache32& operator=(const BlockCache32&) = delete;
+
+    Block* find(uint32_t pc) const {
+        auto it = blocks.find(pc);
+        return it == blocks.end() ? nullptr : it->second.get();
+    }
+
+    Block* insert(std::unique_ptr<Block> block) {
+        Block* raw = block.get();
+        forEachPage(*raw, [&](uint32_t page) { pageIndex[page].push_back(raw); });
+        blocks[raw->startPC] = std::move(block);
+        return raw;
+    }
+
+    uint64_t generation() const {
+        return generation_;
+    }
+
+    // Frees retired blocks. Only call when no block is being executed.
+    void collect() {
+        retired.clear();
+    }
+
+    void clear() {
+        for (auto& [pc, block] : blocks) {
+            retired.push_back(std::move(block));
+        }
+        blocks.clear();
+        pageIndex.clear();
+        ++generation_;
+    }
+
+    size_t size() const {
+        return blocks.size();
+    }
+
+    // Forgets every block's native code after the JIT flushes it; hot blocks count up
+    // to the compile threshold again
+    void dropNativeCode() {
+        for (auto& [pc, block] : blocks) {
+            block->jit = nullptr;
+            block->executions = 0;
+        }
+        for (auto& block : retired) {
+            block->jit = nullptr;
+        }
+    }
+
+    // Memory write observer: retire every block containing address
+    void Update(uint32_t address) override {
+        auto it = pageIndex.find(pageOf(address));
+        if (it == pageIndex.end()) {
+            return;
+        }
+
+        std::vector<Block*> hit;
+        for (Block* block : it->second) {
+            if (contains(*block, address)) {
+                hit.push_back(block);
+            }
+        }
+        if (hit.empty()) {
+            return;
+        }
+
+        for (Block* block : hit) {
+            retire(block);
+        }
+        for (auto& [pc, block] : blocks) {
+            block->taken = nullptr;
+            block->fallthrough = nullptr;
+        }
+        ++generation_;
+    }
+
+private:
+    std::shared_ptr<Memory32> memory;
+    std::unordered_map<uint32_t, std::unique_ptr<Block>> blocks;
+    std::unordered_map<uint32_t, std::vector<Block*>> pageIndex;
+    std::vector<std::unique_ptr<Block>> retired;
+    uint64_t generation_ = 0;
+
+    static uint32_t pageOf(uint32_t address) {
+        return address >> Memory32::PAGE_SHIFT;
+    }
+
+    // Blocks at the top of a full address space may end at or run past 0xFFFFFFFF, so
+    // spans are measured from startPC modulo 2^32
+    static bool contains(const Block& block, uint32_t address) {
+        return address - block.startPC < block.endPC - block.startPC;
+    }
+
+    template <typename Visit>
+    static void forEachPage(const Block& block, Visit visit) {
+        uint32_t address = block.startPC;
+        while (true) {
+            visit(pageOf(address));
+            if (pageOf(address) == pageOf(block.endPC - 1)) {
+                break;
+            }
+            address = (address & ~Memory32::PAGE_MASK) + Memory32::PAGE_WORDS;
+        }
+    }
+
+    void retire(Block* block) {
+        forEachPage(*block, [&](uint32_t page) {
+            auto& list = pageIndex[page];
+            std::erase(list, block);
+            if (list.empty()) {
+                pageIndex.erase(page);
+            }
+        });
+        auto it = blocks.find(block->startPC);
+        retired.push_back(std::move(it->second));
+        blocks.erase(it);
+    }
+};
+
+#endif //CPUSIMULATOR_BLOCKCACHE32_HPP
@@ -0,0 +1,119 @@
+#include <CPU32/Device32.hpp>
+#include <CPU32/Memory32.hpp>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#ifndef CPUSIMULATOR_BUS32_HPP
+#define CPUSIMULATOR_BUS32_HPP
+
+// Connects devices to the CPU: a dense table for the 256 IN/OUT ports, and ranges
+// of the address space handed to Memory32, which flags their pages so that loads
+// and stores to ordinary RAM never look at the device map.
+class Bus32 {
+public:
+    static constexpr uint32_t PORTS = 256;
+
+    explicit Bus32(std::shared_ptr<Memory32> mem) : memory(std::move(mem)) {}
+
+    Bus32(const Bus32&) = delete;
+    Bus32& operator=(const Bus32&) = delete;
+
+    // Ports first .. first + count - 1 become the device's registers 0 .. count - 1
+    void attachPorts(uint32_t first, uint32_t count, std::shared_ptr<Device32> device) {
+        if (first >= PORTS || count > PORTS - first) {
+            throw std::out_of_range("Port range exceeds the port space");
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            if (ports[first + i].device) {
+                throw std::invalid_argument("Port already in use");
+            }
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            ports[first + i] = {device.get(), i};
+        }
+        keep(std::move(device));
+    }
+
+    // Words address .. address + words - 1 (whole pages) become the device's registers
+    void attachMemory(uint32_t address, size_t words, std::shared_ptr<Device32> device) {
+        memory->mapDevice(address, words, device);
+        keep(std::move(device));
+    }
+
+    bool ready(uint32_t port) const {
+        const Port& entry = ports[port & (PORTS - 1)];
+        return !entry.device || entry.device->ready(entry.offset);
+    }
+
+    bool writable(uint32_t port) const {
+        const Port& entry = ports[port & (PORTS - 1)];
+        return !entry.device || entry.device->writable(entry.offset);
+    }
+
+    // Unattached ports read as 0 and ignore writes
+    uint32_t in(uint32_t port) {
+        const Port& entry = ports[port & (PORTS - 1)];
+        return entry.device ? entry.device->read(entry.offset) : 0;
+    }
+
+    void out(uint32_t port, uint32_t value) {
+        const Port& entry = ports[port & (PORTS - 1)];
+        if (entry.device) {
+            entry.device->write(entry.offset, value);
+        }
+    }
+
+    // A bus for a fork of the memory (Memory32::fork), with the same devices on the same
+    // ports and addresses. Each device is asked for its fork (Device32::fork), so that
+    // devices doing DMA or raising interrupts work on the forked machine, not this one.
+    std::shared_ptr<Bus32> fork(std::shared_ptr<Memory32> forkedMemory,
+                                std::shared_ptr<InterruptController32> forkedInterrupts = nullptr) const {
+        auto copy = std::make_shared<Bus32>(forkedMemory);
+        DeviceFork32 target{forkedMemory, std::move(forkedInterrupts)};
+        copy->ports = ports;
+        for (const auto& device : devices) {
+            std::shared_ptr<Device32> forked = device->fork(target);
+            if (!forked) {
+                copy->devices.push_back(device);
+                continue;
+            }
+            for (Port& port : copy->ports) {
+                if (port.device == device.get()) {
+                    port.device = forked.get();
+                }
+            }
+            forkedMemory->replaceDevice(device.get(), forked);
+            copy->devices.push_back(std::move(forked));
+        }
+        return copy;
+    }
+
+    void flush() {
+        for (const auto& device : devices) {
+            device->flush();
+        }
+    }
+
+private:
+    struct Port {
+        Device32* device = nullptr;
+        uint32_t offset = 0;
+    };
+
+    std::shared_ptr<Memory32> memory;
+    std::array<Port, PORTS> ports{};
+    std::vector<std::shared_ptr<Device32>> devices;
+
+    void keep(std::shared_ptr<Device32> device) {
+        for (const auto& held : devices) {
+            if (held == device) {
+                return;
+            }
+        }
+        devices.push_back(std::move(device));
+    }
+};
+
+#endif //CPUSIMULATOR_BUS32_HPP
@@ -3,40 +3,230 @@
 
 #include <CPUComponent.hpp>
 #include <CPU32/Register32.hpp>
+#include <CPU32/RegisterFile32.hpp>
 #include <CPU32/Memory32.hpp>
+#include <CPU32/Bus32.hpp>
+#include <CPU32/Interrupts32.hpp>
 #include <CPU32/Clock32.hpp>
 #include <CPU32/ALU32.hpp>
 #include <CPU32/Flags32.hpp>
+#include <CPU32/DecodeCache32.hpp>
+#include <CPU32/BlockCache32.hpp>
+#include <CPU32/JIT32.hpp>
+#include <CPU32/Profiler32.hpp>
+#include <CPU32/Snapshot32.hpp>
+#include <CPU32/Checkpoint32.hpp>
 #include <memory>
 #include <vector>
 #include <map>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
 
-class CPU32 : public CPUComponent {
+// Computed-goto ("labels as values") is a GNU extension supported by GCC and Clang.
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU32_THREADED_DISPATCH 1
+#else
+#define CPU32_THREADED_DISPATCH 0
+#endif
+
+// How an opcode is turned into a call to its handler.
+//   Map      - the original std::map lookup, kept for throughput comparisons
+//   Table    - dense 256-entry handler table indexed by opcode
+//   Threaded - computed-goto run loop (falls back to Table without GNU extensions)
+//   Blocks   - run() executes translated basic blocks chained to their successors
+//   JIT      - Blocks, with hot blocks compiled to x86-64 (falls back to Blocks elsewhere)
+enum class DispatchMode32 { Map, Table, Threaded, Blocks, JIT };
+
+// Why a bounded run returned
+enum class StopReason32 {
+    Halted,          // the guest executed HLT
+    BudgetExhausted, // the instruction budget or the deadline ran out
+    Breakpoint,      // execution reached a breakpoint address
+    Fault,           // an instruction threw (bad memory access, stack overflow, ...)
+    IOWait           // an I/O instruction asked for a stop through requestStop()
+};
+
+// Outcome of run(maxInstructions) / runUntil(deadline)
+struct RunResult32 {
+    StopReason32 reason = StopReason32::Halted;
+    uint64_t instructions = 0; // retired during this call
+    uint64_t cycles = 0;       // clock cycles ticked during this call
+    std::string fault;         // what went wrong, when reason is Fault
+};
+
+// The CPU, its registers, flags, ALU and clock share one observation policy.
+// Observed components notify attached observers on every change; NoObservers
+// components compile all of that away.
+// Architectural state lives in a flat RegisterFile32; the register objects handed
+// out by GetRegisters() and friends are views onto it.
+template <typename Policy>
+class BasicCPU32 : public Policy::Base {
 public:
-    CPU32(size_t memorySize);
+    using DispatchMode = DispatchMode32;
+    using StopReason = StopReason32;
+    using Deadline = std::chrono::steady_clock::time_point;
+    using RegisterType = RegisterView32<Policy>;
+    using FlagsType = FlagsView32<Policy>;
+    using ALUType = BasicALU32<Policy>;
+    using ClockType = BasicClock32<Policy>;
+
+    BasicCPU32(size_t memorySize, Memory32::Mode memoryMode = Memory32::Mode::Checked);
+    // A CPU on an existing memory, which other CPUs may share (see Cluster32). On a
+    // concurrent memory, each run picks up the code writes other threads have made.
+    explicit BasicCPU32(std::shared_ptr<Memory32> memory);
     void loadInstruction(uint32_t instruction, uint32_t immediate = 0);
     void tickClock();
+    // Runs until HLT; faults propagate as exceptions
     void run();
+    // Runs until HLT, a breakpoint, a fault, a stop request or until maxInstructions
+    // have retired, whichever comes first. In the block dispatch modes the limits are
+    // only checked between blocks (blocks are cut short to land exactly on the budget).
+    // A faulting instruction is not retired and the PC is left pointing at it.
+    RunResult32 run(uint64_t maxInstructions);
+    // As run(maxInstructions), also stopping once the deadline has passed. The clock is
+    // read every DEADLINE_STRIDE block boundaries, so the deadline may be overshot slightly.
+    RunResult32 runUntil(Deadline deadline, uint64_t maxInstructions = UNLIMITED);
+
+    // Bounded runs stop before executing an instruction at a breakpoint address,
+    // unless it is the first instruction of the run
+    void addBreakpoint(uint32_t address);
+    void removeBreakpoint(uint32_t address);
+    void clearBreakpoints();
+
+    // Makes the running (or next) run return with `reason` at the next block boundary
+    void requestStop(StopReason reason);
     void loadProgram(const std::vector<uint32_t>& program, uint32_t startAddress);
+    // Maps a binary image file at startAddress (page aligned) and points the PC at it.
+    // See Memory32::mapImage; nothing is copied.
+    void loadImage(const std::string& path, uint32_t startAddress);
+
+    // Captures the registers, flags and the pages written since the previous snapshot,
+    // then starts a new interval (see Snapshot32)
+    Snapshot32 snapshot();
+    // Applies one snapshot of a sequence. Sequence 0 first resets memory, so restoring
+    // 0 .. n rebuilds the state at n, on this CPU or a new one with the same memory
+    // size; any other snapshot must follow the last one taken or restored. Throws
+    // std::invalid_argument otherwise. Later snapshots continue the restored sequence.
+    void restore(const Snapshot32& snapshot);
 
-    std::vector<std::shared_ptr<Register32>> GetRegisters() const;
-    std::shared_ptr<Register32> GetProgramCounter() const;
+    // Writes the whole machine state to a checkpoint file (see Checkpoint32)
+    void saveCheckpoint(const std::string& path) const;
+    // Replaces the machine state with a checkpoint's. The memory size must match.
+    // Afterwards snapshot() continues at sequence 1, the checkpoint standing in for 0.
+    void loadCheckpoint(const std::string& path);
+
+    // An independent machine in this one's state: registers, flags, breakpoints and
+    // dispatch mode are copied, memory is shared copy-on-write (Memory32::fork) and the
+    // bus gets forks of the devices (Bus32::fork). Block devices still share their host
+    // file, so disk writes in either machine reach the other. Snapshots of the fork
+    // continue this one's sequence.
+    BasicCPU32 fork() const;
+
+    const std::vector<std::shared_ptr<RegisterType>>& GetRegisters() const;
+    std::shared_ptr<RegisterType> GetProgramCounter() const;
     std::shared_ptr<Memory32> GetMemory() const;
-    std::shared_ptr<Flags32> GetFlagsRegister() const;
-    std::shared_ptr<Register32> GetStackPointer() const;
+    // Devices reached through IN/OUT ports and memory-mapped ranges
+    std::shared_ptr<Bus32> GetBus() const;
+    // Interrupt lines and the vector table. With Flags32::INTERRUPT set, a pending
+    // line is taken before the next instruction (the next block in the block modes):
+    // the flags and PC are pushed, INTERRUPT is cleared and execution continues at the
+    // line's vector. IRET returns. HLT with INTERRUPT set and a timer armed sleeps until
+    // the timer expires rather than ending the run, and a halted CPU resumes after its
+    // HLT when it takes an interrupt.
+    std::shared_ptr<InterruptController32> GetInterrupts() const;
+    std::shared_ptr<FlagsType> GetFlagsRegister() const;
+    std::shared_ptr<RegisterType> GetStackPointer() const;
+    const RegisterFile32& GetRegisterFile() const;
 
 
     // Subject/Observer Interface
-    uint32_t GetState() const override;
-    void Update(uint32_t state) override;
+    uint32_t GetState() const;
+    void Update(uint32_t state);
 
     bool GetZeroFlag() const;
     void SetZeroFlag(bool zFlag);
+
+    void SetDispatchMode(DispatchMode mode);
+    DispatchMode GetDispatchMode() const;
+
+#if CPU32_PROFILING
+    // Attaching a profiler makes every run feed it each retired instruction. While one
+    // is attached, runs go through the interpreter (JIT-compiled and threaded code are
+    // not instrumented); nullptr detaches it.
+    void SetProfiler(std::shared_ptr<Profiler32> profiler);
+    std::shared_ptr<Profiler32> GetProfiler() const;
+#endif
+
     bool halted = false;
 
+    static constexpr uint64_t UNLIMITED = UINT64_MAX;
+
 private:
+    using Handler = void (BasicCPU32::*)();
+    using DecodedInstruction = DecodedInstruction32<Handler>;
+    using Block = Block32<Handler>;
+
+    // Longest straight-line run translated into a single block
+    static constexpr size_t MAX_BLOCK_LENGTH = 64;
+    // Executions after which DispatchMode::JIT compiles a block
+    static constexpr uint32_t JIT_THRESHOLD = 16;
+    // Passes a self-looping native block makes before returning to the block loop
+    static constexpr uint32_t JIT_MAX_ITERATIONS = 1u << 16;
+    // Block boundaries between reads of the host clock in runUntil()
+    static constexpr uint32_t DEADLINE_STRIDE = 256;
+
     void fetch();
+    const DecodedInstruction& lookupDecoded(uint32_t pc);
+    const DecodedInstruction& decode(uint32_t pc);
     void decodeExecute();
+    void runThreaded();
+    RunResult32 runBounded(uint64_t maxInstructions, const Deadline* deadline);
+    RunResult32 runSteps(uint64_t maxInstructions, const Deadline* deadline);
+    RunResult32 runBlocks(uint64_t maxInstructions, const Deadline* deadline, bool bounded);
+    // Limits of one run() call
+    struct RunLimits {
+        uint64_t maxInstructions;
+        const Deadline* deadline;
+        bool checkBreakpoints;
+        uint32_t boundaries = 0;
+
+        // Whether shouldStop() has anything to look at beyond halts, stop requests and the budget
+        bool slowChecks() const {
+            return checkBreakpoints || deadline;
+        }
+    };
+
+    bool profiling() const {
+#if CPU32_PROFILING
+        return profiler != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    bool mayStop(uint64_t retired, const RunLimits& limits) const {
+        return halted || stopRequested || retired >= limits.maxInstructions || limits.slowChecks() ||
+               interruptDue();
+    }
+    // Whether the clock has reached the interrupt controller's next event
+    bool interruptDue() const {
+        return clock->GetCycles() >= interrupts->nextEvent();
+    }
+    // Lets due timers expire and takes the lowest pending line if interrupts are enabled.
+    // Halted with interrupts enabled, first skips the clock ahead to the next timer.
+    void serviceInterrupts();
+    void enterInterrupt(uint32_t line);
+    bool shouldStop(uint64_t retired, RunLimits& limits, RunResult32& result);
+    Block* translate(uint32_t pc);
+    void compileBlock(Block& block);
+    uint64_t executeNative(const JITCode32& code, uint32_t maxIterations);
+    void trap();
+    // Before a run on a concurrent memory: takes ownership of this thread's caches and
+    // applies the writes other threads made to code they hold
+    void syncMemory();
 
     void nop();
     void movRegisterToRegister();
@@ -52,6 +242,20 @@ private:
     void orOp();
     void xorOp();
     void notOp();
+    void multiply();             // MUL
+    void multiplyHigh();         // MULH
+    void multiplyHighSigned();   // MULHS
+    void divide();               // DIV
+    void modulo();               // MOD
+    void divideSigned();         // SDIV
+    void moduloSigned();         // SMOD
+    void shiftLeft();            // SHL
+    void shiftRight();           // SHR
+    void shiftRightArithmetic(); // SAR
+    void rotateLeft();           // ROL
+    void rotateRight();          // ROR
+    void popCount();             // POPCNT
+    void countLeadingZeros();    // CLZ
     void cmpImmediateToRegister();
     void cmpRegisterToRegister();
     void jmp();
@@ -70,19 +274,142 @@ private:
     void push(); // Push operation
     void pop();  // Pop operation
 
+    void blockMove();    // BMOV
+    void blockFill();    // BFILL
+    void blockCompare(); // BCMP
+
+    void compareAndSwap(); // CAS
+    void exchangeAdd();    // XADD
+    void fence();          // FENCE
+
+    void enableInterrupts();  // EI
+    void disableInterrupts(); // DI
+    void interruptReturn();   // IRET
+
+    void vectorLoad();           // VLOAD
+    void vectorStore();          // VSTORE
+    void vectorAdd();            // VADD
+    void vectorSub();            // VSUB
+    void vectorAnd();            // VAND
+    void vectorOr();             // VOR
+    void vectorXor();            // VXOR
+    void vectorCompareEqual();   // VCMPEQ
+    void vectorCompareGreater(); // VCMPGT
+    void vectorSum();            // VSUM
+    void vectorSplat();          // VSPLAT
+
+    // V1 = V1 op V2 for the lane-wise vector instructions
+    template <VectorALU32::Operation operation>
+    void vectorLanes() {
+        Vector32& destination = registerFile->vectors[(instruction >> 16) & 0x0F];
+        destination = VectorALU32::apply<operation>(destination, registerFile->vectors[(instruction >> 8) & 0x0F]);
+    }
+
+    // Register file accessors for the handlers. Writes notify the matching view's
+    // observers; with NoObservers they are plain stores.
+    uint32_t readRegister(uint8_t index) const {
+        return registerFile->registers[index];
+    }
+
+    void writeRegister(uint8_t index, uint32_t value) {
+        registerFile->registers[index] = value;
+        if constexpr (Policy::notifies) {
+            registers[index]->changed();
+        }
+    }
+
+    void setProgramCounter(uint32_t value) {
+        registerFile->pc = value;
+        if constexpr (Policy::notifies) {
+            programCounter->changed();
+        }
+    }
+
+    void setStackPointer(uint32_t value) {
+        registerFile->sp = value;
+        if constexpr (Policy::notifies) {
+            stackPointer->changed();
+        }
+    }
+
+    // Operands and result of a two-register ALU instruction
+    struct AluResult {
+        uint32_t a, b, result;
+    };
+
+    // Applies `operation` to R1 and R2 and writes the result to R1; the caller records
+    // the flags. Divisions fault on a zero divisor before anything is written.
+    AluResult aluRegisters(typename ALUType::Operation operation, bool divides = false) {
+        uint8_t reg1 = (instruction >> 16) & 0x0F;
+        uint8_t reg2 = (instruction >> 8) & 0x0F;
+        uint32_t value1 = readRegister(reg1);
+        uint32_t value2 = readRegister(reg2);
+        if (divides && value2 == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+        alu->setInputs(value1, value2);
+        alu->setOperation(operation);
+        uint32_t result = alu->GetState();
+        writeRegister(reg1, result);
+        return {value1, value2, result};
+    }
+
+    // Flags are recorded lazily and only derived when read
+    void recordFlags(LazyFlags32::Kind kind, uint32_t a, uint32_t b, uint32_t result) {
+        registerFile->lazyFlags.record(kind, a, b, result);
+    }
+
+    bool isFlagSet(FlagBits32::Flags flag) const {
+        return registerFile->lazyFlags.isSet(flag, registerFile->flags);
+    }
+
+    void updateFlag(FlagBits32::Flags flag, bool set) {
+        registerFile->resolveFlags();
+        if (set) {
+            registerFile->flags |= flag;
+        } else {
+            registerFile->flags &= ~flag;
+        }
+    }
+
     uint32_t instruction;
     uint32_t immediateOperand;
     uint32_t addressOperand;
+    uint32_t instructionPC = 0; // where the instruction being executed starts
     uint32_t returnAddress;
 
-    std::shared_ptr<Clock32> clock;
-    std::shared_ptr<Register32> programCounter;
-    std::shared_ptr<Register32> stackPointer;
-    std::shared_ptr<ALU32> alu;
-    std::shared_ptr<Flags32> flagsRegister;
-    std::vector<std::shared_ptr<Register32>> registers;
-    std::map<uint32_t, void (CPU32::*)()> opcodeMap;
+    std::shared_ptr<ClockType> clock;
+    std::shared_ptr<RegisterFile32> registerFile;
+    std::shared_ptr<RegisterType> programCounter;
+    std::shared_ptr<RegisterType> stackPointer;
+    std::shared_ptr<ALUType> alu;
+    std::shared_ptr<FlagsType> flagsRegister;
+    std::vector<std::shared_ptr<RegisterType>> registers;
+    std::map<uint32_t, Handler> opcodeMap;
+    std::array<Handler, 256> dispatchTable;
+    DispatchMode dispatchMode;
     std::shared_ptr<Memory32> memory;
+    std::shared_ptr<Bus32> bus;
+    std::shared_ptr<InterruptController32> interrupts;
+    std::shared_ptr<DecodeCache32<Handler>> decodeCache;
+    std::shared_ptr<BlockCache32<Handler>> blockCache;
+    std::shared_ptr<JIT32> jit;
+#if CPU32_PROFILING
+    std::shared_ptr<Profiler32> profiler;
+#endif
+    std::unordered_set<uint32_t> breakpoints;
+    bool stopRequested = false;
+    StopReason requestedStop = StopReason::Halted;
+    uint64_t nextSnapshot = 0;
 };
 
+// Both policies are instantiated in CPU32.cpp
+extern template class BasicCPU32<Observed>;
+extern template class BasicCPU32<NoObservers>;
+
+// The observed CPU used by the REPL and tests
+using CPU32 = BasicCPU32<Observed>;
+// Notification-free CPU for long unattended runs
+using FastCPU32 = BasicCPU32<NoObservers>;
+
 #endif //CPUSIMULATOR_CPU32_HPP
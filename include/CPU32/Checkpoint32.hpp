@@ -0,0 +1,60 @@
+#include <CPU32/Memory32.hpp>
+#include <cstdint>
+#include <string>
+
+#ifndef CPUSIMULATOR_CHECKPOINT32_HPP
+#define CPUSIMULATOR_CHECKPOINT32_HPP
+
+// Fixed part of a checkpoint file. Fields are in host byte order, like images.
+// Version 2 appended the vector registers; version 1 files still load, with them zeroed.
+struct CheckpointHeader32 {
+    static constexpr char MAGIC[8] = {'C', 'P', 'U', '3', '2', 'C', 'K', 'P'};
+    static constexpr uint32_t VERSION = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes; // where the page directory starts; later versions may grow the header
+    uint64_t memorySize;
+    uint32_t registers[16];
+    uint32_t pc;
+    uint32_t sp;
+    uint32_t flags; // resolved
+    uint32_t halted;
+    uint32_t pageCount; // entries in the page directory
+    uint32_t rawPages;  // pages stored word for word at dataOffset
+    uint64_t dataOffset;
+    uint32_t vectors[16][4];
+};
+
+// One page directory entry. Pages that are all zero have no entry.
+struct CheckpointPage32 {
+    enum Kind : uint32_t { FILL = 1, RAW = 2 };
+
+    uint32_t index;
+    uint32_t kind;
+    uint32_t value; // FILL: the word every word of the page holds; RAW: position in the data
+};
+
+// Versioned binary checkpoints of a CPU32, for warm-starting guests from a prepared
+// state instead of replaying their setup. A file is the header, the page directory
+// in ascending page order, then the RAW pages at dataOffset. Memory is stored
+// sparsely: zero pages are left out and pages repeating a single word keep just that
+// word. dataOffset is aligned for any host page size, so loading many pages maps
+// them copy-on-write (Memory32::mapPages) instead of reading them.
+class Checkpoint32 {
+public:
+    // File alignment of the RAW pages
+    static constexpr uint64_t ALIGNMENT = 1 << 16;
+    // RAW pages from which load() maps rather than reads
+    static constexpr uint32_t MAP_THRESHOLD = 64;
+
+    // Writes `state` (its page fields are filled in here) and the contents of memory
+    static void save(const std::string& path, CheckpointHeader32 state, const Memory32& memory);
+
+    // Checks the file against memory, resets memory to the file's contents and returns
+    // the header. Throws std::runtime_error for unreadable or malformed files and
+    // std::invalid_argument when the memory size differs.
+    static CheckpointHeader32 load(const std::string& path, Memory32& memory);
+};
+
+#endif //CPUSIMULATOR_CHECKPOINT32_HPP
@@ -6,28 +6,47 @@
 #ifndef CPUSIMULATOR_CLOCK32_HPP
 #define CPUSIMULATOR_CLOCK32_HPP
 
-class Clock32 : public CPUComponent {
+template <typename Policy>
+class BasicClock32 : public Policy::Base {
 public:
-    Clock32(int frequency) : frequency(frequency), state(false) {}
+    using Base = typename Policy::Base;
+
+    BasicClock32(int frequency) : frequency(frequency), state(false) {}
 
     void tick() {
         state = !state;
-        CPUComponent::Notify();
+        ++cycles;
+        Base::Notify();
+    }
+
+    // Advances several cycles at once, notifying observers a single time
+    void tick(uint64_t count) {
+        state = state != static_cast<bool>(count & 1);
+        cycles += count;
+        Base::Notify();
     }
 
-    void Update(uint32_t state) override {
-        Notify();
+    // Cycles ticked since construction
+    uint64_t GetCycles() const {
+        return cycles;
     }
 
-    uint32_t GetState() const override {
+    void Update(uint32_t state) {
+        Base::Notify();
+    }
+
+    uint32_t GetState() const {
         return state;
     }
 
 private:
     int frequency;
     bool state;
+    uint64_t cycles = 0;
 };
 
+using Clock32 = BasicClock32<Observed>;
+
 
 
 #endif //CPUSIMULATOR_CLOCK32_HPP
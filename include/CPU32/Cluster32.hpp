@@ -0,0 +1,39 @@
+#include <CPU32/CPU32.hpp>
+#include <memory>
+#include <vector>
+
+#ifndef CPUSIMULATOR_CLUSTER32_HPP
+#define CPUSIMULATOR_CLUSTER32_HPP
+
+// Several cores executing against one concurrent Memory32, each on a host thread of its
+// own for the length of run(). Cores are notification-free FastCPU32s with their own
+// registers, caches and bus, and coordinate through CAS, XADD and FENCE.
+// Core i starts with R0 = i and its stack STACK_WORDS below that of core i - 1, the
+// first one at the end of memory as for a single CPU.
+class Cluster32 {
+public:
+    static constexpr uint32_t STACK_WORDS = 4096;
+    // Instructions a core runs between picking up code written by the other cores
+    static constexpr uint64_t SLICE = 1u << 16;
+
+    // Throws std::invalid_argument if the memory cannot hold a stack for every core
+    Cluster32(size_t cores, size_t memorySize, Memory32::Mode memoryMode = Memory32::Mode::Checked);
+
+    size_t size() const { return cores.size(); }
+    FastCPU32& core(size_t index) { return *cores.at(index); }
+    std::shared_ptr<Memory32> GetMemory() const { return memory; }
+
+    // Stores the program once and points every core's PC at it
+    void loadProgram(const std::vector<uint32_t>& program, uint32_t startAddress);
+
+    // Runs all cores in parallel, each until it halts, faults, reaches a breakpoint or
+    // stops for I/O, or has retired maxInstructions. Returns once every core has
+    // stopped, with their results in core order.
+    std::vector<RunResult32> run(uint64_t maxInstructions = FastCPU32::UNLIMITED);
+
+private:
+    std::shared_ptr<Memory32> memory;
+    std::vector<std::unique_ptr<FastCPU32>> cores;
+};
+
+#endif //CPUSIMULATOR_CLUSTER32_HPP
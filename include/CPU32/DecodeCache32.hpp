@@ -0,0 +1,106 @@
+#include <IObserver.hpp>
+#include <CPU32/Memory32.hpp>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#ifndef CPUSIMULATOR_DECODECACHE32_HPP
+#define CPUSIMULATOR_DECODECACHE32_HPP
+
+// An instruction word plus its trailing operand words, decoded once per address
+template <typename Handler>
+struct DecodedInstruction32 {
+    Handler handler = nullptr;
+    uint32_t instruction = 0;
+    uint32_t immediate = 0;   // trailing 32-bit immediate, 0 if there is none
+    uint32_t address = 0;     // trailing address operand (STORE_IMM32 only)
+    uint32_t nextPC = 0;      // PC after the fetch; taken jumps overwrite it
+    uint8_t opcode = 0;
+    uint8_t reg1 = 0;
+    uint8_t reg2 = 0;
+    uint8_t length = 0;       // words the instruction occupies, 0 marks an empty slot
+};
+
+// Per-address cache of decoded instructions. Slots are allocated a memory page at a
+// time, and any store that lands on a cached instruction empties its slot again.
+// The page table only grows as far as the highest page executed from, so a guest
+// with a full 32-bit address space does not pay for a table covering all of it.
+template <typename Handler>
+class DecodeCache32 : public IObserver {
+public:
+    using Entry = DecodedInstruction32<Handler>;
+
+    // Longest encoding: STORE_IMM32 followed by its address and value words
+    static constexpr uint32_t MAX_LENGTH = 3;
+
+    explicit DecodeCache32(std::shared_ptr<Memory32> mem)
+            : memory(std::move(mem)) {
+        memory->Attach(this);
+    }
+
+    ~DecodeCache32() override {
+        memory->Detach(this);
+    }
+
+    DecodeCache32(const DecodeCache32&) = delete;
+    DecodeCache32& operator=(const DecodeCache32&) = delete;
+
+    // Slot for pc; empty (length == 0) until insert() fills it.
+    // Throws std::out_of_range for addresses outside memory, like Memory32::load.
+    Entry& slot(uint32_t pc) {
+        if (pc >= memory->getSize()) {
+            throw std::out_of_range("Memory access out of bounds");
+        }
+        size_t index = pc >> Memory32::PAGE_SHIFT;
+        if (index >= pages.size()) {
+            pages.resize(index + 1);
+        }
+        auto& page = pages[index];
+        if (!page) {
+            page = std::make_unique<Page>();
+        }
+        return (*page)[pc & Memory32::PAGE_MASK];
+    }
+
+    const Entry& insert(uint32_t pc, const Entry& entry) {
+        Entry& cached = slot(pc);
+        cached = entry;
+        for (uint32_t i = 0; i < entry.length; ++i) {
+            memory->watch(pc + i);
+        }
+        return cached;
+    }
+
+    void clear() {
+        for (auto& page : pages) {
+            page.reset();
+        }
+    }
+
+    // Memory write observer: drop every entry whose words include address
+    void Update(uint32_t address) override {
+        for (uint32_t back = 0; back < MAX_LENGTH && back <= address; ++back) {
+            Entry* entry = find(address - back);
+            if (entry && entry->length > back) {
+                entry->length = 0;
+            }
+        }
+    }
+
+private:
+    using Page = std::array<Entry, Memory32::PAGE_WORDS>;
+
+    std::shared_ptr<Memory32> memory;
+    std::vector<std::unique_ptr<Page>> pages;
+
+    Entry* find(uint32_t pc) {
+        size_t index = pc >> Memory32::PAGE_SHIFT;
+        if (index >= pages.size() || !pages[index]) {
+            return nullptr;
+        }
+        return &(*pages[index])[pc & Memory32::PAGE_MASK];
+    }
+};
+
+#endif //CPUSIMULATOR_DECODECACHE32_HPP
@@ -0,0 +1,44 @@
+#include <cstdint>
+#include <memory>
+
+#ifndef CPUSIMULATOR_DEVICE32_HPP
+#define CPUSIMULATOR_DEVICE32_HPP
+
+class InterruptController32;
+class Memory32;
+
+// What a fork of the machine gives its devices to bind to (see Device32::fork)
+struct DeviceFork32 {
+    std::shared_ptr<Memory32> memory;
+    std::shared_ptr<InterruptController32> interrupts; // null when only the memory forks
+};
+
+// A device on the I/O bus. Its registers are numbered by offset from where it is
+// attached: the port number minus its first port for IN/OUT, or the word address
+// minus the start of its range for memory-mapped access.
+class Device32 {
+public:
+    virtual ~Device32() = default;
+
+    virtual uint32_t read(uint32_t offset) = 0;
+    virtual void write(uint32_t offset, uint32_t value) = 0;
+
+    // Whether read(offset) has something to deliver right now. IN on a register
+    // that is not ready stops the run with StopReason32::IOWait instead of reading.
+    virtual bool ready(uint32_t offset) { (void) offset; return true; }
+
+    // Whether write(offset) can be taken right now. OUT to a register that is not
+    // writable stops the run with StopReason32::IOWait instead of writing.
+    virtual bool writable(uint32_t offset) { (void) offset; return true; }
+
+    // Pushes out anything buffered. The bus flushes every device when a run returns.
+    virtual void flush() {}
+
+    // The device the fork of a bus (Bus32::fork) attaches in this one's place. Devices
+    // holding on to a memory or interrupt controller return a copy bound to the fork's;
+    // the default, null, shares this device with the fork. Either way, state outside
+    // the emulator is not copied: a forked BlockDevice32 writes the same host file.
+    virtual std::shared_ptr<Device32> fork(const DeviceFork32& target) { (void) target; return nullptr; }
+};
+
+#endif //CPUSIMULATOR_DEVICE32_HPP
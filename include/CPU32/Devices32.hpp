@@ -0,0 +1,125 @@
+#include <CPU32/Device32.hpp>
+#include <CPU32/Interrupts32.hpp>
+#include <CPU32/Memory32.hpp>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#ifndef CPUSIMULATOR_DEVICES32_HPP
+#define CPUSIMULATOR_DEVICES32_HPP
+
+// Character console. Output is collected and written to the stream in one go when
+// the buffer fills or the bus flushes, rather than once per OUT.
+//   0 DATA    write: the low byte is output; read: the next input byte
+//   1 STATUS  read: input bytes waiting
+class ConsoleDevice32 : public Device32 {
+public:
+    enum Register : uint32_t { DATA = 0, STATUS = 1 };
+    static constexpr size_t BUFFER_SIZE = 4096;
+
+    explicit ConsoleDevice32(std::ostream& out = std::cout);
+    ~ConsoleDevice32() override;
+
+    // Queues host input for the guest to read
+    void feed(const std::string& text);
+
+    uint32_t read(uint32_t offset) override;
+    void write(uint32_t offset, uint32_t value) override;
+    bool ready(uint32_t offset) override;
+    void flush() override;
+
+private:
+    std::ostream& out;
+    std::string output;
+    std::deque<char> input;
+};
+
+// Free-running counter. Reading LOW also latches the high half for the next HIGH
+// read, so the two halves belong together; writing LOW restarts the count from 0.
+// Counts microseconds of host time unless given another source (e.g. guest cycles).
+//   0 LOW   1 HIGH
+class TimerDevice32 : public Device32 {
+public:
+    enum Register : uint32_t { LOW = 0, HIGH = 1 };
+
+    TimerDevice32();
+    explicit TimerDevice32(std::function<uint64_t()> source);
+
+    uint32_t read(uint32_t offset) override;
+    void write(uint32_t offset, uint32_t value) override;
+
+private:
+    std::function<uint64_t()> source;
+    uint64_t start;
+    uint32_t latchedHigh = 0;
+};
+
+// Timer counting the CPU's clock cycles that raises an interrupt line when it expires,
+// once or every PERIOD cycles. It belongs to one CPU: attach it to that CPU's interrupt
+// controller as well as its bus. A PERIOD of 0 never expires.
+//   0 PERIOD   cycles from arming to expiry, and between expiries when periodic
+//   1 CONTROL  ENABLE | PERIODIC; a write rearms the timer from now, or disarms it
+//   2 COUNT    read: cycles left until the next expiry, 0 while disarmed
+class IntervalTimerDevice32 : public Device32, public InterruptSource32 {
+public:
+    enum Register : uint32_t { PERIOD = 0, CONTROL = 1, COUNT = 2 };
+    enum Control : uint32_t { ENABLE = 1, PERIODIC = 2 };
+
+    IntervalTimerDevice32(std::shared_ptr<InterruptController32> controller, uint32_t line);
+
+    uint32_t read(uint32_t offset) override;
+    void write(uint32_t offset, uint32_t value) override;
+    // A timer attached to the fork's controller, armed for the cycles this one has left
+    std::shared_ptr<Device32> fork(const DeviceFork32& target) override;
+
+    uint64_t deadline() const override { return expiry; }
+    void expire(InterruptController32& controller, uint64_t now) override;
+
+private:
+    std::weak_ptr<InterruptController32> controller; // which holds on to the timer
+    uint32_t line;
+    uint32_t period = 0;
+    uint32_t control = 0;
+    uint64_t expiry = NEVER;
+};
+
+// Disk backed by a host file, transferring whole 1024-word blocks to and from guest
+// memory with the bulk Memory32 calls. Blocks past the end of the file read as zero.
+//   0 BLOCK    block number for the next command
+//   1 ADDRESS  guest address of the buffer
+//   2 COMMAND  write READ or WRITE to transfer; read: STATUS_OK or STATUS_ERROR
+//   3 BLOCKS   read: number of blocks in the file
+class BlockDevice32 : public Device32 {
+public:
+    enum Register : uint32_t { BLOCK = 0, ADDRESS = 1, COMMAND = 2, BLOCKS = 3 };
+    enum Command : uint32_t { READ = 1, WRITE = 2 };
+    enum Status : uint32_t { STATUS_OK = 0, STATUS_ERROR = 1 };
+    static constexpr uint32_t BLOCK_WORDS = Memory32::PAGE_WORDS;
+
+    // Opens (creating if needed) the file at path
+    BlockDevice32(const std::string& path, std::shared_ptr<Memory32> memory);
+
+    uint32_t read(uint32_t offset) override;
+    void write(uint32_t offset, uint32_t value) override;
+    void flush() override;
+    // The same file, transferring to and from the forked memory. The disk stays shared:
+    // blocks either side writes are seen by the other once flushed.
+    std::shared_ptr<Device32> fork(const DeviceFork32& target) override;
+
+private:
+    std::string path;
+    std::fstream file;
+    std::weak_ptr<Memory32> memory; // which holds on to the device when it is memory-mapped
+    uint32_t block = 0;
+    uint32_t address = 0;
+    uint32_t status = STATUS_OK;
+
+    void transfer(uint32_t command);
+    uint64_t fileBytes();
+};
+
+#endif //CPUSIMULATOR_DEVICES32_HPP
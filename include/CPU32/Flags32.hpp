@@ -9,9 +9,8 @@
 #define CPUSIMULATOR_FLAGS32_HPP
 
 
-
-class Flags32 : public Register32 {
-public:
+// Flag bits, shared by every BasicFlags32 policy
+struct FlagBits32 {
     enum Flags {
         CARRY = 1 << 0,
         ZERO = 1 << 1,
@@ -21,47 +20,57 @@ public:
         PARITY = 1 << 5
     };
 
-    Flags32() : Register32() {}
+    // Space separated names of the set flags, or "None"
+    static std::string names(uint32_t flags) {
+        std::ostringstream ss;
+        if (flags & CARRY) ss << "CARRY ";
+        if (flags & ZERO) ss << "ZERO ";
+        if (flags & INTERRUPT) ss << "INTERRUPT ";
+        if (flags & SIGN) ss << "SIGN ";
+        if (flags & OVERFLOW) ss << "OVERFLOW ";
+        if (flags & PARITY) ss << "PARITY ";
+        std::string result = ss.str();
+        if (result.empty()) {
+            return "None";
+        }
+        result.pop_back(); // Remove trailing space
+        return result;
+    }
+};
+
+template <typename Policy>
+class BasicFlags32 : public BasicRegister32<Policy>, public FlagBits32 {
+public:
+    BasicFlags32() : BasicRegister32<Policy>() {}
 
     void setFlag(Flags flag) {
-        state |= flag;
-        updateFlagNames();
+        this->state |= flag;
     }
 
     void clearFlag(Flags flag) {
-        state &= ~flag;
-        updateFlagNames();
+        this->state &= ~flag;
+    }
+
+    // Replaces every flag at once
+    void setFlags(uint32_t flags) {
+        this->state = flags;
     }
 
     bool isFlagSet(Flags flag) const {
-        return state & flag;
+        return this->state & flag;
     }
 
     uint32_t getFlags() const {
-        return state;
+        return this->state;
     }
 
+    // Built on demand; nothing is kept up to date on the flag-setting path
     std::string getFlagNames() const {
-        return collectionOfFlags.empty() ? "None" : collectionOfFlags;
-    }
-
-private:
-    std::string collectionOfFlags;
-
-    void updateFlagNames() {
-        std::ostringstream ss;
-        if (isFlagSet(CARRY)) ss << "CARRY ";
-        if (isFlagSet(ZERO)) ss << "ZERO ";
-        if (isFlagSet(INTERRUPT)) ss << "INTERRUPT ";
-        if (isFlagSet(SIGN)) ss << "SIGN ";
-        if (isFlagSet(OVERFLOW)) ss << "OVERFLOW ";
-        if (isFlagSet(PARITY)) ss << "PARITY ";
-        collectionOfFlags = ss.str();
-        if (!collectionOfFlags.empty()) {
-            collectionOfFlags.pop_back(); // Remove trailing space
-        }
+        return names(this->state);
     }
 };
 
+using Flags32 = BasicFlags32<Observed>;
+
 
 #endif //CPUSIMULATOR_FLAGS32_HPP
@@ -0,0 +1,74 @@
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#ifndef CPUSIMULATOR_INTERRUPTS32_HPP
+#define CPUSIMULATOR_INTERRUPTS32_HPP
+
+class InterruptController32;
+
+// Something that raises interrupts at clock cycles of its choosing (see
+// IntervalTimerDevice32). The controller calls expire() once the CPU's clock has
+// reached deadline().
+class InterruptSource32 {
+public:
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    virtual ~InterruptSource32() = default;
+
+    virtual uint64_t deadline() const = 0;
+    // Raises the source's line on the controller and rearms or disarms
+    virtual void expire(InterruptController32& controller, uint64_t now) = 0;
+};
+
+// The interrupt lines of one CPU. Handlers are found through a vector table in guest
+// memory: line n jumps to the address stored at vectorTable() + n.
+//
+// The CPU only looks here when its clock reaches nextEvent(), which is 0 while a line
+// is pending with interrupts enabled and otherwise the earliest source deadline (NEVER
+// if none is armed). That comparison is the whole cost of interrupts on the run loop.
+// Not thread-safe: raise lines from the thread running the CPU, e.g. between runs.
+class InterruptController32 {
+public:
+    static constexpr uint32_t LINES = 32;
+    static constexpr uint64_t NEVER = InterruptSource32::NEVER;
+
+    // `cycles` reads the clock of the CPU the controller belongs to
+    explicit InterruptController32(std::function<uint64_t()> cycles);
+
+    // Marks a line pending; lines already pending stay so until taken
+    void raise(uint32_t line);
+    uint32_t pending() const { return lines; }
+    // Takes the lowest pending line, or returns -1 if none is
+    int acknowledge();
+
+    uint32_t vectorTable() const { return table; }
+    void setVectorTable(uint32_t address) { table = address; }
+
+    // Mirrors Flags32::INTERRUPT; the CPU keeps it up to date
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    // Registers a source; sources that change their deadline call reschedule()
+    void attach(std::shared_ptr<InterruptSource32> source);
+    void reschedule();
+
+    uint64_t cycles() const { return clock(); }
+    uint64_t nextEvent() const { return next; }
+    // Earliest source deadline, NEVER if none is armed
+    uint64_t nextDeadline() const { return deadline; }
+    // Lets every source whose deadline is at or before `now` expire
+    void expire(uint64_t now);
+
+private:
+    std::function<uint64_t()> clock;
+    std::vector<std::shared_ptr<InterruptSource32>> sources;
+    uint32_t lines = 0;
+    uint32_t table = 0;
+    bool enabled = false;
+    uint64_t deadline = NEVER;
+    uint64_t next = NEVER;
+};
+
+#endif //CPUSIMULATOR_INTERRUPTS32_HPP
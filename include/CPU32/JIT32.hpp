@@ -0,0 +1,81 @@
+#include <CPU32/RegisterFile32.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#ifndef CPUSIMULATOR_JIT32_HPP
+#define CPUSIMULATOR_JIT32_HPP
+
+// The code generator emits x86-64 and relies on Linux mmap/mprotect
+#if defined(__x86_64__) && defined(__linux__)
+#define CPU32_JIT_AVAILABLE 1
+#else
+#define CPU32_JIT_AVAILABLE 0
+#endif
+
+// Loop bookkeeping for one call into JIT-compiled code
+struct JITCounters32 {
+    uint32_t iterations;     // passes made through the block by this call
+    uint32_t maxIterations;  // a block that loops back to itself returns after this many passes
+};
+
+// Native translation of the leading part of a basic block. The code reads and writes
+// the CPU's RegisterFile32 directly (field offsets are baked in) and leaves the PC
+// where the interpreter picks up again.
+struct JITCode32 {
+    using Entry = void (*)(RegisterFile32*, JITCounters32*);
+
+    Entry entry = nullptr;
+    uint32_t length = 0;      // guest instructions executed per pass
+    uint16_t readMask = 0;    // registers read before being written
+    uint16_t writeMask = 0;   // registers written, for notifying observers afterwards
+    bool writesFlags = false;
+};
+
+// x86-64 code generator for straight-line CPU32 code. Register moves, ADD/SUB/AND/OR/XOR/NOT,
+// CMP and jumps are compiled; anything else (memory, stack, I/O, HLT) ends the native code
+// and leaves the rest of the block to the interpreter.
+class JIT32 {
+public:
+    struct Op {
+        uint32_t instruction;
+        uint32_t immediate;
+        uint32_t nextPC;
+        uint8_t opcode;
+        uint8_t reg1;
+        uint8_t reg2;
+    };
+
+    explicit JIT32(size_t capacity = 16 << 20);
+    ~JIT32();
+
+    JIT32(const JIT32&) = delete;
+    JIT32& operator=(const JIT32&) = delete;
+
+    // Compiles the longest supported prefix of a block starting at startPC.
+    // Returns nullptr if nothing could be compiled or the code region is full.
+    const JITCode32* compile(const std::vector<Op>& ops, uint32_t startPC);
+
+    // Frees all compiled code, invalidating every JITCode32 returned so far. Code is only
+    // ever appended, so callers flush once compile() reports the region full.
+    void flush();
+
+    static bool isSupported(const Op& op);
+
+    size_t used() const { return offset; }
+    size_t capacity() const { return size; }
+    // Whether the last compile() failed for lack of space
+    bool full() const { return full_; }
+    size_t flushes() const { return flushes_; }
+
+private:
+    uint8_t* region = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    bool full_ = false;
+    size_t flushes_ = 0;
+    std::deque<JITCode32> codes;
+};
+
+#endif //CPUSIMULATOR_JIT32_HPP
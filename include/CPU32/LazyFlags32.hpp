@@ -0,0 +1,105 @@
+#include <CPU32/Flags32.hpp>
+#include <bit>
+#include <cstdint>
+
+#ifndef CPUSIMULATOR_LAZYFLAGS32_HPP
+#define CPUSIMULATOR_LAZYFLAGS32_HPP
+
+// Condition flags owed by the last flag-setting instruction. Instead of computing
+// ZERO/SIGN/CARRY/OVERFLOW/PARITY after every ALU op, the CPU records the op kind,
+// its operands and result here and derives a flag only when something reads it.
+//
+// ADD with an immediate only ever defined ZERO, so ZERO is tracked on its own:
+// `zeroPending` covers ZERO and `kind` covers the other four arithmetic flags.
+// Whatever is not pending is taken from the concrete flags word.
+//
+// Multiplies, shifts and rotates work out their own CARRY and OVERFLOW, which are
+// cheap by-products there; they record them as DIRECT, with `a` holding CARRY and
+// `b` OVERFLOW.
+struct LazyFlags32 : FlagBits32 {
+    enum Kind : uint8_t { NONE, ADD, SUB, LOGIC, DIRECT };
+
+    static constexpr uint32_t ARITHMETIC = CARRY | ZERO | SIGN | OVERFLOW | PARITY;
+
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t result = 0;
+    uint32_t zeroResult = 0;
+    Kind kind = NONE;
+    bool zeroPending = false;
+
+    // An op that defines all five arithmetic flags
+    void record(Kind op, uint32_t lhs, uint32_t rhs, uint32_t value) {
+        kind = op;
+        a = lhs;
+        b = rhs;
+        result = value;
+        zeroResult = value;
+        zeroPending = true;
+    }
+
+    // An op that only defines ZERO
+    void recordZero(uint32_t value) {
+        zeroResult = value;
+        zeroPending = true;
+    }
+
+    bool pending() const {
+        return kind != NONE || zeroPending;
+    }
+
+    void clear() {
+        kind = NONE;
+        zeroPending = false;
+    }
+
+    // Reads one flag, deriving it from the record when it is still owed
+    bool isSet(Flags flag, uint32_t flags) const {
+        if (flag == ZERO && zeroPending) {
+            return zeroResult == 0;
+        }
+        if (flag == SIGN && kind != NONE) {
+            return static_cast<int32_t>(result) < 0;
+        }
+        return resolve(flags) & flag;
+    }
+
+    // The concrete flags word: `flags` with every owed flag filled in
+    uint32_t resolve(uint32_t flags) const {
+        if (zeroPending) {
+            flags = (flags & ~ZERO) | (zeroResult == 0 ? ZERO : 0);
+        }
+        if (kind == NONE) {
+            return flags;
+        }
+        flags &= ~(CARRY | SIGN | OVERFLOW | PARITY);
+        if (static_cast<int32_t>(result) < 0) {
+            flags |= SIGN;
+        }
+        // Even parity of the low byte, as on x86
+        if (std::popcount(result & 0xFF) % 2 == 0) {
+            flags |= PARITY;
+        }
+        bool carry = false;
+        bool overflow = false;
+        if (kind == ADD) {
+            carry = result < a;
+            overflow = (~(a ^ b) & (a ^ result)) >> 31;
+        } else if (kind == SUB) {
+            carry = a < b; // borrow
+            overflow = ((a ^ b) & (a ^ result)) >> 31;
+        } else if (kind == DIRECT) {
+            carry = a;
+            overflow = b;
+        }
+        if (carry) {
+            flags |= CARRY;
+        }
+        if (overflow) {
+            flags |= OVERFLOW;
+        }
+        return flags;
+    }
+};
+
+#endif //CPUSIMULATOR_LAZYFLAGS32_HPP
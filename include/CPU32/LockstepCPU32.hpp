@@ -0,0 +1,123 @@
+#include <CPU32/CPU32.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef CPUSIMULATOR_LOCKSTEPCPU32_HPP
+#define CPUSIMULATOR_LOCKSTEPCPU32_HPP
+
+// Many guests ("lanes") running one program in lockstep, for the same code over many
+// inputs. State is kept as structure of arrays: register r of every lane is one
+// contiguous array, as are the PCs, stack pointers and flags, so each decoded
+// instruction is applied to CHUNK lanes per host vector operation. The kernels are
+// compiled for AVX-512, AVX2 and baseline x86-64 with GCC and chosen at load time;
+// other compilers get a portable scalar build of the same code.
+//
+// Divergence: every step issues the instruction at the lowest PC among running lanes,
+// to exactly the lanes at that PC; the rest are masked off until they get there. For
+// structured code (loops, if/else, calls) lanes that split at a branch run apart and
+// join again where the paths meet.
+//
+// Register, flag and jump instructions run vectorised, as do MUL, shifts and rotates.
+// The high multiplies, divisions, bit counts, LOAD/STORE, the stack instructions,
+// CALL and RET run lane by lane, loads and stores on each lane's own Memory32. A lane
+// reaching an instruction that needs a device, other CPUs or interrupts (IN/OUT,
+// block, atomic and interrupt instructions) or the vector registers stops with a
+// fault. Execution only ever reads the loaded program, so stores into it do not
+// change the code, and a lane whose PC leaves it (a jump, CALL or RET elsewhere, or
+// running off the end) stops there with the fault "PC outside the program". CPU32
+// would carry on with whatever that lane's memory holds, so such lanes do not match
+// a CPU32 run.
+class LockstepCPU32 {
+public:
+    static constexpr size_t CHUNK = 16; // lanes per vector operation
+    static constexpr uint64_t UNLIMITED = UINT64_MAX;
+
+    // Outcome of run()
+    struct Result {
+        uint64_t steps = 0;            // instructions issued
+        uint64_t laneInstructions = 0; // instructions retired, summed over the lanes
+        bool finished = false;         // no lane is left running
+    };
+
+    // Every lane starts at PC 0 with zeroed registers and SP at the end of its memory
+    LockstepCPU32(size_t lanes, size_t memorySize);
+
+    size_t lanes() const { return laneCount; }
+
+    // Stores the program into every lane's memory and points every lane at it
+    void loadProgram(const std::vector<uint32_t>& program, uint32_t startAddress);
+
+    // Runs until every lane has stopped or maxSteps instructions have been issued
+    Result run(uint64_t maxSteps = UNLIMITED);
+
+    uint32_t getRegister(size_t lane, uint8_t index) const;
+    void setRegister(size_t lane, uint8_t index, uint32_t value);
+    uint32_t getProgramCounter(size_t lane) const;
+    uint32_t getStackPointer(size_t lane) const;
+    bool getZeroFlag(size_t lane) const;
+    bool getSignFlag(size_t lane) const;
+    std::shared_ptr<Memory32> GetMemory(size_t lane) const { return memories.at(lane); }
+
+    // Whether the lane has stopped, and if so why (Halted or Fault)
+    bool stopped(size_t lane) const;
+    StopReason32 stopReason(size_t lane) const { return reasons.at(lane); }
+    const std::string& fault(size_t lane) const { return faults.at(lane); }
+
+    // Vector instruction set the kernels run with on this host
+    static const char* vectorISA();
+
+private:
+    // An instruction word decoded once for all lanes; length 0 where no valid
+    // instruction starts
+    struct Op {
+        uint32_t instruction = 0;
+        uint32_t immediate = 0;
+        uint32_t address = 0;
+        uint8_t opcode = 0;
+        uint8_t reg1 = 0;
+        uint8_t reg2 = 0;
+        uint8_t length = 0;
+    };
+
+    // One vector's worth of a per-lane array
+    struct alignas(64) Chunk {
+        uint32_t lane[CHUNK];
+    };
+
+    // The per-lane arrays, each `chunks` long, one after another in `state`
+    enum Array : size_t {
+        REGISTERS = 0, // 16 arrays, R0 .. R15
+        PC = 16,
+        SP,
+        ZERO,   // value whose being zero is the ZERO flag
+        SIGN,   // value whose top bit is the SIGN flag
+        ACTIVE, // all ones while the lane runs
+        MASK,   // all ones for the lanes the current step issues to
+        ARRAYS
+    };
+
+    size_t laneCount;
+    size_t chunks;
+    size_t memorySize;
+    std::vector<Chunk> state;
+    std::vector<std::shared_ptr<Memory32>> memories;
+    std::vector<StopReason32> reasons;
+    std::vector<std::string> faults;
+    std::vector<Op> code;
+    uint32_t codeStart = 0;
+
+    Chunk* array(size_t which) { return state.data() + which * chunks; }
+    const Chunk* array(size_t which) const { return state.data() + which * chunks; }
+    uint32_t& at(size_t which, size_t lane) { return array(which)[lane / CHUNK].lane[lane % CHUNK]; }
+    uint32_t at(size_t which, size_t lane) const { return array(which)[lane / CHUNK].lane[lane % CHUNK]; }
+
+    // Runs one instruction lane by lane, on the lanes in MASK; returns how many faulted
+    size_t executeScalar(const Op& op, uint32_t pc);
+    // Stops the lanes in MASK
+    void stopMasked(StopReason32 reason, const std::string& message);
+    void stopLane(size_t lane, StopReason32 reason, const std::string& message);
+};
+
+#endif //CPUSIMULATOR_LOCKSTEPCPU32_HPP
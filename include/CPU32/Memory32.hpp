@@ -1,29 +1,134 @@
 //
 // Created by John on 6/3/2024.
 //
+#include <IObserver.hpp>
+#include <CPU32/Device32.hpp>
+#include <atomic>
 #include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <stdexcept>
 
 #ifndef CPUSIMULATOR_MEMORY32_HPP
 #define CPUSIMULATOR_MEMORY32_HPP
 
+// Images are mapped with POSIX mmap; elsewhere mapImage falls back to reading the file
+#if defined(__unix__) || defined(__APPLE__)
+#define CPU32_MMAP_AVAILABLE 1
+#else
+#define CPU32_MMAP_AVAILABLE 0
+#endif
 
+// Guard-page mode turns host SIGSEGVs into std::out_of_range thrown from the signal
+// handler, which is only safe when everything touching guest memory is compiled with
+// -fnon-call-exceptions. Builds that use that flag (the CMake targets do, with GCC on
+// Linux) define CPU32_GUARD_PAGES to 1; without it Mode::Guarded falls back to Checked.
+#ifndef CPU32_GUARD_PAGES
+#define CPU32_GUARD_PAGES 0
+#endif
+
+// Word-addressed guest memory of up to 2^32 words. Storage is paged: a flat page
+// table holds one entry per 4 KiB page, pages are allocated the first time a
+// non-zero word is stored into them, and untouched pages read as zero. Resident
+// memory therefore follows what the guest touches, not the size it was given.
+// Page table entries may also point into a file image mapped copy-on-write, or
+// flag their page as belonging to a memory-mapped device (see Bus32).
+//
+// Written pages are also recorded in a dirty-page bitmap, so checkpoints can copy
+// just what changed since the previous one. The first store into a clean page takes
+// the same slow path as a store into a watched page; later ones do not.
+//
+// In Mode::Guarded the memory is instead one 16 GiB host reservation covering every
+// 32-bit address, with only the first `size` words accessible. Accesses index it
+// directly, with no bounds check; anything past the end lands on PROT_NONE pages and
+// the resulting SIGSEGV becomes the same std::out_of_range a checked access throws.
+// That needs `size` to end on a host page boundary, so other sizes stay in
+// Mode::Checked. Loads skip the page table altogether, but stores still read their
+// page's entry for watching and dirty tracking, so only loads are cheaper than in
+// Mode::Checked.
+//
+// Several CPUs on host threads may share one memory once it is made concurrent (see
+// setConcurrent). load and store are relaxed atomic accesses to the word (plain moves
+// on x86 and ARM), so racing guests see some value each has stored but no ordering
+// between words; compareExchange and fetchAdd are the synchronising operations.
 class Memory32 {
 public:
-    Memory32(size_t s) : memory(s, 0) {size = s;}
+    // Memory is tracked in 1024-word (4 KiB) pages
+    static constexpr uint32_t PAGE_SHIFT = 10;
+    static constexpr uint32_t PAGE_WORDS = 1u << PAGE_SHIFT;
+    static constexpr uint32_t PAGE_MASK = PAGE_WORDS - 1;
+
+    // Size that makes every 32-bit address valid
+    static constexpr size_t ADDRESS_SPACE = size_t(1) << 32;
+
+    enum class Mode {
+        Checked,  // bounds-checked accesses through the page table (default, debuggable)
+        Guarded   // accesses without bounds checks into a guard-page reservation
+    };
+
+    Memory32(size_t s, Mode mode = Mode::Checked)
+            : size(s), pageCount((s + PAGE_WORDS - 1) >> PAGE_SHIFT),
+              table(static_cast<uintptr_t*>(std::calloc(pageCount ? pageCount : 1, sizeof(uintptr_t)))),
+              dirty((pageCount + 63) / 64), writtenBits((pageCount + 63) / 64) {
+        if (s > ADDRESS_SPACE) {
+            throw std::invalid_argument("Memory size exceeds the 32-bit address space");
+        }
+        if (!table) {
+            throw std::bad_alloc();
+        }
+        if (mode == Mode::Guarded && CPU32_GUARD_PAGES) {
+            reserve();
+        }
+    }
+
+    Memory32(const Memory32&) = delete;
+    Memory32& operator=(const Memory32&) = delete;
+
+    // Mode::Checked when guard pages are unavailable in this build or for this size
+    Mode getMode() const { return base ? Mode::Guarded : Mode::Checked; }
 
     uint32_t load(uint32_t address) const {
-        if (address < memory.size()) {
-            return memory[address];
+        if (base) {
+            return loadWord(base + address);
+        }
+        if (address < size) {
+            uintptr_t entry = entryAt(address >> PAGE_SHIFT, std::memory_order_acquire);
+            const uint32_t* page = words(entry);
+            if (page) {
+                return loadWord(page + (address & PAGE_MASK));
+            }
+            // Only pages without storage can belong to a device
+            return entry & DEVICE ? deviceLoad(address) : 0;
         } else {
             throw std::out_of_range("Memory access out of bounds");
         }
     }
 
     void store(uint32_t address, uint32_t value) {
-        if (address < memory.size()) {
-            memory[address] = value;
+        if (base) {
+            storeWord(base + address, value);
+            if ((entryAt(address >> PAGE_SHIFT) & (WATCHED | DIRTY)) != DIRTY) {
+                written(address);
+            }
+            return;
+        }
+        if (address < size) {
+            uintptr_t entry = entryAt(address >> PAGE_SHIFT, std::memory_order_acquire);
+            uint32_t* page = words(entry);
+            // Fast path: a page of this memory's own that is dirty already and unwatched
+            if (page && (entry & (WATCHED | DIRTY | SHARED)) == DIRTY) {
+                storeWord(page + (address & PAGE_MASK), value);
+            } else {
+                storeSlow(address, value);
+            }
         } else {
             throw std::out_of_range("Memory access out of bounds");
         }
@@ -31,9 +136,309 @@ public:
 
     size_t getSize() const { return size; }
 
+    // Routes loads and stores to words address .. address + count - 1 to the device
+    // instead, as its registers 0 .. count - 1. The range is whole pages and replaces
+    // any RAM there. Mode::Checked only: guarded accesses never reach a page table.
+    void mapDevice(uint32_t address, size_t count, std::shared_ptr<Device32> device);
+    // Hands the ranges mapped to device over to replacement (used by Bus32::fork)
+    void replaceDevice(const Device32* device, std::shared_ptr<Device32> replacement);
+
+    // Bulk access, a page at a time with memcpy/memmove/fill rather than word by word.
+    // Each call checks its whole range first and throws std::out_of_range before
+    // touching anything, and stores into watched pages notify once per word written.
+    // Copies `out.size()` words starting at address into out and returns it
+    std::span<uint32_t> loadBlock(uint32_t address, std::span<uint32_t> out) const;
+    void storeBlock(uint32_t address, std::span<const uint32_t> values);
+    void fill(uint32_t address, size_t count, uint32_t value);
+    // memmove semantics: the ranges may overlap
+    void copy(uint32_t destination, uint32_t source, size_t count);
+    // Offset of the first word that differs between the two ranges, or count if none does
+    size_t compare(uint32_t first, uint32_t second, size_t count) const;
+
+    // Makes the words of a binary image file (host byte order) appear at address,
+    // which must be page aligned. The file is mapped MAP_PRIVATE rather than copied:
+    // guests mapping the same image share its physical pages until one of them
+    // stores into a page, which then gets a private copy. The file itself is never
+    // written. Returns the number of words in the image. Guarded memory on hosts whose
+    // pages are not 4 KiB reads the image in instead.
+    size_t mapImage(const std::string& path, uint32_t address = 0);
+
+    // Maps indices.size() consecutive pages of a file, starting at byte `offset` (a
+    // multiple of the host page size), copy-on-write as the guest pages `indices`.
+    // Falls back to reading them in where pages cannot be mapped.
+    void mapPages(const std::string& path, uint64_t offset, std::span<const uint32_t> indices);
+
+    // Files are only mapped straight into a guarded reservation when host pages are
+    // exactly one of ours. Pretends host pages are `bytes` long when deciding that (0
+    // restores the real size), so the read-in fallback taken on 16K and 64K page hosts
+    // can be exercised anywhere.
+    static void overrideHostPageSize(size_t bytes) { hostPageOverride = bytes; }
+
+    // Pages that have storage of their own, i.e. have been written with a non-zero
+    // word; pages of a mapped image are not counted. In Mode::Guarded, the host pages
+    // of the reservation that are resident (mincore), in 4 KiB units.
+    size_t residentPages() const;
+
+    // Dirty-page tracking. A page is dirty once anything has been written to it since
+    // the last clearDirty() (or since construction): a store, a bulk operation, or an
+    // image mapped over it. Device pages are never reported.
+    bool isDirty(uint32_t address) const {
+        return address < size && (entryAt(address >> PAGE_SHIFT) & DIRTY);
+    }
+
+    // Indices of the dirty pages, ascending. Scans the bitmap, not the page table.
+    std::vector<uint32_t> dirtyPages() const;
+    void clearDirty();
+
+    // Indices of every page written since construction or reset(), ascending: all the
+    // pages that can hold a non-zero word. Scans a bitmap, not the page table.
+    std::vector<uint32_t> writtenPages() const;
+
+    // 64-bit hash of the contents, for telling apart the memories of many runs cheaply.
+    // Depends only on the words held, not on how they got there: all-zero pages hash
+    // like untouched ones. Device registers are not read.
+    uint64_t digest() const;
+
+    // An independent copy of this memory that shares its pages copy-on-write: whichever
+    // side writes a shared page first gets a private copy of it, so forking a checked
+    // memory visits only the written and device pages and copies no words. A guarded
+    // memory's storage cannot be shared: its fork is a checked memory holding a copy of
+    // every written page.
+    // Dirty state carries over; devices are shared (until Bus32::fork swaps in their
+    // forks), watches are not.
+    std::shared_ptr<Memory32> fork();
+
+    // Atomic read-modify-writes of one word, sequentially consistent with each other
+    // across threads. They return the word's previous value; compareExchange stores
+    // `desired` only if that was `expected`. Device registers have no storage to use
+    // atomically, so on device pages the two are merely serialised by the device lock.
+    uint32_t compareExchange(uint32_t address, uint32_t expected, uint32_t desired);
+    uint32_t fetchAdd(uint32_t address, uint32_t value);
+
+    // Sharing between threads. While concurrent, everything that changes the page table,
+    // the dirty bitmap, devices or watches takes a lock, so loads, stores, bulk and
+    // atomic operations and watch() may come from any thread. Anything else (images,
+    // snapshots, fork, reset) still needs the memory to itself. Switch it while no other
+    // thread is using the memory.
+    void setConcurrent(bool on) { concurrent = on; }
+    bool isConcurrent() const { return concurrent; }
+
+    // Makes the calling thread the owner of an attached observer. While concurrent, a
+    // write from any other thread into a watched page is queued for the observer rather
+    // than delivered, until its owner calls deliverWrites(); observers nobody has
+    // claimed are called from whichever thread writes.
+    void claim(IObserver* observer);
+    // Hands every write queued for the calling thread's observers to them
+    void deliverWrites();
+
+    // Returns every word to zero and drops all pages and images, as if newly created.
+    // Devices and watches stay; watched pages notify and nothing is left dirty.
+    void reset();
+
+    // Write watching: a store into a watched page calls Update(address) on every
+    // attached observer. Used to invalidate anything derived from code in memory.
+    void Attach(IObserver *observer) {
+        auto lock = exclusive();
+        observers_.push_back({observer});
+    }
+
+    void Detach(IObserver *observer) {
+        auto lock = exclusive();
+        observers_.remove_if([observer](const Watcher& watcher) { return watcher.observer == observer; });
+    }
+
+    void watch(uint32_t address) {
+        if (address < size) {
+            auto lock = exclusive();
+            uint32_t index = address >> PAGE_SHIFT;
+            setEntry(index, table[index] | WATCHED);
+        }
+    }
+
+    bool isWatched(uint32_t address) const {
+        return address < size && (entryAt(address >> PAGE_SHIFT) & WATCHED);
+    }
+
 private:
+    // Aligned so that page pointers leave the five low bits free for flags
+    struct alignas(32) Page {
+        uint32_t words[PAGE_WORDS];
+    };
+
+    // Page table entries are the page's address with flags in the low bits, which
+    // are otherwise always clear as pages (and mapped images) are 32-byte aligned
+    static constexpr uintptr_t WATCHED = 1;
+    static constexpr uintptr_t DEVICE = 2;  // no storage; accesses go to devices
+    static constexpr uintptr_t DIRTY = 4;   // mirrors the page's bit in `dirty`
+    static constexpr uintptr_t WRITTEN = 8; // set with DIRTY, but only reset() clears it
+    static constexpr uintptr_t SHARED = 16; // storage another memory may see; copy before writing
+    static constexpr uintptr_t FLAGS = WATCHED | DEVICE | DIRTY | WRITTEN | SHARED;
+
+    // A device-mapped range, kept sorted by start for lookups on device pages
+    struct DeviceRange {
+        uint32_t start;
+        uint64_t end; // exclusive
+        std::shared_ptr<Device32> device;
+    };
+
+    // An mmap'd image, unmapped when the memory goes away
+    struct Mapping {
+        void* base;
+        size_t length;
+        ~Mapping();
+    };
+
+    // The Mode::Guarded reservation, registered with the SIGSEGV handler while it lives
+    struct Reservation {
+        uint32_t* base;
+        size_t accessible; // bytes from base that are readable and writable
+        ~Reservation();
+    };
+
+    // An attached observer, with the writes waiting for its owner thread (see claim())
+    struct Watcher {
+        IObserver* observer;
+        std::thread::id owner{};
+        std::vector<uint32_t> pending{};
+    };
+
+    struct TableDeleter {
+        void operator()(uintptr_t* table) const { std::free(table); }
+    };
+
     size_t size;
-    std::vector<uint32_t> memory;
+    size_t pageCount;
+    // calloc rather than a vector: for a large table the allocator hands out fresh
+    // zero pages from the OS, so the table's untouched parts are not resident either
+    std::unique_ptr<uintptr_t[], TableDeleter> table;
+    // One bit per page, set along with DIRTY, so finding dirty pages is a scan of
+    // pageCount / 64 words
+    std::vector<uint64_t> dirty;
+    // Likewise set along with WRITTEN and cleared only by reset(), so writtenPages()
+    // and fork() need not walk the whole table of a large, mostly untouched memory
+    std::vector<uint64_t> writtenBits;
+    // Pages with storage of their own, by index. Forked memories hold the same pages
+    // (and mappings) until one of them writes.
+    std::unordered_map<uint32_t, std::shared_ptr<Page>> pages;
+    std::vector<std::shared_ptr<Mapping>> mappings;
+    std::unique_ptr<Reservation> reservation;
+    uint32_t* base = nullptr; // reservation->base, or null in Mode::Checked
+    std::vector<DeviceRange> devices;
+    std::list<Watcher> observers_;
+    bool concurrent = false;
+    // Held by the slow paths while concurrent
+    mutable std::mutex mutex;
+    // Held around device accesses while concurrent, never with `mutex` held, because a
+    // device may itself use the memory (BlockDevice32 transfers into it)
+    mutable std::recursive_mutex deviceMutex;
+
+    static uint32_t* words(uintptr_t entry) {
+        return reinterpret_cast<uint32_t*>(entry & ~FLAGS);
+    }
+
+    // Guest words, which other threads may load, store or update (compareExchange,
+    // fetchAdd) at the same time while concurrent. The builtins rather than atomic_ref,
+    // whose noexcept members would turn a guard-page fault's exception into terminate
+    static uint32_t loadWord(const uint32_t* word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __atomic_load_n(word, __ATOMIC_RELAXED);
+#else
+        return std::atomic_ref<uint32_t>(*const_cast<uint32_t*>(word)).load(std::memory_order_relaxed);
+#endif
+    }
+    static void storeWord(uint32_t* word, uint32_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        __atomic_store_n(word, value, __ATOMIC_RELAXED);
+#else
+        std::atomic_ref<uint32_t>(*word).store(value, std::memory_order_relaxed);
+#endif
+    }
+
+    // Entries are read without the lock (the fast paths, isWatched, atomicWord) while
+    // another thread may be rewriting them under it, so both sides use atomic_ref.
+    // Readers that go on to the page's words acquire, pairing with the release that
+    // installed it; readers of flags alone load relaxed.
+    uintptr_t entryAt(uint32_t index, std::memory_order order = std::memory_order_relaxed) const {
+        return std::atomic_ref<uintptr_t>(table[index]).load(order);
+    }
+    // Only with the lock held (or the memory to oneself)
+    void setEntry(uint32_t index, uintptr_t entry) {
+        std::atomic_ref<uintptr_t>(table[index]).store(entry, std::memory_order_release);
+    }
+
+    // The memory lock while concurrent, otherwise an empty lock
+    std::unique_lock<std::mutex> exclusive() const {
+        return concurrent ? std::unique_lock<std::mutex>(mutex) : std::unique_lock<std::mutex>();
+    }
+
+    // The device lock while concurrent, otherwise an empty lock
+    std::unique_lock<std::recursive_mutex> deviceAccess() const {
+        return concurrent ? std::unique_lock<std::recursive_mutex>(deviceMutex)
+                          : std::unique_lock<std::recursive_mutex>();
+    }
+
+    void reserve();
+    // Both take deviceAccess() themselves; call them without exclusive() held
+    uint32_t deviceLoad(uint32_t address) const;
+    void deviceStore(uint32_t address, uint32_t value);
+    const DeviceRange& deviceAt(uint32_t address) const;
+    bool isDevicePage(uint32_t index) const {
+        uintptr_t entry = entryAt(index);
+        return !words(entry) && (entry & DEVICE);
+    }
+    void checkRange(uint32_t address, size_t count) const;
+    // Page `index`'s storage, allocating it if it has none yet and copying it if it is
+    // shared, marked dirty
+    uint32_t* writablePage(uint32_t index);
+    void storeSlow(uint32_t address, uint32_t value);
+    // The word an atomic operation works on, made writable and dirty; null on device pages
+    uint32_t* atomicWord(uint32_t address);
+    // Notifies a write made without the lock if its page is watched
+    void atomicWritten(uint32_t address);
+    void notifyRange(uint32_t address, size_t count);
+    // Marks the pages of a range written in Mode::Guarded dirty
+    void markRange(uint32_t address, size_t count);
+    // Points page `index` at external storage, dropping any page of its own
+    void setPage(uint32_t index, uint32_t* page);
+    // Page `index` has new contents: marks it dirty and notifies if it is watched
+    void pageReplaced(uint32_t index);
+    // mapPages without mmap: reads the pages and stores them
+    void readPages(const std::string& path, uint64_t offset, std::span<const uint32_t> indices);
+    // mapImage without mmap: stores the image's words and zeroes the rest of its last page
+    void readImage(const std::string& path, uint32_t address, size_t words);
+
+    static inline std::atomic<size_t> hostPageOverride{0};
+    static size_t hostPageSize();
+
+    void markDirty(uint32_t index) {
+        setEntry(index, table[index] | DIRTY | WRITTEN);
+        dirty[index >> 6] |= uint64_t(1) << (index & 63);
+        writtenBits[index >> 6] |= uint64_t(1) << (index & 63);
+    }
+
+    // The slow path of a store into a clean or watched page
+    void written(uint32_t address) {
+        auto lock = exclusive();
+        uint32_t index = address >> PAGE_SHIFT;
+        if (!(table[index] & DIRTY)) {
+            markDirty(index);
+        }
+        if (table[index] & WATCHED) {
+            notifyWrite(address);
+        }
+    }
+
+    void notifyWrite(uint32_t address) {
+        if (concurrent) {
+            notifyConcurrent(address);
+            return;
+        }
+        for (auto& watcher : observers_) {
+            watcher.observer->Update(address);
+        }
+    }
+
+    void notifyConcurrent(uint32_t address);
 };
 
 
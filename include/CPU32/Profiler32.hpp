@@ -0,0 +1,108 @@
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef CPUSIMULATOR_PROFILER32_HPP
+#define CPUSIMULATOR_PROFILER32_HPP
+
+// Profiling support is compiled in unless the build sets CPU32_PROFILING to 0,
+// in which case CPU32 carries no profiler member and no profiling branches.
+#ifndef CPU32_PROFILING
+#define CPU32_PROFILING 1
+#endif
+
+// Guest execution profile, fed one retired instruction at a time by a CPU32 that
+// has it attached (SetProfiler). Counts executions per opcode and per PC,
+// taken/not-taken per conditional jump, and instructions per CALL target; the
+// CALL/RET stack is tracked as a call tree for collapsed-stack output.
+class Profiler32 {
+public:
+    struct BranchCounts {
+        uint64_t taken = 0;
+        uint64_t notTaken = 0;
+    };
+
+    struct CallCounts {
+        uint64_t calls = 0;
+        uint64_t inclusive = 0; // instructions while the target was anywhere on the stack
+        uint64_t exclusive = 0; // instructions in the target's own body
+    };
+
+    Profiler32();
+    ~Profiler32();
+
+    // Records an instruction at pc that has just executed. nextPC is where it would
+    // fall through to and newPC where execution actually continues.
+    void retire(uint32_t pc, uint8_t opcode, uint32_t nextPC, uint32_t newPC) {
+        ++total;
+        ++opcodes[opcode];
+        ++pcs[pc];
+        ++current->self;
+        if (opcode >= 0x13 && opcode <= 0x18) {
+            BranchCounts& counts = branchCounts[pc];
+            if (newPC != nextPC) {
+                ++counts.taken;
+            } else {
+                ++counts.notTaken;
+            }
+        } else if (opcode == 0x30) {
+            enter(newPC);
+        } else if (opcode == 0x31) {
+            leave();
+        }
+    }
+
+    void reset();
+
+    // Names frames in the collapsed-stack output instead of their hex address
+    void setSymbol(uint32_t address, const std::string& name);
+
+    uint64_t instructions() const { return total; }
+    const std::array<uint64_t, 256>& opcodeCounts() const { return opcodes; }
+    const std::unordered_map<uint32_t, uint64_t>& pcCounts() const { return pcs; }
+    const std::unordered_map<uint32_t, BranchCounts>& branches() const { return branchCounts; }
+    // Per CALL target, including calls that have not returned yet
+    std::map<uint32_t, CallCounts> calls() const;
+
+    // One "root;caller;callee count" line per distinct stack, as read by flamegraph.pl
+    // and compatible tools. Counts are instructions executed with exactly that stack.
+    void writeCollapsedStacks(std::ostream& out) const;
+
+private:
+    struct Node {
+        uint32_t target = 0;
+        Node* parent = nullptr;
+        uint64_t self = 0;
+        std::unordered_map<uint32_t, std::unique_ptr<Node>> children;
+    };
+
+    struct Frame {
+        uint32_t target;
+        uint64_t start; // `total` when the frame was entered
+    };
+
+    uint64_t total = 0;
+    std::array<uint64_t, 256> opcodes{};
+    std::unordered_map<uint32_t, uint64_t> pcs;
+    std::unordered_map<uint32_t, BranchCounts> branchCounts;
+
+    Node root;
+    Node* current = &root;
+    std::vector<Frame> stack;
+    std::unordered_map<uint32_t, uint32_t> active;     // frames per target currently on the stack
+    std::unordered_map<uint32_t, uint64_t> callCount;
+    std::unordered_map<uint32_t, uint64_t> inclusiveDone; // from frames that have returned
+    std::unordered_map<uint32_t, std::string> symbols;
+
+    void enter(uint32_t target);
+    void leave();
+    void clearTree();
+    std::string frameName(uint32_t target) const;
+};
+
+#endif //CPUSIMULATOR_PROFILER32_HPP
@@ -7,25 +7,30 @@
 #define CPUSIMULATOR_REGISTER32_HPP
 
 
-class Register32 : public CPUComponent {
+template <typename Policy>
+class BasicRegister32 : public Policy::Base {
 public:
+    using Base = typename Policy::Base;
+
     void loadValue(uint32_t value) {
         state = value;
-        CPUComponent::Notify();
+        Base::Notify();
     }
 
-    uint32_t GetState() const override {
+    uint32_t GetState() const {
 
         return state;
     }
 
-    void Update(uint32_t state) override {
-        Notify();
+    void Update(uint32_t state) {
+        Base::Notify();
     }
 
 protected:
     uint32_t state = 0;
 };
 
+using Register32 = BasicRegister32<Observed>;
+
 
 #endif //CPUSIMULATOR_REGISTER32_HPP
@@ -0,0 +1,110 @@
+#include <CPUComponent.hpp>
+#include <CPU32/Flags32.hpp>
+#include <CPU32/LazyFlags32.hpp>
+#include <CPU32/Vector32.hpp>
+#include <cstdint>
+#include <string>
+
+#ifndef CPUSIMULATOR_REGISTERFILE32_HPP
+#define CPUSIMULATOR_REGISTERFILE32_HPP
+
+// All architectural CPU32 state in one contiguous block. The 16 general purpose
+// registers fill exactly one 64-byte cache line; PC, SP and flags open the next.
+// `flags` only holds the flags that lazyFlags does not still owe. The vector
+// registers V0 .. V15 come last, so scalar code never touches their lines.
+struct alignas(64) RegisterFile32 {
+    uint32_t registers[16];
+    uint32_t pc;
+    uint32_t sp;
+    uint32_t flags;
+    LazyFlags32 lazyFlags;
+    Vector32 vectors[16];
+
+    // Folds any owed flags into `flags`
+    void resolveFlags() {
+        if (lazyFlags.pending()) {
+            flags = lazyFlags.resolve(flags);
+            lazyFlags.clear();
+        }
+    }
+};
+
+// A Register32-like handle onto one word of a RegisterFile32, so code written
+// against GetState()/loadValue() (and Attach() when observed) keeps working.
+template <typename Policy>
+class RegisterView32 : public Policy::Base {
+public:
+    using Base = typename Policy::Base;
+
+    explicit RegisterView32(uint32_t* value) : value(value) {}
+
+    void loadValue(uint32_t newValue) {
+        *value = newValue;
+        Base::Notify();
+    }
+
+    uint32_t GetState() const {
+        return *value;
+    }
+
+    void Update(uint32_t) {
+        Base::Notify();
+    }
+
+    // Tells observers about a write made directly to the register file
+    void changed() {
+        Base::Notify();
+    }
+
+protected:
+    uint32_t* value;
+};
+
+// Flags32-like handle onto the flags of a RegisterFile32. Reads resolve any flags
+// the CPU still owes; writes settle them first.
+template <typename Policy>
+class FlagsView32 : public RegisterView32<Policy>, public FlagBits32 {
+public:
+    explicit FlagsView32(RegisterFile32* file) : RegisterView32<Policy>(&file->flags), file(file) {}
+
+    void loadValue(uint32_t newValue) {
+        file->lazyFlags.clear();
+        RegisterView32<Policy>::loadValue(newValue);
+    }
+
+    uint32_t GetState() const {
+        return getFlags();
+    }
+
+    void setFlag(Flags flag) {
+        file->resolveFlags();
+        file->flags |= flag;
+    }
+
+    void clearFlag(Flags flag) {
+        file->resolveFlags();
+        file->flags &= ~flag;
+    }
+
+    void setFlags(uint32_t flags) {
+        file->lazyFlags.clear();
+        file->flags = flags;
+    }
+
+    bool isFlagSet(Flags flag) const {
+        return file->lazyFlags.isSet(flag, file->flags);
+    }
+
+    uint32_t getFlags() const {
+        return file->lazyFlags.resolve(file->flags);
+    }
+
+    std::string getFlagNames() const {
+        return names(getFlags());
+    }
+
+private:
+    RegisterFile32* file;
+};
+
+#endif //CPUSIMULATOR_REGISTERFILE32_HPP
@@ -0,0 +1,123 @@
+#include <CPU32/CPU32.hpp>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#ifndef CPUSIMULATOR_SCHEDULER32_HPP
+#define CPUSIMULATOR_SCHEDULER32_HPP
+
+// A guest's run as a coroutine (see Scheduler32). It starts suspended, is resumed by
+// whoever owns it, and owns its frame.
+class GuestTask32 {
+public:
+    struct promise_type {
+        GuestTask32 get_return_object() {
+            return GuestTask32(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { throw; }
+    };
+
+    GuestTask32() = default;
+    GuestTask32(GuestTask32&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    GuestTask32& operator=(GuestTask32&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+    ~GuestTask32() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    void resume() { handle.resume(); }
+    bool done() const { return !handle || handle.done(); }
+
+private:
+    explicit GuestTask32(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Multiplexes many guests on the calling thread. Each guest's run is a coroutine that
+// runs its CPU a slice of instructions at a time and suspends when
+//   - the slice runs out: it goes to the back of the ready queue,
+//   - an IN or OUT finds its device not ready (IOWait): it is resumed as soon as run()
+//     sees the device ready, and retries the instruction,
+//   - it halts, faults, reaches a breakpoint or uses up its own budget: it finishes.
+// A guest costs its CPU and one coroutine frame; no host thread or stack is involved.
+class Scheduler32 {
+public:
+    using GuestId = size_t;
+    static constexpr uint64_t DEFAULT_SLICE = 1u << 14;
+
+    explicit Scheduler32(uint64_t slice = DEFAULT_SLICE);
+
+    Scheduler32(const Scheduler32&) = delete;
+    Scheduler32& operator=(const Scheduler32&) = delete;
+
+    // Adds a guest that continues from the CPU's current state. maxInstructions bounds
+    // its whole run, across slices and calls to run().
+    GuestId spawn(std::shared_ptr<FastCPU32> cpu, uint64_t maxInstructions = FastCPU32::UNLIMITED);
+
+    // Runs guests until every one has finished or waits on a device that is not ready.
+    // Returns how many are left waiting: feed their devices and call again to go on.
+    size_t run();
+
+    size_t size() const { return guests.size(); }
+    bool finished(GuestId id) const { return guests.at(id)->finished; }
+    // Totals over the guest's run so far; once it has finished, reason says why
+    const RunResult32& result(GuestId id) const { return guests.at(id)->result; }
+    FastCPU32& cpu(GuestId id) { return *guests.at(id)->cpu; }
+
+private:
+    struct Guest {
+        std::shared_ptr<FastCPU32> cpu;
+        uint64_t budget;
+        RunResult32 result;
+        GuestTask32 task;
+        bool finished = false;
+        // The instruction the guest waits on: IN or OUT, or 0 for a stop requested
+        // from outside, which is ready straight away
+        uint8_t waitOpcode = 0;
+        uint8_t waitPort = 0;
+    };
+
+    // What a guest coroutine awaits to give up the thread: back into the ready queue,
+    // or onto the waiting list
+    struct Suspend {
+        Scheduler32& scheduler;
+        Guest& guest;
+        bool waiting;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>) const {
+            if (waiting) {
+                scheduler.waiting.push_back(&guest);
+            } else {
+                scheduler.ready.push_back(&guest);
+            }
+        }
+        void await_resume() const noexcept {}
+    };
+
+    uint64_t slice;
+    std::vector<std::unique_ptr<Guest>> guests;
+    std::deque<Guest*> ready;
+    std::vector<Guest*> waiting;
+
+    GuestTask32 execute(Guest& guest);
+    bool deviceReady(const Guest& guest) const;
+};
+
+#endif //CPUSIMULATOR_SCHEDULER32_HPP
@@ -0,0 +1,31 @@
+#include <CPU32/Vector32.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#ifndef CPUSIMULATOR_SNAPSHOT32_HPP
+#define CPUSIMULATOR_SNAPSHOT32_HPP
+
+// An incremental checkpoint of a CPU32: its architectural state plus the memory
+// pages written since the previous snapshot (see Memory32::dirtyPages). Sequence 0
+// carries every page written since the memory was created, later snapshots only
+// what changed after the one before, so their cost follows the working set rather
+// than the memory size. Restoring means applying 0, 1, 2, ... in order.
+struct Snapshot32 {
+    uint64_t sequence = 0;
+    uint64_t memorySize = 0; // restoring needs a memory of the same size
+
+    std::array<uint32_t, 16> registers{};
+    uint32_t pc = 0;
+    uint32_t sp = 0;
+    uint32_t flags = 0; // resolved, nothing owed
+    bool halted = false;
+    std::array<Vector32, 16> vectors{};
+
+    // Page indices, ascending, and their contents back to back, PAGE_WORDS each.
+    // A last page running past the end of memory is padded with zeros.
+    std::vector<uint32_t> pages;
+    std::vector<uint32_t> words;
+};
+
+#endif //CPUSIMULATOR_SNAPSHOT32_HPP
@@ -0,0 +1,107 @@
+#include <cstddef>
+#include <cstdint>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef CPUSIMULATOR_VECTOR32_HPP
+#define CPUSIMULATOR_VECTOR32_HPP
+
+// One 128-bit vector register: four 32-bit lanes, lane 0 loaded from the lowest address
+struct alignas(16) Vector32 {
+    static constexpr size_t LANES = 4;
+
+    uint32_t lane[LANES];
+
+    bool operator==(const Vector32&) const = default;
+};
+
+// Lane-wise arithmetic on vector registers. SSE2 is part of x86-64, so there every
+// operation is one or two 128-bit host instructions; other hosts get plain loops over
+// the lanes. The operation is a template argument, so nothing switches at run time.
+struct VectorALU32 {
+    // CMPEQ and CMPGT (signed) set a lane to all ones where the comparison holds and
+    // to zero elsewhere
+    enum Operation { ADD, SUB, AND, OR, XOR, CMPEQ, CMPGT };
+
+    template <Operation op>
+    static Vector32 apply(const Vector32& a, const Vector32& b) {
+        Vector32 result;
+#if defined(__SSE2__)
+        __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(a.lane));
+        __m128i y = _mm_load_si128(reinterpret_cast<const __m128i*>(b.lane));
+        __m128i r;
+        if constexpr (op == ADD) {
+            r = _mm_add_epi32(x, y);
+        } else if constexpr (op == SUB) {
+            r = _mm_sub_epi32(x, y);
+        } else if constexpr (op == AND) {
+            r = _mm_and_si128(x, y);
+        } else if constexpr (op == OR) {
+            r = _mm_or_si128(x, y);
+        } else if constexpr (op == XOR) {
+            r = _mm_xor_si128(x, y);
+        } else if constexpr (op == CMPEQ) {
+            r = _mm_cmpeq_epi32(x, y);
+        } else {
+            r = _mm_cmpgt_epi32(x, y);
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(result.lane), r);
+#else
+        for (size_t i = 0; i < Vector32::LANES; ++i) {
+            uint32_t x = a.lane[i];
+            uint32_t y = b.lane[i];
+            if constexpr (op == ADD) {
+                result.lane[i] = x + y;
+            } else if constexpr (op == SUB) {
+                result.lane[i] = x - y;
+            } else if constexpr (op == AND) {
+                result.lane[i] = x & y;
+            } else if constexpr (op == OR) {
+                result.lane[i] = x | y;
+            } else if constexpr (op == XOR) {
+                result.lane[i] = x ^ y;
+            } else if constexpr (op == CMPEQ) {
+                result.lane[i] = x == y ? ~0u : 0u;
+            } else {
+                result.lane[i] = static_cast<int32_t>(x) > static_cast<int32_t>(y) ? ~0u : 0u;
+            }
+        }
+#endif
+        return result;
+    }
+
+    // Every lane set to `value`
+    static Vector32 splat(uint32_t value) {
+        return {{value, value, value, value}};
+    }
+
+    // Wrapping sum of the lanes
+    static uint32_t sum(const Vector32& v) {
+#if defined(__SSE2__)
+        __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(v.lane));
+        x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+        x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(x));
+#else
+        return v.lane[0] + v.lane[1] + v.lane[2] + v.lane[3];
+#endif
+    }
+
+    // Bit n set where lane n is non-zero
+    static uint32_t nonZeroLanes(const Vector32& v) {
+#if defined(__SSE2__)
+        __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(v.lane));
+        __m128i zero = _mm_cmpeq_epi32(x, _mm_setzero_si128());
+        return static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(zero))) ^ 0xF;
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < Vector32::LANES; ++i) {
+            mask |= (v.lane[i] != 0 ? 1u : 0u) << i;
+        }
+        return mask;
+#endif
+    }
+};
+
+#endif //CPUSIMULATOR_VECTOR32_HPP
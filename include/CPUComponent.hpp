@@ -38,4 +38,23 @@ public:
 
 };
 
+// Base for components built without observation: Notify() compiles to nothing
+// and nothing is virtual, so the component is a plain value.
+class UnobservedComponent
+{
+protected:
+    void Notify() {}
+};
+
+// Observation policies, chosen at compile time by the CPU32 components
+struct Observed {
+    using Base = CPUComponent;
+    static constexpr bool notifies = true;
+};
+
+struct NoObservers {
+    using Base = UnobservedComponent;
+    static constexpr bool notifies = false;
+};
+
 #endif //CPUSIMULATOR_CPUCOMPONENT_HPP
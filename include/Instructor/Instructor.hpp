@@ -20,6 +20,7 @@ private:
     std::vector<std::string> tokenize(const std::string& line);
     void initializeOpcodeMap();
     uint32_t parseRegister(const std::string& reg);
+    uint32_t parseVectorRegister(const std::string& reg);
     uint32_t parseImmediate(const std::string& imm, int bitSize);
     void resolveLabels(std::vector<uint32_t>& instructions);
     uint32_t getOpcode(const std::vector<std::string>& tokens);
@@ -0,0 +1,132 @@
+#include <CPU32/Batch32.hpp>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+// A thread's share of the jobs: [begin, end) packed as begin | end << 32, so that the
+// owner taking one and a thief taking half are each a single compare-and-swap
+struct alignas(64) JobRange {
+    std::atomic<uint64_t> range{0};
+};
+
+uint64_t pack(uint32_t begin, uint32_t end) {
+    return begin | static_cast<uint64_t>(end) << 32;
+}
+
+bool take(JobRange& own, uint32_t& job) {
+    uint64_t current = own.range.load(std::memory_order_acquire);
+    while (true) {
+        auto begin = static_cast<uint32_t>(current);
+        auto end = static_cast<uint32_t>(current >> 32);
+        if (begin >= end) {
+            return false;
+        }
+        if (own.range.compare_exchange_weak(current, pack(begin + 1, end), std::memory_order_acq_rel)) {
+            job = begin;
+            return true;
+        }
+    }
+}
+
+// Moves the back half (at least one job) of victim's range into own, which is empty.
+// Job indices are never reused, so a stale range cannot reappear and fool the CAS.
+bool steal(JobRange& victim, JobRange& own) {
+    uint64_t current = victim.range.load(std::memory_order_acquire);
+    while (true) {
+        auto begin = static_cast<uint32_t>(current);
+        auto end = static_cast<uint32_t>(current >> 32);
+        if (begin >= end) {
+            return false;
+        }
+        uint32_t middle = begin + (end - begin) / 2;
+        if (victim.range.compare_exchange_weak(current, pack(begin, middle), std::memory_order_acq_rel)) {
+            own.range.store(pack(middle, end), std::memory_order_release);
+            return true;
+        }
+    }
+}
+
+} // namespace
+
+BatchRunner32::BatchRunner32(size_t threads)
+        : threadCount(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+std::vector<BatchResult32> BatchRunner32::run(std::span<const BatchJob32> jobs, const BatchOptions32& options) const {
+    if (jobs.size() > UINT32_MAX) {
+        throw std::invalid_argument("Too many jobs in one batch");
+    }
+    std::vector<BatchResult32> results(jobs.size());
+    size_t workers = std::min(threadCount, jobs.size());
+    if (workers == 0) {
+        return results;
+    }
+
+    std::vector<JobRange> ranges(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        ranges[i].range.store(pack(static_cast<uint32_t>(jobs.size() * i / workers),
+                                   static_cast<uint32_t>(jobs.size() * (i + 1) / workers)));
+    }
+
+    auto work = [&](size_t self) {
+        uint32_t job;
+        while (true) {
+            while (take(ranges[self], job)) {
+                results[job] = runOne(jobs[job], options);
+            }
+            // Out of work: try everyone else once, starting with the next thread. A
+            // range in flight between a victim and its thief is missed, but the thief
+            // runs it, so stopping after a fruitless pass loses nothing.
+            bool stole = false;
+            for (size_t step = 1; step < workers && !stole; ++step) {
+                stole = steal(ranges[(self + step) % workers], ranges[self]);
+            }
+            if (!stole) {
+                return;
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(workers - 1);
+        for (size_t i = 1; i < workers; ++i) {
+            threads.emplace_back(work, i);
+        }
+        work(0);
+    }
+    return results;
+}
+
+BatchResult32 BatchRunner32::runOne(const BatchJob32& job, const BatchOptions32& options) {
+    BatchResult32 result;
+    try {
+        if (!job.program) {
+            throw std::invalid_argument("Job has no program");
+        }
+        FastCPU32 cpu(options.memorySize, options.memoryMode);
+        cpu.SetDispatchMode(options.dispatchMode);
+        const auto& program = *job.program;
+        auto inputAddress = static_cast<uint32_t>((program.size() + Memory32::PAGE_MASK) & ~size_t(Memory32::PAGE_MASK));
+        cpu.GetMemory()->storeBlock(0, program);
+        cpu.GetMemory()->storeBlock(inputAddress, job.input);
+        cpu.GetRegisters()[0]->loadValue(inputAddress);
+        cpu.GetRegisters()[1]->loadValue(static_cast<uint32_t>(job.input.size()));
+        cpu.GetProgramCounter()->loadValue(0);
+
+        RunResult32 run = cpu.run(options.maxInstructions);
+        result.reason = run.reason;
+        result.instructions = run.instructions;
+        result.fault = std::move(run.fault);
+        for (size_t i = 0; i < result.registers.size(); ++i) {
+            result.registers[i] = cpu.GetRegisters()[i]->GetState();
+        }
+        result.pc = cpu.GetProgramCounter()->GetState();
+        result.memoryDigest = cpu.GetMemory()->digest();
+    } catch (const std::exception& error) {
+        result.reason = StopReason32::Fault;
+        result.fault = error.what();
+    }
+    return result;
+}
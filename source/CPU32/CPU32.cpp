@@ -4,431 +4,1236 @@
 
 #include <CPU32/CPU32.hpp>
 #include <iostream>
-
-CPU32::CPU32(size_t memorySize)
-        : instruction(0), immediateOperand(0), returnAddress(0), halted(false) {
-    memory = std::make_shared<Memory32>(memorySize);
-    clock = std::make_shared<Clock32>(1);
-    programCounter = std::make_shared<Register32>();
-    alu = std::make_shared<ALU32>();
-    flagsRegister = std::make_shared<Flags32>();
+#include <algorithm>
+#include <atomic>
+#include <bit>
+
+template <typename Policy>
+BasicCPU32<Policy>::BasicCPU32(size_t memorySize, Memory32::Mode memoryMode)
+        : BasicCPU32(std::make_shared<Memory32>(memorySize, memoryMode)) {}
+
+template <typename Policy>
+BasicCPU32<Policy>::BasicCPU32(std::shared_ptr<Memory32> mem)
+        : instruction(0), immediateOperand(0), returnAddress(0), halted(false),
+          dispatchMode(DispatchMode::Blocks), memory(std::move(mem)) {
+    bus = std::make_shared<Bus32>(memory);
+    decodeCache = std::make_shared<DecodeCache32<Handler>>(memory);
+    blockCache = std::make_shared<BlockCache32<Handler>>(memory);
+    clock = std::make_shared<ClockType>(1);
+    interrupts = std::make_shared<InterruptController32>([clock = clock] { return clock->GetCycles(); });
+    registerFile = std::make_shared<RegisterFile32>();
+    programCounter = std::make_shared<RegisterType>(&registerFile->pc);
+    alu = std::make_shared<ALUType>();
+    flagsRegister = std::make_shared<FlagsType>(registerFile.get());
 
     // Initialize 16 General Purpose Registers (We really don't need more than this!)
     for (int i = 0; i < 16; ++i) {
-        registers.push_back(std::make_shared<Register32>());
+        registers.push_back(std::make_shared<RegisterType>(&registerFile->registers[i]));
     }
 
     // Initialize the stack pointer (register 15)
-    stackPointer = std::make_shared<Register32>();
-    stackPointer->loadValue(memorySize);  // Stack pointer starts at the end of memory
+    stackPointer = std::make_shared<RegisterType>(&registerFile->sp);
+    setStackPointer(static_cast<uint32_t>(memory->getSize()));  // Stack pointer starts at the end of memory (0 for a full address space)
 
 
     // Populate opcode map
-    opcodeMap[0x00] = &CPU32::nop;
-    opcodeMap[0x01] = &CPU32::movRegisterToRegister;
-    opcodeMap[0x02] = &CPU32::movImmediateToRegister;
-    opcodeMap[0x03] = &CPU32::load;
-    opcodeMap[0x04] = &CPU32::store;
-    opcodeMap[0x05] = &CPU32::add;
-    opcodeMap[0x06] = &CPU32::sub;
-    opcodeMap[0x07] = &CPU32::andOp;
-    opcodeMap[0x08] = &CPU32::orOp;
-    opcodeMap[0x09] = &CPU32::xorOp;
-    opcodeMap[0x0A] = &CPU32::notOp;
-    opcodeMap[0x10] = &CPU32::cmpImmediateToRegister;
-    opcodeMap[0x11] = &CPU32::cmpRegisterToRegister;
-    opcodeMap[0x12] = &CPU32::jmp;
-    opcodeMap[0x13] = &CPU32::jz;
-    opcodeMap[0x14] = &CPU32::jnz;
-    opcodeMap[0x15] = &CPU32::jl;
-    opcodeMap[0x16] = &CPU32::jg;
-    opcodeMap[0x17] = &CPU32::jle;
-    opcodeMap[0x18] = &CPU32::jge;
-    opcodeMap[0x30] = &CPU32::call;
-    opcodeMap[0x31] = &CPU32::ret;
-    opcodeMap[0x32] = & CPU32::push;
-    opcodeMap[0x33] = & CPU32::pop;
-    opcodeMap[0x40] = &CPU32::inOp;
-    opcodeMap[0x41] = &CPU32::outOp;
-    opcodeMap[0xE2] = &CPU32::movImmediate32ToRegister;
-    opcodeMap[0xE4] = &CPU32::storeImmediate32;
-    opcodeMap[0xE5] = &CPU32::addImmediate;
-    opcodeMap[0xFF] = &CPU32::hlt;
-}
-
-void CPU32::loadInstruction(uint32_t instruction, uint32_t immediate) {
+    opcodeMap[0x00] = &BasicCPU32::nop;
+    opcodeMap[0x01] = &BasicCPU32::movRegisterToRegister;
+    opcodeMap[0x02] = &BasicCPU32::movImmediateToRegister;
+    opcodeMap[0x03] = &BasicCPU32::load;
+    opcodeMap[0x04] = &BasicCPU32::store;
+    opcodeMap[0x05] = &BasicCPU32::add;
+    opcodeMap[0x06] = &BasicCPU32::sub;
+    opcodeMap[0x07] = &BasicCPU32::andOp;
+    opcodeMap[0x08] = &BasicCPU32::orOp;
+    opcodeMap[0x09] = &BasicCPU32::xorOp;
+    opcodeMap[0x0A] = &BasicCPU32::notOp;
+    opcodeMap[0x10] = &BasicCPU32::cmpImmediateToRegister;
+    opcodeMap[0x11] = &BasicCPU32::cmpRegisterToRegister;
+    opcodeMap[0x12] = &BasicCPU32::jmp;
+    opcodeMap[0x13] = &BasicCPU32::jz;
+    opcodeMap[0x14] = &BasicCPU32::jnz;
+    opcodeMap[0x15] = &BasicCPU32::jl;
+    opcodeMap[0x16] = &BasicCPU32::jg;
+    opcodeMap[0x17] = &BasicCPU32::jle;
+    opcodeMap[0x18] = &BasicCPU32::jge;
+    opcodeMap[0x20] = &BasicCPU32::multiply;
+    opcodeMap[0x21] = &BasicCPU32::multiplyHigh;
+    opcodeMap[0x22] = &BasicCPU32::multiplyHighSigned;
+    opcodeMap[0x23] = &BasicCPU32::divide;
+    opcodeMap[0x24] = &BasicCPU32::modulo;
+    opcodeMap[0x25] = &BasicCPU32::divideSigned;
+    opcodeMap[0x26] = &BasicCPU32::moduloSigned;
+    opcodeMap[0x27] = &BasicCPU32::shiftLeft;
+    opcodeMap[0x28] = &BasicCPU32::shiftRight;
+    opcodeMap[0x29] = &BasicCPU32::shiftRightArithmetic;
+    opcodeMap[0x2A] = &BasicCPU32::rotateLeft;
+    opcodeMap[0x2B] = &BasicCPU32::rotateRight;
+    opcodeMap[0x2C] = &BasicCPU32::popCount;
+    opcodeMap[0x2D] = &BasicCPU32::countLeadingZeros;
+    opcodeMap[0x30] = &BasicCPU32::call;
+    opcodeMap[0x31] = &BasicCPU32::ret;
+    opcodeMap[0x32] = & BasicCPU32::push;
+    opcodeMap[0x33] = & BasicCPU32::pop;
+    opcodeMap[0x50] = &BasicCPU32::blockMove;
+    opcodeMap[0x51] = &BasicCPU32::blockFill;
+    opcodeMap[0x52] = &BasicCPU32::blockCompare;
+    opcodeMap[0x60] = &BasicCPU32::compareAndSwap;
+    opcodeMap[0x61] = &BasicCPU32::exchangeAdd;
+    opcodeMap[0x62] = &BasicCPU32::fence;
+    opcodeMap[0x70] = &BasicCPU32::enableInterrupts;
+    opcodeMap[0x71] = &BasicCPU32::disableInterrupts;
+    opcodeMap[0x72] = &BasicCPU32::interruptReturn;
+    opcodeMap[0x80] = &BasicCPU32::vectorLoad;
+    opcodeMap[0x81] = &BasicCPU32::vectorStore;
+    opcodeMap[0x82] = &BasicCPU32::vectorAdd;
+    opcodeMap[0x83] = &BasicCPU32::vectorSub;
+    opcodeMap[0x84] = &BasicCPU32::vectorAnd;
+    opcodeMap[0x85] = &BasicCPU32::vectorOr;
+    opcodeMap[0x86] = &BasicCPU32::vectorXor;
+    opcodeMap[0x87] = &BasicCPU32::vectorCompareEqual;
+    opcodeMap[0x88] = &BasicCPU32::vectorCompareGreater;
+    opcodeMap[0x89] = &BasicCPU32::vectorSum;
+    opcodeMap[0x8A] = &BasicCPU32::vectorSplat;
+    opcodeMap[0x40] = &BasicCPU32::inOp;
+    opcodeMap[0x41] = &BasicCPU32::outOp;
+    opcodeMap[0xE2] = &BasicCPU32::movImmediate32ToRegister;
+    opcodeMap[0xE4] = &BasicCPU32::storeImmediate32;
+    opcodeMap[0xE5] = &BasicCPU32::addImmediate;
+    opcodeMap[0xFF] = &BasicCPU32::hlt;
+
+    // Flatten the map into the dispatch table; every unassigned slot traps
+    dispatchTable.fill(&BasicCPU32::trap);
+    for (const auto& [opcode, handler] : opcodeMap) {
+        dispatchTable[opcode] = handler;
+    }
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::loadInstruction(uint32_t instruction, uint32_t immediate) {
     this->instruction = instruction;
     this->immediateOperand = immediate;
+    instructionPC = registerFile->pc; // Not fetched, so nothing to wind back to
 }
 
-void CPU32::tickClock() {
+template <typename Policy>
+void BasicCPU32<Policy>::tickClock() {
     clock->tick();
+#if CPU32_PROFILING
+    if (profiler) {
+        uint32_t pc = registerFile->pc;
+        fetch();
+        uint32_t nextPC = registerFile->pc;
+        decodeExecute();
+        profiler->retire(pc, (instruction >> 24) & 0xFF, nextPC, registerFile->pc);
+        return;
+    }
+#endif
     fetch();
     decodeExecute();
 }
 
-void CPU32::run() {
-    while (!halted) {
+template <typename Policy>
+void BasicCPU32<Policy>::run() {
+    syncMemory();
+    interrupts->setEnabled(registerFile->flags & FlagBits32::INTERRUPT);
+    if (dispatchMode == DispatchMode::Blocks || dispatchMode == DispatchMode::JIT) {
+        runBlocks(UNLIMITED, nullptr, false);
+        bus->flush();
+        return;
+    }
+#if CPU32_THREADED_DISPATCH
+    if (dispatchMode == DispatchMode::Threaded && !profiling()) {
+        runThreaded();
+        stopRequested = false;
+        bus->flush();
+        return;
+    }
+#endif
+    while (true) {
+        if (halted || interruptDue()) {
+            serviceInterrupts();
+        }
+        if (halted || stopRequested) {
+            break;
+        }
         tickClock();
     }
+    stopRequested = false;
+    bus->flush();
+}
+
+template <typename Policy>
+RunResult32 BasicCPU32<Policy>::run(uint64_t maxInstructions) {
+    return runBounded(maxInstructions, nullptr);
+}
+
+template <typename Policy>
+RunResult32 BasicCPU32<Policy>::runUntil(Deadline deadline, uint64_t maxInstructions) {
+    return runBounded(maxInstructions, &deadline);
+}
+
+template <typename Policy>
+RunResult32 BasicCPU32<Policy>::runBounded(uint64_t maxInstructions, const Deadline* deadline) {
+    syncMemory();
+    interrupts->setEnabled(registerFile->flags & FlagBits32::INTERRUPT);
+    RunResult32 result = dispatchMode == DispatchMode::Blocks || dispatchMode == DispatchMode::JIT
+                         ? runBlocks(maxInstructions, deadline, true)
+                         : runSteps(maxInstructions, deadline);
+    // Buffered device output goes out once per run rather than once per OUT
+    bus->flush();
+    return result;
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::syncMemory() {
+    if (memory->isConcurrent()) {
+        memory->claim(decodeCache.get());
+        memory->claim(blockCache.get());
+        memory->deliverWrites();
+    }
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::addBreakpoint(uint32_t address) {
+    if (breakpoints.insert(address).second) {
+        // Blocks end just before breakpoints, so existing ones may now be too long
+        blockCache->clear();
+    }
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::removeBreakpoint(uint32_t address) {
+    breakpoints.erase(address);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::clearBreakpoints() {
+    breakpoints.clear();
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::requestStop(StopReason reason) {
+    stopRequested = true;
+    requestedStop = reason;
+}
+
+template <typename Policy>
+bool BasicCPU32<Policy>::shouldStop(uint64_t retired, RunLimits& limits, RunResult32& result) {
+    if (halted || interruptDue()) {
+        serviceInterrupts();
+    }
+    if (halted) {
+        result.reason = StopReason::Halted;
+    } else if (stopRequested) {
+        stopRequested = false;
+        result.reason = requestedStop;
+    } else if (retired >= limits.maxInstructions) {
+        result.reason = StopReason::BudgetExhausted;
+    } else if (limits.checkBreakpoints && retired > 0 && breakpoints.count(registerFile->pc)) {
+        result.reason = StopReason::Breakpoint;
+    } else if (limits.deadline && limits.boundaries++ % DEADLINE_STRIDE == 0 &&
+               std::chrono::steady_clock::now() >= *limits.deadline) {
+        result.reason = StopReason::BudgetExhausted;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+template <typename Policy>
+RunResult32 BasicCPU32<Policy>::runSteps(uint64_t maxInstructions, const Deadline* deadline) {
+    // Dispatch modes without blocks check their limits before every instruction
+    RunResult32 result;
+    RunLimits limits{maxInstructions, deadline, !breakpoints.empty()};
+    uint64_t startCycles = clock->GetCycles();
+    uint64_t retired = 0;
+    while (true) {
+        uint32_t pc = registerFile->pc;
+        try {
+            // Taking an interrupt can fault too, with the PC still where it was
+            if (shouldStop(retired, limits, result)) {
+                break;
+            }
+            pc = registerFile->pc;
+            tickClock();
+        } catch (const std::exception& e) {
+            setProgramCounter(pc);
+            result.reason = StopReason::Fault;
+            result.fault = e.what();
+            break;
+        }
+        ++retired;
+    }
+    result.instructions = retired;
+    result.cycles = clock->GetCycles() - startCycles;
+    return result;
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::SetDispatchMode(DispatchMode mode) {
+    if (mode == DispatchMode::Threaded && !CPU32_THREADED_DISPATCH) {
+        mode = DispatchMode::Table;
+    }
+    if (mode == DispatchMode::JIT) {
+        if (!CPU32_JIT_AVAILABLE) {
+            mode = DispatchMode::Blocks;
+        } else if (!jit) {
+            jit = std::make_shared<JIT32>();
+        }
+    }
+    dispatchMode = mode;
+}
+
+template <typename Policy>
+typename BasicCPU32<Policy>::DispatchMode BasicCPU32<Policy>::GetDispatchMode() const {
+    return dispatchMode;
+}
+
+#if CPU32_PROFILING
+template <typename Policy>
+void BasicCPU32<Policy>::SetProfiler(std::shared_ptr<Profiler32> profiler) {
+    this->profiler = std::move(profiler);
+}
+
+template <typename Policy>
+std::shared_ptr<Profiler32> BasicCPU32<Policy>::GetProfiler() const {
+    return profiler;
+}
+#endif
+
+template <typename Policy>
+void BasicCPU32<Policy>::loadProgram(const std::vector<uint32_t>& program, uint32_t startAddress) {
+    memory->storeBlock(startAddress, program);
+    setProgramCounter(startAddress);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::loadImage(const std::string& path, uint32_t startAddress) {
+    memory->mapImage(path, startAddress);
+    setProgramCounter(startAddress);
+}
+
+template <typename Policy>
+Snapshot32 BasicCPU32<Policy>::snapshot() {
+    Snapshot32 result;
+    result.sequence = nextSnapshot++;
+    result.memorySize = memory->getSize();
+    std::copy(std::begin(registerFile->registers), std::end(registerFile->registers), result.registers.begin());
+    result.pc = registerFile->pc;
+    result.sp = registerFile->sp;
+    result.flags = registerFile->lazyFlags.resolve(registerFile->flags);
+    result.halted = halted;
+    std::copy(std::begin(registerFile->vectors), std::end(registerFile->vectors), result.vectors.begin());
+
+    result.pages = memory->dirtyPages();
+    result.words.resize(result.pages.size() * Memory32::PAGE_WORDS);
+    for (size_t i = 0; i < result.pages.size(); ++i) {
+        uint32_t address = result.pages[i] << Memory32::PAGE_SHIFT;
+        size_t count = std::min<size_t>(Memory32::PAGE_WORDS, memory->getSize() - address);
+        memory->loadBlock(address, std::span<uint32_t>(result.words.data() + i * Memory32::PAGE_WORDS, count));
+    }
+    memory->clearDirty();
+    return result;
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::restore(const Snapshot32& snapshot) {
+    if (snapshot.memorySize != memory->getSize()) {
+        throw std::invalid_argument("Snapshot is of a different memory size");
+    }
+    if (snapshot.sequence != 0 && snapshot.sequence != nextSnapshot) {
+        throw std::invalid_argument("Snapshots must be restored in sequence");
+    }
+    if (snapshot.words.size() != snapshot.pages.size() * Memory32::PAGE_WORDS) {
+        throw std::invalid_argument("Snapshot pages and contents do not match");
+    }
+    for (uint32_t page : snapshot.pages) {
+        if ((static_cast<uint64_t>(page) << Memory32::PAGE_SHIFT) >= memory->getSize()) {
+            throw std::out_of_range("Snapshot page lies outside memory");
+        }
+    }
+
+    if (snapshot.sequence == 0) {
+        memory->reset();
+    }
+    for (size_t i = 0; i < snapshot.pages.size(); ++i) {
+        uint32_t address = snapshot.pages[i] << Memory32::PAGE_SHIFT;
+        size_t count = std::min<size_t>(Memory32::PAGE_WORDS, memory->getSize() - address);
+        memory->storeBlock(address,
+                           std::span<const uint32_t>(snapshot.words.data() + i * Memory32::PAGE_WORDS, count));
+    }
+
+    for (uint8_t i = 0; i < 16; ++i) {
+        writeRegister(i, snapshot.registers[i]);
+    }
+    setProgramCounter(snapshot.pc);
+    setStackPointer(snapshot.sp);
+    flagsRegister->loadValue(snapshot.flags);
+    halted = snapshot.halted;
+    std::copy(snapshot.vectors.begin(), snapshot.vectors.end(), std::begin(registerFile->vectors));
+
+    // Memory now matches the snapshot exactly, so the next interval starts here
+    memory->clearDirty();
+    nextSnapshot = snapshot.sequence + 1;
 }
 
-void CPU32::loadProgram(const std::vector<uint32_t>& program, uint32_t startAddress) {
-    for (size_t i = 0; i < program.size(); ++i) {
-        memory->store(startAddress + i, program[i]);
+template <typename Policy>
+void BasicCPU32<Policy>::saveCheckpoint(const std::string& path) const {
+    CheckpointHeader32 state{};
+    std::copy(std::begin(registerFile->registers), std::end(registerFile->registers), state.registers);
+    state.pc = registerFile->pc;
+    state.sp = registerFile->sp;
+    state.flags = registerFile->lazyFlags.resolve(registerFile->flags);
+    state.halted = halted;
+    for (uint8_t i = 0; i < 16; ++i) {
+        std::copy(std::begin(registerFile->vectors[i].lane), std::end(registerFile->vectors[i].lane), state.vectors[i]);
     }
-    programCounter->loadValue(startAddress);
+    Checkpoint32::save(path, state, *memory);
 }
 
-std::vector<std::shared_ptr<Register32>> CPU32::GetRegisters() const {
+template <typename Policy>
+void BasicCPU32<Policy>::loadCheckpoint(const std::string& path) {
+    CheckpointHeader32 state = Checkpoint32::load(path, *memory);
+    for (uint8_t i = 0; i < 16; ++i) {
+        writeRegister(i, state.registers[i]);
+    }
+    setProgramCounter(state.pc);
+    setStackPointer(state.sp);
+    flagsRegister->loadValue(state.flags);
+    halted = state.halted != 0;
+    for (uint8_t i = 0; i < 16; ++i) {
+        std::copy(std::begin(state.vectors[i]), std::end(state.vectors[i]), registerFile->vectors[i].lane);
+    }
+
+    memory->clearDirty();
+    nextSnapshot = 1;
+}
+
+template <typename Policy>
+BasicCPU32<Policy> BasicCPU32<Policy>::fork() const {
+    BasicCPU32 child(memory->fork());
+    *child.registerFile = *registerFile;
+    child.bus = bus->fork(child.memory, child.interrupts);
+    child.halted = halted;
+    child.SetDispatchMode(dispatchMode);
+    child.breakpoints = breakpoints;
+    child.nextSnapshot = nextSnapshot;
+    child.interrupts->setVectorTable(interrupts->vectorTable());
+    for (uint32_t lines = interrupts->pending(); lines; lines &= lines - 1) {
+        child.interrupts->raise(std::countr_zero(lines));
+    }
+    return child;
+}
+
+template <typename Policy>
+const std::vector<std::shared_ptr<typename BasicCPU32<Policy>::RegisterType>>& BasicCPU32<Policy>::GetRegisters() const {
     return registers;
 }
 
-std::shared_ptr<Register32> CPU32::GetProgramCounter() const {
+template <typename Policy>
+std::shared_ptr<typename BasicCPU32<Policy>::RegisterType> BasicCPU32<Policy>::GetProgramCounter() const {
     return programCounter;
 }
 
-std::shared_ptr<Memory32> CPU32::GetMemory() const {
+template <typename Policy>
+std::shared_ptr<Bus32> BasicCPU32<Policy>::GetBus() const {
+    return bus;
+}
+
+template <typename Policy>
+std::shared_ptr<InterruptController32> BasicCPU32<Policy>::GetInterrupts() const {
+    return interrupts;
+}
+
+template <typename Policy>
+std::shared_ptr<Memory32> BasicCPU32<Policy>::GetMemory() const {
     return memory;
 }
 
-std::shared_ptr<Flags32> CPU32::GetFlagsRegister() const {
+template <typename Policy>
+std::shared_ptr<typename BasicCPU32<Policy>::FlagsType> BasicCPU32<Policy>::GetFlagsRegister() const {
     return flagsRegister;
 }
 
-std::shared_ptr<Register32> CPU32::GetStackPointer() const {
+template <typename Policy>
+std::shared_ptr<typename BasicCPU32<Policy>::RegisterType> BasicCPU32<Policy>::GetStackPointer() const {
     return stackPointer;
 }
 
+template <typename Policy>
+const RegisterFile32& BasicCPU32<Policy>::GetRegisterFile() const {
+    return *registerFile;
+}
 
-void CPU32::fetch() {
-    uint32_t pc = programCounter->GetState();
-    instruction = memory->load(pc);
+template <typename Policy>
+void BasicCPU32<Policy>::fetch() {
+    const DecodedInstruction& entry = lookupDecoded(registerFile->pc);
+    instructionPC = registerFile->pc;
+    instruction = entry.instruction;
+    immediateOperand = entry.immediate;
+    addressOperand = entry.address;
+    setProgramCounter(entry.nextPC);
+}
 
-    // Set the program counter to the next instruction unless it's a jump or storeImmediate32
-    uint8_t opcode = (instruction >> 24) & 0xFF;
-    if (opcode != 0x12 && opcode != 0x13 && opcode != 0x14 && opcode != 0x15 && opcode != 0x16 && opcode != 0x17 && opcode != 0x18 && opcode != 0xE4) {
-        programCounter->loadValue(pc + 1);
+template <typename Policy>
+const typename BasicCPU32<Policy>::DecodedInstruction& BasicCPU32<Policy>::lookupDecoded(uint32_t pc) {
+    const DecodedInstruction& entry = decodeCache->slot(pc);
+    if (entry.length == 0) {
+        return decode(pc);
     }
+    return entry;
+}
 
-    if (opcode == 0xE4) {
+template <typename Policy>
+const typename BasicCPU32<Policy>::DecodedInstruction& BasicCPU32<Policy>::decode(uint32_t pc) {
+    DecodedInstruction decoded;
+    decoded.instruction = memory->load(pc);
+    decoded.opcode = (decoded.instruction >> 24) & 0xFF;
+    decoded.reg1 = (decoded.instruction >> 16) & 0x0F;
+    decoded.reg2 = (decoded.instruction >> 8) & 0x0F;
+    decoded.handler = dispatchTable[decoded.opcode];
+
+    bool isJump = decoded.opcode >= 0x12 && decoded.opcode <= 0x18;
+    if (decoded.opcode == 0xE4) {
         // If the opcode is 0xE4, it signals two immediate values are next
-        addressOperand = memory->load(programCounter->GetState() + 1); // PC is set to
-        programCounter->loadValue(programCounter->GetState() + 2);
-        immediateOperand = memory->load(programCounter->GetState());
-        programCounter->loadValue(programCounter->GetState() + 1);
-    } else if ((instruction & 0xFF) == 0xFF) {
+        decoded.address = memory->load(pc + 1);
+        decoded.immediate = memory->load(pc + 2);
+        decoded.length = 3;
+    } else if (!isJump && (decoded.instruction & 0xFF) == 0xFF) {
         // If the last byte is 0xFF, it signals an immediate value is next
-        immediateOperand = memory->load(programCounter->GetState());
-        programCounter->loadValue(programCounter->GetState() + 1);
+        decoded.immediate = memory->load(pc + 1);
+        decoded.length = 2;
     } else {
-        immediateOperand = 0;
-        addressOperand = 0;
+        decoded.length = 1;
     }
+
+    // Jumps only overwrite the PC when taken, so they fall through to the next word
+    decoded.nextPC = pc + decoded.length;
+
+    return decodeCache->insert(pc, decoded);
 }
 
-void CPU32::decodeExecute() {
+template <typename Policy>
+void BasicCPU32<Policy>::decodeExecute() {
     uint8_t opcode = (instruction >> 24) & 0xFF;
-    if (opcodeMap.find(opcode) != opcodeMap.end()) {
-        (this->*opcodeMap[opcode])();
-    } else {
-        std::cerr << "Unknown opcode: " << std::hex << opcode << std::endl;
-        hlt();
+    if (dispatchMode == DispatchMode::Map) {
+        if (opcodeMap.find(opcode) != opcodeMap.end()) {
+            (this->*opcodeMap[opcode])();
+        } else {
+            trap();
+        }
+        return;
     }
+    (this->*dispatchTable[opcode])();
 }
 
-void CPU32::nop() {}
+#if CPU32_THREADED_DISPATCH
+template <typename Policy>
+void BasicCPU32<Policy>::runThreaded() {
+    // Each handler ends in its own indirect jump to the next one instead of sharing the
+    // loop's single dispatch branch, so the host predictor learns opcode sequences.
+    void* labels[256];
+    std::fill(std::begin(labels), std::end(labels), &&op_trap);
+    labels[0x00] = &&op_nop;
+    labels[0x01] = &&op_movRegisterToRegister;
+    labels[0x02] = &&op_movImmediateToRegister;
+    labels[0x03] = &&op_load;
+    labels[0x04] = &&op_store;
+    labels[0x05] = &&op_add;
+    labels[0x06] = &&op_sub;
+    labels[0x07] = &&op_andOp;
+    labels[0x08] = &&op_orOp;
+    labels[0x09] = &&op_xorOp;
+    labels[0x0A] = &&op_notOp;
+    labels[0x10] = &&op_cmpImmediateToRegister;
+    labels[0x11] = &&op_cmpRegisterToRegister;
+    labels[0x12] = &&op_jmp;
+    labels[0x13] = &&op_jz;
+    labels[0x14] = &&op_jnz;
+    labels[0x15] = &&op_jl;
+    labels[0x16] = &&op_jg;
+    labels[0x17] = &&op_jle;
+    labels[0x18] = &&op_jge;
+    labels[0x20] = &&op_multiply;
+    labels[0x21] = &&op_multiplyHigh;
+    labels[0x22] = &&op_multiplyHighSigned;
+    labels[0x23] = &&op_divide;
+    labels[0x24] = &&op_modulo;
+    labels[0x25] = &&op_divideSigned;
+    labels[0x26] = &&op_moduloSigned;
+    labels[0x27] = &&op_shiftLeft;
+    labels[0x28] = &&op_shiftRight;
+    labels[0x29] = &&op_shiftRightArithmetic;
+    labels[0x2A] = &&op_rotateLeft;
+    labels[0x2B] = &&op_rotateRight;
+    labels[0x2C] = &&op_popCount;
+    labels[0x2D] = &&op_countLeadingZeros;
+    labels[0x30] = &&op_call;
+    labels[0x31] = &&op_ret;
+    labels[0x32] = &&op_push;
+    labels[0x33] = &&op_pop;
+    labels[0x50] = &&op_blockMove;
+    labels[0x51] = &&op_blockFill;
+    labels[0x52] = &&op_blockCompare;
+    labels[0x60] = &&op_compareAndSwap;
+    labels[0x61] = &&op_exchangeAdd;
+    labels[0x62] = &&op_fence;
+    labels[0x70] = &&op_enableInterrupts;
+    labels[0x71] = &&op_disableInterrupts;
+    labels[0x72] = &&op_interruptReturn;
+    labels[0x80] = &&op_vectorLoad;
+    labels[0x81] = &&op_vectorStore;
+    labels[0x82] = &&op_vectorAdd;
+    labels[0x83] = &&op_vectorSub;
+    labels[0x84] = &&op_vectorAnd;
+    labels[0x85] = &&op_vectorOr;
+    labels[0x86] = &&op_vectorXor;
+    labels[0x87] = &&op_vectorCompareEqual;
+    labels[0x88] = &&op_vectorCompareGreater;
+    labels[0x89] = &&op_vectorSum;
+    labels[0x8A] = &&op_vectorSplat;
+    labels[0x40] = &&op_inOp;
+    labels[0x41] = &&op_outOp;
+    labels[0xE2] = &&op_movImmediate32ToRegister;
+    labels[0xE4] = &&op_storeImmediate32;
+    labels[0xE5] = &&op_addImmediate;
+    labels[0xFF] = &&op_hlt;
+
+#define CPU32_DISPATCH()                                  \
+    do {                                                  \
+        if (halted || stopRequested || interruptDue()) {  \
+            serviceInterrupts();                          \
+            if (halted || stopRequested) return;          \
+        }                                                 \
+        clock->tick();                                    \
+        fetch();                                          \
+        goto *labels[(instruction >> 24) & 0xFF];         \
+    } while (0)
+#define CPU32_THREADED_OP(handler) op_##handler: handler(); CPU32_DISPATCH();
+
+    CPU32_DISPATCH();
+
+    CPU32_THREADED_OP(nop)
+    CPU32_THREADED_OP(movRegisterToRegister)
+    CPU32_THREADED_OP(movImmediateToRegister)
+    CPU32_THREADED_OP(load)
+    CPU32_THREADED_OP(store)
+    CPU32_THREADED_OP(add)
+    CPU32_THREADED_OP(sub)
+    CPU32_THREADED_OP(andOp)
+    CPU32_THREADED_OP(orOp)
+    CPU32_THREADED_OP(xorOp)
+    CPU32_THREADED_OP(notOp)
+    CPU32_THREADED_OP(cmpImmediateToRegister)
+    CPU32_THREADED_OP(cmpRegisterToRegister)
+    CPU32_THREADED_OP(jmp)
+    CPU32_THREADED_OP(jz)
+    CPU32_THREADED_OP(jnz)
+    CPU32_THREADED_OP(jl)
+    CPU32_THREADED_OP(jg)
+    CPU32_THREADED_OP(jle)
+    CPU32_THREADED_OP(jge)
+    CPU32_THREADED_OP(multiply)
+    CPU32_THREADED_OP(multiplyHigh)
+    CPU32_THREADED_OP(multiplyHighSigned)
+    CPU32_THREADED_OP(divide)
+    CPU32_THREADED_OP(modulo)
+    CPU32_THREADED_OP(divideSigned)
+    CPU32_THREADED_OP(moduloSigned)
+    CPU32_THREADED_OP(shiftLeft)
+    CPU32_THREADED_OP(shiftRight)
+    CPU32_THREADED_OP(shiftRightArithmetic)
+    CPU32_THREADED_OP(rotateLeft)
+    CPU32_THREADED_OP(rotateRight)
+    CPU32_THREADED_OP(popCount)
+    CPU32_THREADED_OP(countLeadingZeros)
+    CPU32_THREADED_OP(call)
+    CPU32_THREADED_OP(ret)
+    CPU32_THREADED_OP(push)
+    CPU32_THREADED_OP(pop)
+    CPU32_THREADED_OP(blockMove)
+    CPU32_THREADED_OP(blockFill)
+    CPU32_THREADED_OP(blockCompare)
+    CPU32_THREADED_OP(compareAndSwap)
+    CPU32_THREADED_OP(exchangeAdd)
+    CPU32_THREADED_OP(fence)
+    CPU32_THREADED_OP(enableInterrupts)
+    CPU32_THREADED_OP(disableInterrupts)
+    CPU32_THREADED_OP(interruptReturn)
+    CPU32_THREADED_OP(vectorLoad)
+    CPU32_THREADED_OP(vectorStore)
+    CPU32_THREADED_OP(vectorAdd)
+    CPU32_THREADED_OP(vectorSub)
+    CPU32_THREADED_OP(vectorAnd)
+    CPU32_THREADED_OP(vectorOr)
+    CPU32_THREADED_OP(vectorXor)
+    CPU32_THREADED_OP(vectorCompareEqual)
+    CPU32_THREADED_OP(vectorCompareGreater)
+    CPU32_THREADED_OP(vectorSum)
+    CPU32_THREADED_OP(vectorSplat)
+    CPU32_THREADED_OP(inOp)
+    CPU32_THREADED_OP(outOp)
+    CPU32_THREADED_OP(movImmediate32ToRegister)
+    CPU32_THREADED_OP(storeImmediate32)
+    CPU32_THREADED_OP(addImmediate)
+    CPU32_THREADED_OP(hlt)
+    CPU32_THREADED_OP(trap)
+
+#undef CPU32_THREADED_OP
+#undef CPU32_DISPATCH
+}
+#else
+template <typename Policy>
+void BasicCPU32<Policy>::runThreaded() {
+    while (!halted) {
+        tickClock();
+    }
+}
+#endif
+
+template <typename Policy>
+RunResult32 BasicCPU32<Policy>::runBlocks(uint64_t maxInstructions, const Deadline* deadline, bool bounded) {
+    RunResult32 result;
+    RunLimits limits{maxInstructions, deadline, bounded && !breakpoints.empty()};
+    uint64_t startCycles = clock->GetCycles();
+    uint64_t retired = 0;
+    bool jitEnabled = dispatchMode == DispatchMode::JIT;
+#if CPU32_PROFILING
+    Profiler32* profile = profiler.get();
+#endif
+    jitEnabled = jitEnabled && !profiling();
+    const DecodedInstruction* current = nullptr; // the op being executed, for precise faults
+    Block* block = nullptr;
+    try {
+        // Every stop condition is checked here, between blocks, and nowhere else
+        while (true) {
+            if (mayStop(retired, limits)) {
+                if (shouldStop(retired, limits, result)) {
+                    break;
+                }
+                // Taking an interrupt moves the PC off the chained block
+                if (block && block->startPC != registerFile->pc) {
+                    block = nullptr;
+                }
+            }
+            if (!block) {
+                // Safe point: nothing is executing a block, so retired blocks can be freed
+                blockCache->collect();
+                uint32_t pc = registerFile->pc;
+                block = blockCache->find(pc);
+                if (!block) {
+                    block = translate(pc);
+                }
+            }
+
+            if (jitEnabled && !block->jit && block->executions < JIT_THRESHOLD &&
+                ++block->executions == JIT_THRESHOLD) {
+                compileBlock(*block);
+            }
+
+            uint64_t remaining = maxInstructions - retired;
+            uint64_t generation = blockCache->generation();
+            bool partial = false;
+            if (jitEnabled && block->jit && block->jit->length <= remaining &&
+                !(limits.checkBreakpoints && breakpoints.count(block->startPC))) {
+                uint64_t passes = remaining / block->jit->length;
+                // Back out in time for the next interrupt event
+                uint64_t untilEvent = interrupts->nextEvent() - clock->GetCycles();
+                passes = std::min(passes, untilEvent / block->jit->length + 1);
+                uint32_t maxIterations = passes < JIT_MAX_ITERATIONS ? static_cast<uint32_t>(passes) : JIT_MAX_ITERATIONS;
+                retired += executeNative(*block->jit, maxIterations);
+            } else {
+                size_t limit = block->ops.size() <= remaining ? block->ops.size() : static_cast<size_t>(remaining);
+                size_t executed = 0;
+                while (executed < limit) {
+                    const auto& op = block->ops[executed];
+                    current = &op;
+                    clock->tick();
+                    instructionPC = op.nextPC - op.length;
+                    instruction = op.instruction;
+                    immediateOperand = op.immediate;
+                    addressOperand = op.address;
+                    setProgramCounter(op.nextPC);
+                    (this->*op.handler)();
+#if CPU32_PROFILING
+                    if (profile) {
+                        profile->retire(op.nextPC - op.length, op.opcode, op.nextPC, registerFile->pc);
+                    }
+#endif
+                    ++executed;
+                    if (blockCache->generation() != generation) {
+                        break; // This block (or one it chains to) was just overwritten
+                    }
+                }
+                current = nullptr;
+                retired += executed;
+                partial = executed < block->ops.size();
+            }
+            if (blockCache->generation() != generation || partial) {
+                block = nullptr;
+                continue;
+            }
+
+            // Follow the exit through its chain link, resolving and caching it the first time
+            uint32_t next = registerFile->pc;
+            Block** link = nullptr;
+            if (next == block->endPC) {
+                link = &block->fallthrough;
+            } else if (block->hasTakenPC && next == block->takenPC) {
+                link = &block->taken;
+            }
+            if (link && *link) {
+                block = *link;
+                continue;
+            }
+            if (halted) {
+                continue;
+            }
+
+            Block* successor = blockCache->find(next);
+            if (!successor) {
+                successor = translate(next);
+            }
+            if (link) {
+                *link = successor;
+            }
+            block = successor;
+        }
+    } catch (const std::exception& e) {
+        if (!bounded) {
+            throw;
+        }
+        if (current) {
+            retired += current - block->ops.data();
+            setProgramCounter(current->nextPC - current->length);
+        }
+        result.reason = StopReason::Fault;
+        result.fault = e.what();
+    }
+    result.instructions = retired;
+    result.cycles = clock->GetCycles() - startCycles;
+    return result;
+}
+
+template <typename Policy>
+typename BasicCPU32<Policy>::Block* BasicCPU32<Policy>::translate(uint32_t pc) {
+    auto block = std::make_unique<Block>();
+    block->startPC = pc;
+
+    uint32_t address = pc;
+    while (block->ops.size() < MAX_BLOCK_LENGTH) {
+        if (!block->ops.empty() && !breakpoints.empty() && breakpoints.count(address)) {
+            break; // A breakpoint always starts a block
+        }
+        const DecodedInstruction* entry;
+        try {
+            entry = &lookupDecoded(address);
+        } catch (const std::out_of_range&) {
+            if (block->ops.empty()) {
+                throw;
+            }
+            break; // Let the fault surface when execution actually reaches it
+        }
+        block->ops.push_back(*entry);
+        address = entry->nextPC;
+
+        uint8_t opcode = entry->opcode;
+        if ((opcode >= 0x12 && opcode <= 0x18) || opcode == 0x30) {
+            block->takenPC = entry->instruction & 0xFFFF;
+            block->hasTakenPC = true;
+            break;
+        }
+        // I/O may ask for a stop and EI may let an interrupt in, which are only noticed
+        // between blocks; IRET jumps
+        if (opcode == 0x31 || opcode == 0x40 || opcode == 0x41 || opcode == 0x70 || opcode == 0x72 || opcode == 0xFF ||
+            entry->handler == &BasicCPU32::trap) {
+            break;
+        }
+    }
+    block->endPC = address;
+
+    return blockCache->insert(std::move(block));
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::compileBlock(Block& block) {
+    std::vector<JIT32::Op> ops;
+    ops.reserve(block.ops.size());
+    for (const auto& op : block.ops) {
+        ops.push_back({op.instruction, op.immediate, op.nextPC, op.opcode, op.reg1, op.reg2});
+    }
+    block.jit = jit->compile(ops, block.startPC);
+    if (!block.jit && jit->full()) {
+        // Retired blocks leave their code behind, so start the region over
+        blockCache->dropNativeCode();
+        jit->flush();
+        block.jit = jit->compile(ops, block.startPC);
+    }
+}
+
+template <typename Policy>
+uint64_t BasicCPU32<Policy>::executeNative(const JITCode32& code, uint32_t maxIterations) {
+    // Native code works on the register file in place and expects concrete flags
+    registerFile->resolveFlags();
+    JITCounters32 counters{0, maxIterations};
+    code.entry(registerFile.get(), &counters);
+
+    if constexpr (Policy::notifies) {
+        for (uint32_t mask = code.writeMask; mask; mask &= mask - 1) {
+            registers[std::countr_zero(mask)]->changed();
+        }
+        programCounter->changed();
+    }
+    uint64_t retired = static_cast<uint64_t>(counters.iterations) * code.length;
+    clock->tick(retired);
+    return retired;
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::trap() {
+    uint8_t opcode = (instruction >> 24) & 0xFF;
+    std::cerr << "Unknown opcode: " << std::hex << static_cast<int>(opcode) << std::dec << std::endl;
+    hlt();
+}
 
-void CPU32::movRegisterToRegister() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint8_t reg2 = (instruction >> 8) & 0xFF;
-    uint32_t value = registers[reg2]->GetState();
-    registers[reg1]->loadValue(value);
+template <typename Policy>
+void BasicCPU32<Policy>::nop() {}
+
+template <typename Policy>
+void BasicCPU32<Policy>::movRegisterToRegister() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t value = readRegister(reg2);
+    writeRegister(reg1, value);
 }
 
-void CPU32::movImmediateToRegister() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
+template <typename Policy>
+void BasicCPU32<Policy>::movImmediateToRegister() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
     uint32_t immediate = instruction & 0xFFFF;
-    registers[reg1]->loadValue(immediate);
+    writeRegister(reg1, immediate);
 }
 
-void CPU32::movImmediate32ToRegister() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    registers[reg1]->loadValue(immediateOperand);
+template <typename Policy>
+void BasicCPU32<Policy>::movImmediate32ToRegister() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    writeRegister(reg1, immediateOperand);
 }
 
-void CPU32::load() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint8_t reg2 = (instruction >> 8) & 0xFF;
-    uint32_t address = registers[reg2]->GetState();
+template <typename Policy>
+void BasicCPU32<Policy>::load() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t address = readRegister(reg2);
     uint32_t value = memory->load(address);
-    registers[reg1]->loadValue(value);
+    writeRegister(reg1, value);
 }
 
-void CPU32::store() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint8_t reg2 = (instruction >> 8) & 0xFF;
-    uint32_t address = registers[reg2]->GetState();
-    uint32_t value = registers[reg1]->GetState();
+template <typename Policy>
+void BasicCPU32<Policy>::store() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t address = readRegister(reg2);
+    uint32_t value = readRegister(reg1);
     memory->store(address, value);
 }
 
-void CPU32::storeImmediate32() {
+template <typename Policy>
+void BasicCPU32<Policy>::storeImmediate32() {
     uint32_t value = immediateOperand;
     uint32_t address = addressOperand;
     memory->store(address, value);
 }
 
-void CPU32::add() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint8_t reg2 = (instruction >> 8) & 0xFF;
-    uint32_t value1 = registers[reg1]->GetState();
-    uint32_t value2 = registers[reg2]->GetState();
+template <typename Policy>
+void BasicCPU32<Policy>::add() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t value1 = readRegister(reg1);
+    uint32_t value2 = readRegister(reg2);
     alu->setInputs(value1, value2);
-    alu->setOperation(ALU32::ADD);
+    alu->setOperation(ALUType::ADD);
     uint32_t result = alu->GetState();
-    registers[reg1]->loadValue(result);
-    if (result == 0) {
-        flagsRegister->setFlag(Flags32::ZERO);
-    } else {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
-    if (static_cast<int32_t>(result) < 0) {
-        flagsRegister->setFlag(Flags32::SIGN);
-    } else {
-        flagsRegister->clearFlag(Flags32::SIGN);
-    }
+    writeRegister(reg1, result);
+    recordFlags(LazyFlags32::ADD, value1, value2, result);
 }
 
-void CPU32::addImmediate() {
+template <typename Policy>
+void BasicCPU32<Policy>::addImmediate() {
     uint8_t regDest = (instruction >> 16) & 0x0F;
     uint32_t immediate = instruction & 0xFFFF;
-    uint32_t currentValue = registers[regDest]->GetState();
+    uint32_t currentValue = readRegister(regDest);
     uint32_t result = currentValue + immediate;
-    registers[regDest]->loadValue(result);
+    writeRegister(regDest, result);
 
-    // Update flags
-    bool zeroFlag = (result == 0);
-    if (zeroFlag)
-    {
-        flagsRegister->setFlag(Flags32::ZERO);
-    }
-    else
-    {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
-    // Update overflow and carry flags as needed
+    // Only ZERO is updated
+    registerFile->lazyFlags.recordZero(result);
 }
 
-void CPU32::sub() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint8_t reg2 = (instruction >> 8) & 0xFF;
-    uint32_t value1 = registers[reg1]->GetState();
-    uint32_t value2 = registers[reg2]->GetState();
+template <typename Policy>
+void BasicCPU32<Policy>::sub() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t value1 = readRegister(reg1);
+    uint32_t value2 = readRegister(reg2);
     alu->setInputs(value1, value2);
-    alu->setOperation(ALU32::SUB);
+    alu->setOperation(ALUType::SUB);
     uint32_t result = alu->GetState();
-    registers[reg1]->loadValue(result);
-    if (result == 0) {
-        flagsRegister->setFlag(Flags32::ZERO);
-    } else {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
-    if (static_cast<int32_t>(result) < 0) {
-        flagsRegister->setFlag(Flags32::SIGN);
-    } else {
-        flagsRegister->clearFlag(Flags32::SIGN);
-    }
+    writeRegister(reg1, result);
+    recordFlags(LazyFlags32::SUB, value1, value2, result);
 }
 
-void CPU32::andOp() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint8_t reg2 = (instruction >> 8) & 0xFF;
-    uint32_t value1 = registers[reg1]->GetState();
-    uint32_t value2 = registers[reg2]->GetState();
+template <typename Policy>
+void BasicCPU32<Policy>::andOp() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t value1 = readRegister(reg1);
+    uint32_t value2 = readRegister(reg2);
     alu->setInputs(value1, value2);
-    alu->setOperation(ALU32::AND);
+    alu->setOperation(ALUType::AND);
     uint32_t result = alu->GetState();
-    registers[reg1]->loadValue(result);
-    if (result == 0) {
-        flagsRegister->setFlag(Flags32::ZERO);
-    } else {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
-    if (static_cast<int32_t>(result) < 0) {
-        flagsRegister->setFlag(Flags32::SIGN);
-    } else {
-        flagsRegister->clearFlag(Flags32::SIGN);
-    }
+    writeRegister(reg1, result);
+    recordFlags(LazyFlags32::LOGIC, value1, value2, result);
 }
 
-void CPU32::orOp() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint8_t reg2 = (instruction >> 8) & 0xFF;
-    uint32_t value1 = registers[reg1]->GetState();
-    uint32_t value2 = registers[reg2]->GetState();
+template <typename Policy>
+void BasicCPU32<Policy>::orOp() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t value1 = readRegister(reg1);
+    uint32_t value2 = readRegister(reg2);
     alu->setInputs(value1, value2);
-    alu->setOperation(ALU32::OR);
+    alu->setOperation(ALUType::OR);
     uint32_t result = alu->GetState();
-    registers[reg1]->loadValue(result);
-    if (result == 0) {
-        flagsRegister->setFlag(Flags32::ZERO);
-    } else {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
-    if (static_cast<int32_t>(result) < 0) {
-        flagsRegister->setFlag(Flags32::SIGN);
-    } else {
-        flagsRegister->clearFlag(Flags32::SIGN);
-    }
+    writeRegister(reg1, result);
+    recordFlags(LazyFlags32::LOGIC, value1, value2, result);
 }
 
-void CPU32::xorOp() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint8_t reg2 = (instruction >> 8) & 0xFF;
-    uint32_t value1 = registers[reg1]->GetState();
-    uint32_t value2 = registers[reg2]->GetState();
+template <typename Policy>
+void BasicCPU32<Policy>::xorOp() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t value1 = readRegister(reg1);
+    uint32_t value2 = readRegister(reg2);
     alu->setInputs(value1, value2);
-    alu->setOperation(ALU32::XOR);
+    alu->setOperation(ALUType::XOR);
     uint32_t result = alu->GetState();
-    registers[reg1]->loadValue(result);
-    if (result == 0) {
-        flagsRegister->setFlag(Flags32::ZERO);
-    } else {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
-    if (static_cast<int32_t>(result) < 0) {
-        flagsRegister->setFlag(Flags32::SIGN);
-    } else {
-        flagsRegister->clearFlag(Flags32::SIGN);
-    }
+    writeRegister(reg1, result);
+    recordFlags(LazyFlags32::LOGIC, value1, value2, result);
 }
 
-void CPU32::notOp() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint32_t value = registers[reg1]->GetState();
+template <typename Policy>
+void BasicCPU32<Policy>::notOp() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint32_t value = readRegister(reg1);
     alu->setInputs(value, 0);
-    alu->setOperation(ALU32::NOT);
+    alu->setOperation(ALUType::NOT);
     uint32_t result = alu->GetState();
-    registers[reg1]->loadValue(result);
-    if (result == 0) {
-        flagsRegister->setFlag(Flags32::ZERO);
-    } else {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
-    if (static_cast<int32_t>(result) < 0) {
-        flagsRegister->setFlag(Flags32::SIGN);
-    } else {
-        flagsRegister->clearFlag(Flags32::SIGN);
-    }
+    writeRegister(reg1, result);
+    recordFlags(LazyFlags32::LOGIC, value, 0, result);
+}
+
+// The instructions below record CARRY and OVERFLOW directly. MUL sets both when the
+// product does not fit in 32 bits; shifts and rotates leave the last bit shifted out
+// (or rotated round) in CARRY, and SHL sets OVERFLOW when the sign changes.
+template <typename Policy>
+void BasicCPU32<Policy>::multiply() {
+    auto [a, b, result] = aluRegisters(ALUType::MUL);
+    bool wide = (static_cast<uint64_t>(a) * b) >> 32;
+    recordFlags(LazyFlags32::DIRECT, wide, wide, result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::multiplyHigh() {
+    recordFlags(LazyFlags32::DIRECT, 0, 0, aluRegisters(ALUType::MULH).result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::multiplyHighSigned() {
+    recordFlags(LazyFlags32::DIRECT, 0, 0, aluRegisters(ALUType::MULHS).result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::divide() {
+    recordFlags(LazyFlags32::DIRECT, 0, 0, aluRegisters(ALUType::DIV, true).result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::modulo() {
+    recordFlags(LazyFlags32::DIRECT, 0, 0, aluRegisters(ALUType::MOD, true).result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::divideSigned() {
+    auto [a, b, result] = aluRegisters(ALUType::SDIV, true);
+    bool overflow = a == 0x80000000u && b == 0xFFFFFFFFu; // INT_MIN / -1 wraps
+    recordFlags(LazyFlags32::DIRECT, 0, overflow, result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::moduloSigned() {
+    recordFlags(LazyFlags32::DIRECT, 0, 0, aluRegisters(ALUType::SMOD, true).result);
 }
 
-void CPU32::cmpImmediateToRegister() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
+template <typename Policy>
+void BasicCPU32<Policy>::shiftLeft() {
+    auto [a, b, result] = aluRegisters(ALUType::SHL);
+    uint32_t count = b & 31;
+    bool carry = count && ((a >> (32 - count)) & 1);
+    recordFlags(LazyFlags32::DIRECT, carry, (a ^ result) >> 31, result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::shiftRight() {
+    auto [a, b, result] = aluRegisters(ALUType::SHR);
+    uint32_t count = b & 31;
+    recordFlags(LazyFlags32::DIRECT, count && ((a >> (count - 1)) & 1), 0, result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::shiftRightArithmetic() {
+    auto [a, b, result] = aluRegisters(ALUType::SAR);
+    uint32_t count = b & 31;
+    recordFlags(LazyFlags32::DIRECT, count && ((a >> (count - 1)) & 1), 0, result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::rotateLeft() {
+    auto [a, b, result] = aluRegisters(ALUType::ROL);
+    recordFlags(LazyFlags32::DIRECT, (b & 31) && (result & 1), 0, result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::rotateRight() {
+    auto [a, b, result] = aluRegisters(ALUType::ROR);
+    recordFlags(LazyFlags32::DIRECT, (b & 31) && (result >> 31), 0, result);
+}
+
+// POPCNT R1, R2 and CLZ R1, R2 count the bits of R2 into R1; CLZ of 0 is 32
+template <typename Policy>
+void BasicCPU32<Policy>::popCount() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    alu->setInputs(readRegister(reg2), 0);
+    alu->setOperation(ALUType::POPCNT);
+    uint32_t result = alu->GetState();
+    writeRegister(reg1, result);
+    recordFlags(LazyFlags32::DIRECT, 0, 0, result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::countLeadingZeros() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    alu->setInputs(readRegister(reg2), 0);
+    alu->setOperation(ALUType::CLZ);
+    uint32_t result = alu->GetState();
+    writeRegister(reg1, result);
+    recordFlags(LazyFlags32::DIRECT, 0, 0, result);
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::cmpImmediateToRegister() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
     uint32_t immediate = instruction & 0xFFFF;
-    uint32_t value = registers[reg1]->GetState();
+    uint32_t value = readRegister(reg1);
     uint32_t result = value - immediate;
-    if (result == 0) {
-        flagsRegister->setFlag(Flags32::ZERO);
-    } else {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
-    if (static_cast<int32_t>(result) < 0) {
-        flagsRegister->setFlag(Flags32::SIGN);
-    } else {
-        flagsRegister->clearFlag(Flags32::SIGN);
-    }
+    recordFlags(LazyFlags32::SUB, value, immediate, result);
 }
 
-void CPU32::cmpRegisterToRegister() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint8_t reg2 = (instruction >> 8) & 0xFF;
-    uint32_t value1 = registers[reg1]->GetState();
-    uint32_t value2 = registers[reg2]->GetState();
+template <typename Policy>
+void BasicCPU32<Policy>::cmpRegisterToRegister() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t value1 = readRegister(reg1);
+    uint32_t value2 = readRegister(reg2);
     uint32_t result = value1 - value2;
-    if (result == 0) {
-        flagsRegister->setFlag(Flags32::ZERO);
-    } else {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
-    if (static_cast<int32_t>(result) < 0) {
-        flagsRegister->setFlag(Flags32::SIGN);
-    } else {
-        flagsRegister->clearFlag(Flags32::SIGN);
-    }
+    recordFlags(LazyFlags32::SUB, value1, value2, result);
 }
 
-void CPU32::jmp() {
+template <typename Policy>
+void BasicCPU32<Policy>::jmp() {
     uint32_t address = instruction & 0xFFFF;
-    programCounter->loadValue(address);
+    setProgramCounter(address);
 }
 
-void CPU32::jz() {
-    if (flagsRegister->isFlagSet(Flags32::ZERO)) {
+template <typename Policy>
+void BasicCPU32<Policy>::jz() {
+    if (isFlagSet(Flags32::ZERO)) {
         uint32_t address = instruction & 0xFFFF;
-        programCounter->loadValue(address);
+        setProgramCounter(address);
     }
 }
 
-void CPU32::jnz() {
-    if (!flagsRegister->isFlagSet(Flags32::ZERO)) {
+template <typename Policy>
+void BasicCPU32<Policy>::jnz() {
+    if (!isFlagSet(Flags32::ZERO)) {
         uint32_t address = instruction & 0xFFFF;
-        programCounter->loadValue(address);
+        setProgramCounter(address);
     }
 }
 
-void CPU32::jl() {
-    if (flagsRegister->isFlagSet(Flags32::SIGN)) {
+template <typename Policy>
+void BasicCPU32<Policy>::jl() {
+    if (isFlagSet(Flags32::SIGN)) {
         uint32_t address = instruction & 0xFFFF;
-        programCounter->loadValue(address);
+        setProgramCounter(address);
     }
 }
 
-void CPU32::jg() {
-    if (!flagsRegister->isFlagSet(Flags32::SIGN) && !flagsRegister->isFlagSet(Flags32::ZERO)) {
+template <typename Policy>
+void BasicCPU32<Policy>::jg() {
+    if (!isFlagSet(Flags32::SIGN) && !isFlagSet(Flags32::ZERO)) {
         uint32_t address = instruction & 0xFFFF;
-        programCounter->loadValue(address);
+        setProgramCounter(address);
     }
 }
 
-void CPU32::jle() {
-    if (flagsRegister->isFlagSet(Flags32::SIGN) || flagsRegister->isFlagSet(Flags32::ZERO)) {
+template <typename Policy>
+void BasicCPU32<Policy>::jle() {
+    if (isFlagSet(Flags32::SIGN) || isFlagSet(Flags32::ZERO)) {
         uint32_t address = instruction & 0xFFFF;
-        programCounter->loadValue(address);
+        setProgramCounter(address);
     }
 }
 
-void CPU32::jge() {
-    if (!flagsRegister->isFlagSet(Flags32::SIGN) || flagsRegister->isFlagSet(Flags32::ZERO)) {
+template <typename Policy>
+void BasicCPU32<Policy>::jge() {
+    if (!isFlagSet(Flags32::SIGN) || isFlagSet(Flags32::ZERO)) {
         uint32_t address = instruction & 0xFFFF;
-        programCounter->loadValue(address);
+        setProgramCounter(address);
     }
 }
 
-void CPU32::call() {
+template <typename Policy>
+void BasicCPU32<Policy>::call() {
     uint32_t address = instruction & 0xFFFF;
-    returnAddress = programCounter->GetState();
-    stackPointer->loadValue(stackPointer->GetState() - 1);
-    memory->store(stackPointer->GetState(), returnAddress);
+    returnAddress = registerFile->pc;
+    setStackPointer(registerFile->sp - 1);
+    memory->store(registerFile->sp, returnAddress);
 
     // Jump to the target address
-    programCounter->loadValue(address);
+    setProgramCounter(address);
 }
 
-void CPU32::ret() {
-    returnAddress = memory->load(stackPointer->GetState());
-    stackPointer->loadValue(stackPointer->GetState() + 1);
-    programCounter->loadValue(returnAddress);
+template <typename Policy>
+void BasicCPU32<Policy>::ret() {
+    returnAddress = memory->load(registerFile->sp);
+    setStackPointer(registerFile->sp + 1);
+    setProgramCounter(returnAddress);
 }
 
-void CPU32::push() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    uint32_t value = registers[reg1]->GetState();
-    if (stackPointer->GetState() == 0) {
+template <typename Policy>
+void BasicCPU32<Policy>::push() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint32_t value = readRegister(reg1);
+    // Wraps below 0, so a full 32-bit address space pushes from SP 0 to 0xFFFFFFFF
+    if (static_cast<uint32_t>(registerFile->sp - 1) >= memory->getSize()) {
         throw std::runtime_error("Stack overflow");
     }
-    stackPointer->loadValue(stackPointer->GetState() - 1);
-    memory->store(stackPointer->GetState(), value);
+    setStackPointer(registerFile->sp - 1);
+    memory->store(registerFile->sp, value);
 }
 
 //void CPU32::pop() {
@@ -449,64 +1254,294 @@ void CPU32::push() {
 //
 //}
 
-void CPU32::pop() {
-    uint8_t reg1 = (instruction >> 16) & 0xFF;
-    if (stackPointer->GetState() >= memory->getSize()) {
+template <typename Policy>
+void BasicCPU32<Policy>::pop() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    if (registerFile->sp >= memory->getSize()) {
+        throw std::runtime_error("Stack underflow");
+    }
+    uint32_t value = memory->load(registerFile->sp);
+    setStackPointer(registerFile->sp + 1);
+    writeRegister(reg1, value);
+}
+
+// BMOV R1, R2, R3: copies R3 words from [R2] to [R1]; the ranges may overlap
+template <typename Policy>
+void BasicCPU32<Policy>::blockMove() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint8_t reg3 = instruction & 0x0F;
+    memory->copy(readRegister(reg1), readRegister(reg2), readRegister(reg3));
+}
+
+// BFILL R1, R2, R3: stores R2 into the R3 words from [R1]
+template <typename Policy>
+void BasicCPU32<Policy>::blockFill() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint8_t reg3 = instruction & 0x0F;
+    memory->fill(readRegister(reg1), readRegister(reg3), readRegister(reg2));
+}
+
+// BCMP R1, R2, R3: compares the R3 words from [R1] and [R2]. Flags are set as by CMP
+// on the first pair of words that differ, so ZERO means the ranges are equal.
+template <typename Policy>
+void BasicCPU32<Policy>::blockCompare() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint8_t reg3 = instruction & 0x0F;
+    uint32_t first = readRegister(reg1);
+    uint32_t second = readRegister(reg2);
+    uint32_t count = readRegister(reg3);
+    size_t offset = memory->compare(first, second, count);
+    uint32_t value1 = 0;
+    uint32_t value2 = 0;
+    if (offset < count) {
+        value1 = memory->load(first + static_cast<uint32_t>(offset));
+        value2 = memory->load(second + static_cast<uint32_t>(offset));
+    }
+    recordFlags(LazyFlags32::SUB, value1, value2, value1 - value2);
+}
+
+// CAS R1, R2, R3: if [R2] holds R1, atomically replaces it with R3. R1 receives the
+// value found, and flags are set as by CMP of it with the expected value, so ZERO
+// means the swap happened.
+template <typename Policy>
+void BasicCPU32<Policy>::compareAndSwap() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint8_t reg3 = instruction & 0x0F;
+    uint32_t expected = readRegister(reg1);
+    uint32_t found = memory->compareExchange(readRegister(reg2), expected, readRegister(reg3));
+    writeRegister(reg1, found);
+    recordFlags(LazyFlags32::SUB, found, expected, found - expected);
+}
+
+// XADD R1, R2: atomically adds R1 to [R2] and leaves the previous value in R1. Flags
+// are those of the addition.
+template <typename Policy>
+void BasicCPU32<Policy>::exchangeAdd() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t reg2 = (instruction >> 8) & 0x0F;
+    uint32_t addend = readRegister(reg1);
+    uint32_t previous = memory->fetchAdd(readRegister(reg2), addend);
+    writeRegister(reg1, previous);
+    recordFlags(LazyFlags32::ADD, previous, addend, previous + addend);
+}
+
+// FENCE: orders this CPU's loads and stores against other CPUs on the same memory
+template <typename Policy>
+void BasicCPU32<Policy>::fence() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+// IN R1, port: reads the device register behind `port` into R1. If it has nothing
+// to deliver, the PC is wound back onto the IN and the run stops with IOWait, so
+// the next run retries it.
+template <typename Policy>
+void BasicCPU32<Policy>::inOp() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t port = (instruction >> 8) & 0xFF;
+    if (!bus->ready(port)) {
+        setProgramCounter(instructionPC);
+        requestStop(StopReason::IOWait);
+        return;
+    }
+    writeRegister(reg1, bus->in(port));
+}
+
+// OUT R1, port: writes R1 to the device register behind `port`. If it cannot take
+// the write, the run stops with IOWait on the OUT, as for IN.
+template <typename Policy>
+void BasicCPU32<Policy>::outOp() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint8_t port = (instruction >> 8) & 0xFF;
+    if (!bus->writable(port)) {
+        setProgramCounter(instructionPC);
+        requestStop(StopReason::IOWait);
+        return;
+    }
+    bus->out(port, readRegister(reg1));
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::serviceInterrupts() {
+    bool enabled = registerFile->flags & FlagBits32::INTERRUPT;
+    uint64_t now = clock->GetCycles();
+    uint64_t wake = interrupts->nextDeadline();
+    if (halted && enabled && !interrupts->pending() && wake != InterruptController32::NEVER && wake > now) {
+        // Idle: nothing can happen before the timer, so skip the clock straight to it
+        clock->tick(wake - now);
+        now = wake;
+    }
+    interrupts->expire(now);
+    if (enabled) {
+        int line = interrupts->acknowledge();
+        if (line >= 0) {
+            enterInterrupt(static_cast<uint32_t>(line));
+        }
+    }
+}
+
+// Pushes the flags, then the PC, and continues at the line's vector with INTERRUPT
+// clear, so handlers are not interrupted unless they execute EI
+template <typename Policy>
+void BasicCPU32<Policy>::enterInterrupt(uint32_t line) {
+    uint32_t handler = memory->load(interrupts->vectorTable() + line);
+    registerFile->resolveFlags();
+    uint32_t sp = registerFile->sp;
+    if (static_cast<uint32_t>(sp - 1) >= memory->getSize() || static_cast<uint32_t>(sp - 2) >= memory->getSize()) {
+        throw std::runtime_error("Stack overflow");
+    }
+    memory->store(sp - 1, registerFile->flags);
+    memory->store(sp - 2, registerFile->pc);
+    setStackPointer(sp - 2);
+    registerFile->flags &= ~FlagBits32::INTERRUPT;
+    interrupts->setEnabled(false);
+    setProgramCounter(handler);
+    halted = false;
+}
+
+// EI: lets pending and future interrupts in, from the next instruction on
+template <typename Policy>
+void BasicCPU32<Policy>::enableInterrupts() {
+    registerFile->flags |= FlagBits32::INTERRUPT;
+    interrupts->setEnabled(true);
+}
+
+// DI: holds interrupts pending until the next EI or IRET
+template <typename Policy>
+void BasicCPU32<Policy>::disableInterrupts() {
+    registerFile->flags &= ~FlagBits32::INTERRUPT;
+    interrupts->setEnabled(false);
+}
+
+// IRET: pops the PC and then the flags an interrupt pushed, which re-enables interrupts
+template <typename Policy>
+void BasicCPU32<Policy>::interruptReturn() {
+    uint32_t sp = registerFile->sp;
+    if (static_cast<uint64_t>(sp) + 2 > memory->getSize()) {
         throw std::runtime_error("Stack underflow");
     }
-    uint32_t value = memory->load(stackPointer->GetState());
-    stackPointer->loadValue(stackPointer->GetState() + 1);
-    registers[reg1]->loadValue(value);
+    uint32_t pc = memory->load(sp);
+    uint32_t flags = memory->load(sp + 1);
+    setStackPointer(sp + 2);
+    registerFile->lazyFlags.clear();
+    registerFile->flags = flags;
+    interrupts->setEnabled(flags & FlagBits32::INTERRUPT);
+    setProgramCounter(pc);
+}
+
+// VLOAD V1, R2 and VSTORE V1, R2 move the four words from [R2] into or out of V1.
+// The whole range is checked first, so a fault leaves memory and V1 untouched.
+template <typename Policy>
+void BasicCPU32<Policy>::vectorLoad() {
+    Vector32& destination = registerFile->vectors[(instruction >> 16) & 0x0F];
+    uint32_t address = readRegister((instruction >> 8) & 0x0F);
+    memory->loadBlock(address, std::span<uint32_t>(destination.lane));
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::vectorStore() {
+    const Vector32& source = registerFile->vectors[(instruction >> 16) & 0x0F];
+    uint32_t address = readRegister((instruction >> 8) & 0x0F);
+    memory->storeBlock(address, std::span<const uint32_t>(source.lane));
+}
+
+// Lane-wise V1 = V1 op V2; flags are left alone
+template <typename Policy>
+void BasicCPU32<Policy>::vectorAdd() {
+    vectorLanes<VectorALU32::ADD>();
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::vectorSub() {
+    vectorLanes<VectorALU32::SUB>();
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::vectorAnd() {
+    vectorLanes<VectorALU32::AND>();
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::vectorOr() {
+    vectorLanes<VectorALU32::OR>();
 }
 
-void CPU32::inOp() {
-    // Placeholder for input operation
+template <typename Policy>
+void BasicCPU32<Policy>::vectorXor() {
+    vectorLanes<VectorALU32::XOR>();
 }
 
-void CPU32::outOp() {
-    // Placeholder for output operation
+// VCMPEQ V1, V2 and VCMPGT V1, V2 (signed) leave all ones in the lanes of V1 where the
+// comparison holds and zero elsewhere. ZERO is set when it holds in no lane.
+template <typename Policy>
+void BasicCPU32<Policy>::vectorCompareEqual() {
+    vectorLanes<VectorALU32::CMPEQ>();
+    uint32_t lanes = VectorALU32::nonZeroLanes(registerFile->vectors[(instruction >> 16) & 0x0F]);
+    recordFlags(LazyFlags32::LOGIC, lanes, 0, lanes);
 }
 
-void CPU32::hlt() {
+template <typename Policy>
+void BasicCPU32<Policy>::vectorCompareGreater() {
+    vectorLanes<VectorALU32::CMPGT>();
+    uint32_t lanes = VectorALU32::nonZeroLanes(registerFile->vectors[(instruction >> 16) & 0x0F]);
+    recordFlags(LazyFlags32::LOGIC, lanes, 0, lanes);
+}
+
+// VSUM R1, V2: R1 = the wrapping sum of V2's lanes, with flags as for a logic result
+template <typename Policy>
+void BasicCPU32<Policy>::vectorSum() {
+    uint8_t reg1 = (instruction >> 16) & 0x0F;
+    uint32_t result = VectorALU32::sum(registerFile->vectors[(instruction >> 8) & 0x0F]);
+    writeRegister(reg1, result);
+    recordFlags(LazyFlags32::LOGIC, result, 0, result);
+}
+
+// VSPLAT V1, R2: every lane of V1 = R2
+template <typename Policy>
+void BasicCPU32<Policy>::vectorSplat() {
+    registerFile->vectors[(instruction >> 16) & 0x0F] = VectorALU32::splat(readRegister((instruction >> 8) & 0x0F));
+}
+
+template <typename Policy>
+void BasicCPU32<Policy>::hlt() {
     halted = true;
 }
 
-uint32_t CPU32::GetState() const {
+template <typename Policy>
+uint32_t BasicCPU32<Policy>::GetState() const {
     // Returning a combination of important states as a single uint32_t
     // Here we return the state of the program counter, zero flag, and halted status
     uint32_t state = 0;
-    state |= (programCounter->GetState() & 0xFFFF);  // lower 16 bits for program counter
-    state |= (flagsRegister->getFlags() << 16);  // 17th bit for flags
+    state |= (registerFile->pc & 0xFFFF);  // lower 16 bits for program counter
+    state |= (registerFile->lazyFlags.resolve(registerFile->flags) << 16);  // 17th bit for flags
     state |= (halted << 17);    // 18th bit for halted flag
     return state;
 }
 
-void CPU32::Update(uint32_t state) {
+template <typename Policy>
+void BasicCPU32<Policy>::Update(uint32_t state) {
     // Updating the state from a single uint32_t
     uint32_t pc = state & 0xFFFF;  // lower 16 bits for program counter
     uint32_t flags = (state >> 16) & 0xFFFF; // 17th bit for flags
     bool hFlag = (state >> 17) & 1; // 18th bit for halted flag
 
-    programCounter->loadValue(pc);
+    setProgramCounter(pc);
     flagsRegister->loadValue(flags);
     halted = hFlag;
 }
 
-bool CPU32::GetZeroFlag() const {
-    return flagsRegister->isFlagSet(Flags32::ZERO);
+template <typename Policy>
+bool BasicCPU32<Policy>::GetZeroFlag() const {
+    return isFlagSet(Flags32::ZERO);
 }
 
-void CPU32::SetZeroFlag(bool zFlag) {
-    if (zFlag) {
-        flagsRegister->setFlag(Flags32::ZERO);
-    } else {
-        flagsRegister->clearFlag(Flags32::ZERO);
-    }
+template <typename Policy>
+void BasicCPU32<Policy>::SetZeroFlag(bool zFlag) {
+    updateFlag(Flags32::ZERO, zFlag);
 }
 
-
-
-
-
-
-
+template class BasicCPU32<Observed>;
+template class BasicCPU32<NoObservers>;
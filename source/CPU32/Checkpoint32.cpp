@@ -0,0 +1,136 @@
+#include <CPU32/Checkpoint32.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr size_t PAGE_BYTES = Memory32::PAGE_WORDS * sizeof(uint32_t);
+
+// Words of page `index` that lie inside memory; only the last page can be short
+size_t pageWords(const Memory32& memory, uint32_t index) {
+    size_t address = static_cast<size_t>(index) << Memory32::PAGE_SHIFT;
+    return std::min<size_t>(Memory32::PAGE_WORDS, memory.getSize() - address);
+}
+
+} // namespace
+
+void Checkpoint32::save(const std::string& path, CheckpointHeader32 state, const Memory32& memory) {
+    std::vector<CheckpointPage32> directory;
+    std::vector<uint32_t> page(Memory32::PAGE_WORDS);
+    for (uint32_t index : memory.writtenPages()) {
+        std::span<uint32_t> words(page.data(), pageWords(memory, index));
+        memory.loadBlock(index << Memory32::PAGE_SHIFT, words);
+        if (std::all_of(words.begin(), words.end(), [&](uint32_t word) { return word == words[0]; })) {
+            if (words[0] != 0) {
+                directory.push_back({index, CheckpointPage32::FILL, words[0]});
+            }
+        } else {
+            directory.push_back({index, CheckpointPage32::RAW, state.rawPages++});
+        }
+    }
+
+    std::memcpy(state.magic, CheckpointHeader32::MAGIC, sizeof(state.magic));
+    state.version = CheckpointHeader32::VERSION;
+    state.headerBytes = sizeof(CheckpointHeader32);
+    state.memorySize = memory.getSize();
+    state.pageCount = static_cast<uint32_t>(directory.size());
+    uint64_t directoryEnd = sizeof(CheckpointHeader32) + directory.size() * sizeof(CheckpointPage32);
+    state.dataOffset = (directoryEnd + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Cannot create checkpoint " + path);
+    }
+    file.write(reinterpret_cast<const char*>(&state), sizeof(state));
+    file.write(reinterpret_cast<const char*>(directory.data()),
+               static_cast<std::streamsize>(directory.size() * sizeof(CheckpointPage32)));
+    std::vector<char> padding(state.dataOffset - directoryEnd);
+    file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    for (const auto& entry : directory) {
+        if (entry.kind == CheckpointPage32::RAW) {
+            // A short last page is padded with zeros to keep later pages aligned
+            std::fill(page.begin(), page.end(), 0u);
+            memory.loadBlock(entry.index << Memory32::PAGE_SHIFT,
+                             std::span<uint32_t>(page.data(), pageWords(memory, entry.index)));
+            file.write(reinterpret_cast<const char*>(page.data()), PAGE_BYTES);
+        }
+    }
+    if (!file.flush()) {
+        throw std::runtime_error("Cannot write checkpoint " + path);
+    }
+}
+
+CheckpointHeader32 Checkpoint32::load(const std::string& path, Memory32& memory) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Cannot open checkpoint " + path);
+    }
+    auto fileBytes = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    CheckpointHeader32 header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, CheckpointHeader32::MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not a CPU32 checkpoint: " + path);
+    }
+    // A version 1 header ends where the vector registers begin; what was read past it
+    // belongs to the page directory
+    if (header.version == 1 && header.headerBytes >= offsetof(CheckpointHeader32, vectors)) {
+        std::memset(header.vectors, 0, sizeof(header.vectors));
+    } else if (header.version != CheckpointHeader32::VERSION || header.headerBytes < sizeof(header)) {
+        throw std::runtime_error("Unsupported checkpoint version " + std::to_string(header.version));
+    }
+    if (header.memorySize != memory.getSize()) {
+        throw std::invalid_argument("Checkpoint is of a different memory size");
+    }
+
+    // The directory is sized from the header, so check it fits in the file first
+    if (static_cast<uint64_t>(header.headerBytes) + static_cast<uint64_t>(header.pageCount) *
+                sizeof(CheckpointPage32) > fileBytes ||
+        header.rawPages > header.pageCount) {
+        throw std::runtime_error("Truncated checkpoint " + path);
+    }
+    std::vector<CheckpointPage32> directory(header.pageCount);
+    file.seekg(static_cast<std::streamoff>(header.headerBytes));
+    if (!file.read(reinterpret_cast<char*>(directory.data()),
+                   static_cast<std::streamsize>(directory.size() * sizeof(CheckpointPage32))) ||
+        header.dataOffset + static_cast<uint64_t>(header.rawPages) * PAGE_BYTES > fileBytes) {
+        throw std::runtime_error("Truncated checkpoint " + path);
+    }
+    std::vector<uint32_t> raw;
+    for (const auto& entry : directory) {
+        if ((static_cast<uint64_t>(entry.index) << Memory32::PAGE_SHIFT) >= memory.getSize() ||
+            (entry.kind != CheckpointPage32::FILL && entry.kind != CheckpointPage32::RAW) ||
+            (entry.kind == CheckpointPage32::RAW && entry.value != raw.size())) {
+            throw std::runtime_error("Corrupt checkpoint page directory in " + path);
+        }
+        if (entry.kind == CheckpointPage32::RAW) {
+            raw.push_back(entry.index);
+        }
+    }
+    if (raw.size() != header.rawPages) {
+        throw std::runtime_error("Corrupt checkpoint page directory in " + path);
+    }
+
+    memory.reset();
+    for (const auto& entry : directory) {
+        if (entry.kind == CheckpointPage32::FILL) {
+            memory.fill(entry.index << Memory32::PAGE_SHIFT, pageWords(memory, entry.index), entry.value);
+        }
+    }
+    if (raw.size() >= MAP_THRESHOLD) {
+        memory.mapPages(path, header.dataOffset, raw);
+    } else {
+        std::vector<uint32_t> page(Memory32::PAGE_WORDS);
+        file.seekg(static_cast<std::streamoff>(header.dataOffset));
+        for (uint32_t index : raw) {
+            file.read(reinterpret_cast<char*>(page.data()), PAGE_BYTES);
+            memory.storeBlock(index << Memory32::PAGE_SHIFT,
+                              std::span<const uint32_t>(page.data(), pageWords(memory, index)));
+        }
+    }
+    return header;
+}
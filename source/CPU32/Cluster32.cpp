@@ -0,0 +1,49 @@
+#include <CPU32/Cluster32.hpp>
+#include <algorithm>
+#include <thread>
+
+Cluster32::Cluster32(size_t count, size_t memorySize, Memory32::Mode memoryMode)
+        : memory(std::make_shared<Memory32>(memorySize, memoryMode)) {
+    if (count == 0 || count * STACK_WORDS > memorySize) {
+        throw std::invalid_argument("Memory cannot hold a stack for every core");
+    }
+    memory->setConcurrent(true);
+    for (size_t i = 0; i < count; ++i) {
+        auto cpu = std::make_unique<FastCPU32>(memory);
+        cpu->GetRegisters()[0]->loadValue(static_cast<uint32_t>(i));
+        // Wraps to 0 for core 0 of a full address space, like a single CPU's
+        cpu->GetStackPointer()->loadValue(static_cast<uint32_t>(memorySize - i * STACK_WORDS));
+        cores.push_back(std::move(cpu));
+    }
+}
+
+void Cluster32::loadProgram(const std::vector<uint32_t>& program, uint32_t startAddress) {
+    memory->storeBlock(startAddress, program);
+    for (auto& cpu : cores) {
+        cpu->GetProgramCounter()->loadValue(startAddress);
+    }
+}
+
+std::vector<RunResult32> Cluster32::run(uint64_t maxInstructions) {
+    std::vector<RunResult32> results(cores.size());
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(cores.size());
+        for (size_t i = 0; i < cores.size(); ++i) {
+            threads.emplace_back([this, i, maxInstructions, &result = results[i]] {
+                FastCPU32& cpu = *cores[i];
+                // In slices, as each run() starts by applying other cores' code writes
+                uint64_t remaining = maxInstructions;
+                do {
+                    RunResult32 slice = cpu.run(std::min(remaining, SLICE));
+                    remaining -= slice.instructions;
+                    result.instructions += slice.instructions;
+                    result.cycles += slice.cycles;
+                    result.reason = slice.reason;
+                    result.fault = std::move(slice.fault);
+                } while (result.reason == StopReason32::BudgetExhausted && remaining > 0);
+            });
+        }
+    }
+    return results;
+}
@@ -0,0 +1,220 @@
+#include <CPU32/Devices32.hpp>
+#include <chrono>
+#include <vector>
+
+ConsoleDevice32::ConsoleDevice32(std::ostream& out) : out(out) {
+    output.reserve(BUFFER_SIZE);
+}
+
+ConsoleDevice32::~ConsoleDevice32() {
+    flush();
+}
+
+void ConsoleDevice32::feed(const std::string& text) {
+    input.insert(input.end(), text.begin(), text.end());
+}
+
+uint32_t ConsoleDevice32::read(uint32_t offset) {
+    if (offset == STATUS) {
+        return static_cast<uint32_t>(input.size());
+    }
+    if (offset != DATA || input.empty()) {
+        return 0;
+    }
+    auto byte = static_cast<unsigned char>(input.front());
+    input.pop_front();
+    return byte;
+}
+
+void ConsoleDevice32::write(uint32_t offset, uint32_t value) {
+    if (offset != DATA) {
+        return;
+    }
+    output.push_back(static_cast<char>(value & 0xFF));
+    if (output.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+bool ConsoleDevice32::ready(uint32_t offset) {
+    return offset != DATA || !input.empty();
+}
+
+void ConsoleDevice32::flush() {
+    if (!output.empty()) {
+        out.write(output.data(), static_cast<std::streamsize>(output.size()));
+        out.flush();
+        output.clear();
+    }
+}
+
+TimerDevice32::TimerDevice32()
+        : TimerDevice32([] {
+              auto now = std::chrono::steady_clock::now().time_since_epoch();
+              return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+          }) {}
+
+TimerDevice32::TimerDevice32(std::function<uint64_t()> source) : source(std::move(source)) {
+    start = this->source();
+}
+
+uint32_t TimerDevice32::read(uint32_t offset) {
+    if (offset == HIGH) {
+        return latchedHigh;
+    }
+    uint64_t count = source() - start;
+    latchedHigh = static_cast<uint32_t>(count >> 32);
+    return static_cast<uint32_t>(count);
+}
+
+void TimerDevice32::write(uint32_t offset, uint32_t value) {
+    (void) value;
+    if (offset == LOW) {
+        start = source();
+        latchedHigh = 0;
+    }
+}
+
+IntervalTimerDevice32::IntervalTimerDevice32(std::shared_ptr<InterruptController32> controller, uint32_t line)
+        : controller(controller), line(line) {
+    if (line >= InterruptController32::LINES) {
+        throw std::out_of_range("No such interrupt line");
+    }
+}
+
+uint32_t IntervalTimerDevice32::read(uint32_t offset) {
+    switch (offset) {
+        case PERIOD: return period;
+        case CONTROL: return control;
+        case COUNT: {
+            auto owner = controller.lock();
+            uint64_t now = owner ? owner->cycles() : 0;
+            return expiry == NEVER || expiry <= now ? 0 : static_cast<uint32_t>(expiry - now);
+        }
+        default: return 0;
+    }
+}
+
+void IntervalTimerDevice32::write(uint32_t offset, uint32_t value) {
+    auto owner = controller.lock();
+    if (offset == PERIOD) {
+        period = value;
+    } else if (offset == CONTROL && owner) {
+        control = value & (ENABLE | PERIODIC);
+        expiry = control & ENABLE && period ? owner->cycles() + period : NEVER;
+        owner->reschedule();
+    }
+}
+
+std::shared_ptr<Device32> IntervalTimerDevice32::fork(const DeviceFork32& target) {
+    if (!target.interrupts) {
+        return nullptr;
+    }
+    auto copy = std::make_shared<IntervalTimerDevice32>(target.interrupts, line);
+    copy->period = period;
+    copy->control = control;
+    if (expiry != NEVER) {
+        // The fork's clock need not agree with this one's
+        auto owner = controller.lock();
+        uint64_t now = owner ? owner->cycles() : 0;
+        copy->expiry = target.interrupts->cycles() + (expiry > now ? expiry - now : 0);
+    }
+    target.interrupts->attach(copy);
+    return copy;
+}
+
+void IntervalTimerDevice32::expire(InterruptController32& owner, uint64_t now) {
+    owner.raise(line);
+    if (control & PERIODIC) {
+        // Expiries missed while the CPU was not looking collapse into this one
+        expiry += period;
+        if (expiry <= now) {
+            expiry = now + period;
+        }
+    } else {
+        expiry = NEVER;
+        control &= ~ENABLE;
+    }
+}
+
+BlockDevice32::BlockDevice32(const std::string& path, std::shared_ptr<Memory32> memory)
+        : path(path), memory(memory) {
+    // Create the file first; an in|out fstream will not
+    std::ofstream(path, std::ios::binary | std::ios::app);
+    file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) {
+        throw std::runtime_error("Cannot open block device " + path);
+    }
+}
+
+uint32_t BlockDevice32::read(uint32_t offset) {
+    switch (offset) {
+        case BLOCK: return block;
+        case ADDRESS: return address;
+        case COMMAND: return status;
+        case BLOCKS: return static_cast<uint32_t>(fileBytes() / (BLOCK_WORDS * sizeof(uint32_t)));
+        default: return 0;
+    }
+}
+
+void BlockDevice32::write(uint32_t offset, uint32_t value) {
+    switch (offset) {
+        case BLOCK: block = value; break;
+        case ADDRESS: address = value; break;
+        case COMMAND: transfer(value); break;
+        default: break;
+    }
+}
+
+void BlockDevice32::flush() {
+    file.flush();
+}
+
+std::shared_ptr<Device32> BlockDevice32::fork(const DeviceFork32& target) {
+    file.flush(); // So the fork's stream sees every block written so far
+    auto copy = std::make_shared<BlockDevice32>(path, target.memory);
+    copy->block = block;
+    copy->address = address;
+    copy->status = status;
+    return copy;
+}
+
+void BlockDevice32::transfer(uint32_t command) {
+    std::vector<uint32_t> buffer(BLOCK_WORDS);
+    auto position = static_cast<std::streamoff>(block) * BLOCK_WORDS * sizeof(uint32_t);
+    auto bytes = static_cast<std::streamsize>(BLOCK_WORDS * sizeof(uint32_t));
+    auto target = memory.lock();
+    if (!target) {
+        status = STATUS_ERROR;
+        return;
+    }
+    status = STATUS_OK;
+    try {
+        if (command == READ) {
+            file.clear();
+            file.seekg(position);
+            file.read(reinterpret_cast<char*>(buffer.data()), bytes);
+            file.clear(); // A short read past the end leaves zeros in the buffer
+            target->storeBlock(address, buffer);
+        } else if (command == WRITE) {
+            target->loadBlock(address, buffer);
+            file.clear();
+            file.seekp(position);
+            file.write(reinterpret_cast<const char*>(buffer.data()), bytes);
+            if (!file) {
+                status = STATUS_ERROR;
+            }
+        } else {
+            status = STATUS_ERROR;
+        }
+    } catch (const std::out_of_range&) {
+        status = STATUS_ERROR; // The buffer does not fit in guest memory
+    }
+}
+
+uint64_t BlockDevice32::fileBytes() {
+    file.clear();
+    file.seekg(0, std::ios::end);
+    auto end = file.tellg();
+    return end < 0 ? 0 : static_cast<uint64_t>(end);
+}
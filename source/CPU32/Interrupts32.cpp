@@ -0,0 +1,56 @@
+#include <CPU32/Interrupts32.hpp>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+InterruptController32::InterruptController32(std::function<uint64_t()> cycles) : clock(std::move(cycles)) {}
+
+void InterruptController32::raise(uint32_t line) {
+    if (line >= LINES) {
+        throw std::out_of_range("No such interrupt line");
+    }
+    lines |= 1u << line;
+    if (enabled) {
+        next = 0;
+    }
+}
+
+int InterruptController32::acknowledge() {
+    if (!lines) {
+        return -1;
+    }
+    int line = std::countr_zero(lines);
+    lines &= lines - 1;
+    reschedule();
+    return line;
+}
+
+void InterruptController32::setEnabled(bool enable) {
+    enabled = enable;
+    next = enabled && lines ? 0 : deadline;
+}
+
+void InterruptController32::attach(std::shared_ptr<InterruptSource32> source) {
+    sources.push_back(std::move(source));
+    reschedule();
+}
+
+void InterruptController32::reschedule() {
+    deadline = NEVER;
+    for (const auto& source : sources) {
+        deadline = std::min(deadline, source->deadline());
+    }
+    next = enabled && lines ? 0 : deadline;
+}
+
+void InterruptController32::expire(uint64_t now) {
+    if (deadline > now) {
+        return;
+    }
+    for (const auto& source : sources) {
+        if (source->deadline() <= now) {
+            source->expire(*this, now);
+        }
+    }
+    reschedule();
+}
@@ -0,0 +1,357 @@
+#include <CPU32/JIT32.hpp>
+#include <CPU32/Flags32.hpp>
+#include <CPU32/LazyFlags32.hpp>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+
+#if CPU32_JIT_AVAILABLE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Register file offsets used as disp8 operands off rdi. rsi points at the JITCounters32
+// and the guest flags are kept in r8d while the code runs.
+constexpr uint8_t FLAGS_OFFSET = offsetof(RegisterFile32, flags);
+constexpr uint8_t PC_OFFSET = offsetof(RegisterFile32, pc);
+static_assert(offsetof(RegisterFile32, flags) < 128, "register file must stay within disp8 reach");
+
+constexpr uint32_t ZERO_SIGN = Flags32::ZERO | Flags32::SIGN;
+constexpr uint32_t ARITHMETIC = LazyFlags32::ARITHMETIC;
+
+bool isJump(uint8_t opcode) {
+    return opcode >= 0x12 && opcode <= 0x18;
+}
+
+// Flags an instruction overwrites
+uint32_t flagsWritten(const JIT32::Op& op) {
+    switch (op.opcode) {
+        case 0x05: case 0x06: case 0x07: case 0x08: case 0x09: case 0x0A:
+        case 0x10: case 0x11:
+            return ARITHMETIC;
+        case 0xE5:
+            return Flags32::ZERO;
+        default:
+            return 0;
+    }
+}
+
+uint32_t flagsRead(const JIT32::Op& op) {
+    return isJump(op.opcode) && op.opcode != 0x12 ? ZERO_SIGN : 0;
+}
+
+// Guest register r lives at [rdi + 4 * r]
+uint8_t slot(uint8_t reg) {
+    return reg * 4;
+}
+
+class Emitter {
+public:
+    std::vector<uint8_t> code;
+
+    void bytes(std::initializer_list<uint8_t> values) {
+        code.insert(code.end(), values);
+    }
+
+    void dword(uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            code.push_back((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    size_t position() const {
+        return code.size();
+    }
+
+    // Emits a rel32 jump (E9, or 0F 8x for a condition) and returns the position to patch
+    size_t jump(uint8_t condition = 0) {
+        if (condition) {
+            bytes({0x0F, condition});
+        } else {
+            bytes({0xE9});
+        }
+        dword(0);
+        return position() - 4;
+    }
+
+    void patch(size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(target) - static_cast<int32_t>(at + 4);
+        std::memcpy(&code[at], &rel, sizeof(rel));
+    }
+
+    void loadEax(uint8_t reg) { bytes({0x8B, 0x47, slot(reg)}); }          // mov eax, [rdi+r]
+    void storeEax(uint8_t reg) { bytes({0x89, 0x47, slot(reg)}); }         // mov [rdi+r], eax
+    void aluEax(uint8_t opcode, uint8_t reg) { bytes({opcode, 0x47, slot(reg)}); } // op eax, [rdi+r]
+
+    void storeImmediate(uint8_t reg, uint32_t value) {                     // mov dword [rdi+r], imm32
+        bytes({0xC7, 0x47, slot(reg)});
+        dword(value);
+    }
+
+    // Replaces the flags in `mask` in r8d with the host's. Guest flags mean the same as
+    // x86 CF/ZF/SF/OF/PF after add, sub, and, or, xor and test, so they are copied over
+    // with setcc; each needed flag gets its own scratch byte register (cl, dl, r9b-r11b)
+    // because the masking that follows clobbers the host flags.
+    void flagsFromHost(uint32_t mask) {
+        if (!mask) {
+            return;
+        }
+        static constexpr struct { uint32_t flag; uint8_t setcc; } mapping[] = {
+                {Flags32::CARRY, 0x92}, {Flags32::ZERO, 0x94}, {Flags32::SIGN, 0x98},
+                {Flags32::OVERFLOW, 0x90}, {Flags32::PARITY, 0x9A},
+        };
+        static constexpr uint8_t scratch[] = {1, 2, 9, 10, 11};
+        uint8_t used[5];
+        size_t count = 0;
+        for (const auto& m : mapping) {
+            if (mask & m.flag) {
+                uint8_t reg = scratch[count];
+                if (reg >= 8) bytes({0x41});
+                bytes({0x0F, m.setcc, static_cast<uint8_t>(0xC0 | (reg & 7))}); // setcc reg8
+                used[count++] = reg;
+            }
+        }
+        bytes({0x41, 0x81, 0xE0});                            // and r8d, ~mask
+        dword(~mask);
+        count = 0;
+        for (const auto& m : mapping) {
+            if (!(mask & m.flag)) {
+                continue;
+            }
+            uint8_t reg = used[count++];
+            uint8_t low = reg & 7;
+            if (reg >= 8) bytes({0x45});
+            bytes({0x0F, 0xB6, static_cast<uint8_t>(0xC0 | (low << 3) | low)}); // movzx reg32, reg8
+            uint8_t shift = std::countr_zero(m.flag);
+            if (shift) {
+                if (reg >= 8) bytes({0x41});
+                bytes({0xC1, static_cast<uint8_t>(0xE0 | low), shift});        // shl reg32, bit
+            }
+            bytes({static_cast<uint8_t>(reg >= 8 ? 0x45 : 0x41), 0x09,
+                   static_cast<uint8_t>(0xC0 | (low << 3))});                   // or r8d, reg32
+        }
+    }
+
+    void exit(uint32_t pc) {
+        bytes({0x44, 0x89, 0x47, FLAGS_OFFSET});              // mov [rdi+flags], r8d
+        bytes({0xC7, 0x47, PC_OFFSET});                       // mov dword [rdi+pc], imm32
+        dword(pc);
+        bytes({0xC3});                                        // ret
+    }
+};
+
+} // namespace
+
+JIT32::JIT32(size_t capacity) {
+#if CPU32_JIT_AVAILABLE
+    void* mapping = mmap(nullptr, capacity, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping != MAP_FAILED) {
+        region = static_cast<uint8_t*>(mapping);
+        size = capacity;
+    }
+#else
+    (void) capacity;
+#endif
+}
+
+JIT32::~JIT32() {
+#if CPU32_JIT_AVAILABLE
+    if (region) {
+        munmap(region, size);
+    }
+#endif
+}
+
+void JIT32::flush() {
+    offset = 0;
+    codes.clear();
+    full_ = false;
+    ++flushes_;
+}
+
+bool JIT32::isSupported(const Op& op) {
+    switch (op.opcode) {
+        case 0x00: case 0xE5: case 0x12: case 0x13: case 0x14:
+        case 0x15: case 0x16: case 0x17: case 0x18:
+            return true;
+        case 0x02: case 0xE2: case 0x0A: case 0x10:
+            return op.reg1 < 16;
+        case 0x01: case 0x05: case 0x06: case 0x07: case 0x08: case 0x09: case 0x11:
+            return op.reg1 < 16 && op.reg2 < 16;
+        default:
+            return false;
+    }
+}
+
+const JITCode32* JIT32::compile(const std::vector<Op>& ops, uint32_t startPC) {
+    size_t count = 0;
+    while (count < ops.size() && isSupported(ops[count])) {
+        bool terminator = isJump(ops[count].opcode);
+        ++count;
+        if (terminator) {
+            break;
+        }
+    }
+    if (count == 0 || !region) {
+        return nullptr;
+    }
+
+    // Backwards liveness pass: skip flag updates that are overwritten before any read.
+    // Everything is live at the exits.
+    std::vector<uint32_t> neededFlags(count);
+    uint32_t live = ARITHMETIC;
+    for (size_t i = count; i-- > 0;) {
+        uint32_t written = flagsWritten(ops[i]);
+        neededFlags[i] = written & live;
+        live = (live & ~written) | flagsRead(ops[i]);
+    }
+
+    JITCode32 result;
+    result.length = static_cast<uint32_t>(count);
+
+    Emitter e;
+    e.bytes({0x44, 0x8B, 0x47, FLAGS_OFFSET});                // mov r8d, [rdi+flags]
+    size_t loopHead = e.position();
+    e.bytes({0xFF, 0x06});                                    // inc dword [rsi+iterations]
+
+    auto reads = [&](uint8_t reg) {
+        if (!(result.writeMask & (1u << reg))) {
+            result.readMask |= 1u << reg;
+        }
+    };
+    auto writes = [&](uint8_t reg) {
+        result.writeMask |= 1u << reg;
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        const Op& op = ops[i];
+        switch (op.opcode) {
+            case 0x00: // NOP
+                break;
+            case 0x01: // MOV reg, reg
+                reads(op.reg2);
+                e.loadEax(op.reg2);
+                e.storeEax(op.reg1);
+                writes(op.reg1);
+                break;
+            case 0x02: // MOV reg, imm16
+                e.storeImmediate(op.reg1, op.instruction & 0xFFFF);
+                writes(op.reg1);
+                break;
+            case 0xE2: // MOV reg, imm32
+                e.storeImmediate(op.reg1, op.immediate);
+                writes(op.reg1);
+                break;
+            case 0x05: case 0x06: case 0x07: case 0x08: case 0x09: {
+                static constexpr uint8_t encodings[] = {0x03, 0x2B, 0x23, 0x0B, 0x33}; // add, sub, and, or, xor
+                reads(op.reg1);
+                reads(op.reg2);
+                e.loadEax(op.reg1);
+                e.aluEax(encodings[op.opcode - 0x05], op.reg2);
+                e.storeEax(op.reg1);
+                writes(op.reg1);
+                e.flagsFromHost(neededFlags[i]);
+                break;
+            }
+            case 0x0A: // NOT
+                reads(op.reg1);
+                e.loadEax(op.reg1);
+                e.bytes({0xF7, 0xD0});                        // not eax
+                e.storeEax(op.reg1);
+                writes(op.reg1);
+                if (neededFlags[i]) {
+                    e.bytes({0x85, 0xC0});                    // test eax, eax (not leaves flags alone)
+                }
+                e.flagsFromHost(neededFlags[i]);
+                break;
+            case 0xE5: { // ADD reg, imm16 (only updates ZERO, and only looks at the low register nibble)
+                uint8_t reg = (op.instruction >> 16) & 0x0F;
+                reads(reg);
+                e.loadEax(reg);
+                e.bytes({0x05});                              // add eax, imm32
+                e.dword(op.instruction & 0xFFFF);
+                e.storeEax(reg);
+                writes(reg);
+                e.flagsFromHost(neededFlags[i]);
+                break;
+            }
+            case 0x10: // CMP reg, imm16
+                reads(op.reg1);
+                e.loadEax(op.reg1);
+                e.bytes({0x2D});                              // sub eax, imm32
+                e.dword(op.instruction & 0xFFFF);
+                e.flagsFromHost(neededFlags[i]);
+                break;
+            case 0x11: // CMP reg, reg
+                reads(op.reg1);
+                reads(op.reg2);
+                e.loadEax(op.reg1);
+                e.aluEax(0x2B, op.reg2);
+                e.flagsFromHost(neededFlags[i]);
+                break;
+            default: { // Jumps
+                uint32_t target = op.instruction & 0xFFFF;
+                size_t taken = 0;
+                switch (op.opcode) {
+                    case 0x12: break;                                                                      // JMP
+                    case 0x13: e.bytes({0x41, 0xF7, 0xC0}); e.dword(Flags32::ZERO); taken = e.jump(0x85); break; // JZ
+                    case 0x14: e.bytes({0x41, 0xF7, 0xC0}); e.dword(Flags32::ZERO); taken = e.jump(0x84); break; // JNZ
+                    case 0x15: e.bytes({0x41, 0xF7, 0xC0}); e.dword(Flags32::SIGN); taken = e.jump(0x85); break; // JL
+                    case 0x16: e.bytes({0x41, 0xF7, 0xC0}); e.dword(ZERO_SIGN); taken = e.jump(0x84); break;     // JG
+                    case 0x17: e.bytes({0x41, 0xF7, 0xC0}); e.dword(ZERO_SIGN); taken = e.jump(0x85); break;     // JLE
+                    default:                                                                               // JGE
+                        e.bytes({0x44, 0x89, 0xC0, 0x83, 0xE0, ZERO_SIGN, 0x83, 0xF8, Flags32::SIGN});
+                        taken = e.jump(0x85);
+                        break;
+                }
+                if (op.opcode != 0x12) {
+                    e.exit(op.nextPC);
+                    e.patch(taken, e.position());
+                }
+                if (target == startPC) {
+                    // Loop back natively until the pass budget runs out
+                    e.bytes({0x8B, 0x06});                    // mov eax, [rsi+iterations]
+                    e.bytes({0x3B, 0x46, 0x04});              // cmp eax, [rsi+maxIterations]
+                    e.patch(e.jump(0x82), loopHead);          // jb loopHead
+                }
+                e.exit(target);
+                break;
+            }
+        }
+    }
+    if (!isJump(ops[count - 1].opcode)) {
+        e.exit(ops[count - 1].nextPC);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        result.writesFlags |= flagsWritten(ops[i]) != 0;
+    }
+
+#if CPU32_JIT_AVAILABLE
+    full_ = offset + e.code.size() > size;
+    if (full_) {
+        return nullptr;
+    }
+
+    // Only the pages being written are made writable, and never executable at the same time
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t first = offset & ~(pageSize - 1);
+    size_t last = (offset + e.code.size() + pageSize - 1) & ~(pageSize - 1);
+    if (mprotect(region + first, last - first, PROT_READ | PROT_WRITE) != 0) {
+        return nullptr;
+    }
+    std::memcpy(region + offset, e.code.data(), e.code.size());
+    if (mprotect(region + first, last - first, PROT_READ | PROT_EXEC) != 0) {
+        return nullptr;
+    }
+
+    result.entry = reinterpret_cast<JITCode32::Entry>(region + offset);
+    offset += (e.code.size() + 15) & ~size_t(15);
+    codes.push_back(result);
+    return &codes.back();
+#else
+    return nullptr;
+#endif
+}
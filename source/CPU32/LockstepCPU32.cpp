@@ -0,0 +1,456 @@
+#include <CPU32/LockstepCPU32.hpp>
+#include <CPU32/ALU32.hpp>
+#include <array>
+#include <stdexcept>
+
+// GCC on x86-64 Linux builds each kernel for AVX-512, AVX2 and the baseline, and an
+// ifunc resolver picks one when the program loads. ThreadSanitizer builds crash at
+// startup on ifunc resolvers, so they get the baseline only.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__) && \
+        !defined(__SANITIZE_THREAD__)
+#define CPU32_LANE_CLONES 1
+#define CPU32_LANE_KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define CPU32_LANE_CLONES 0
+#define CPU32_LANE_KERNEL
+#endif
+
+namespace {
+
+constexpr size_t CHUNK = LockstepCPU32::CHUNK;
+using LaneALU = BasicALU32<NoObservers>;
+
+#if defined(__GNUC__) || defined(__clang__)
+// One chunk of lanes as a GNU vector; the compiler lowers it to whatever vector
+// registers the target has
+typedef uint32_t Vec __attribute__((vector_size(CHUNK * sizeof(uint32_t)), may_alias));
+typedef int32_t SignedVec __attribute__((vector_size(CHUNK * sizeof(int32_t)), may_alias));
+#define LANE_EQUAL(a, b) ((Vec) ((a) == (b)))
+#define LANE_BELOW(a, b) ((Vec) ((a) < (b)))
+#define LANE_SAR(a, n) ((Vec) ((SignedVec) (a) >> (SignedVec) (n)))
+#else
+// Portable fallback: the same operations, a lane at a time
+struct Vec {
+    uint32_t v[CHUNK];
+};
+#define LANE_OPERATOR(op)                                     \
+    inline Vec operator op(Vec a, Vec b) {                    \
+        for (size_t i = 0; i < CHUNK; ++i) a.v[i] op## = b.v[i]; \
+        return a;                                             \
+    }
+LANE_OPERATOR(+)
+LANE_OPERATOR(-)
+LANE_OPERATOR(&)
+LANE_OPERATOR(|)
+LANE_OPERATOR(^)
+LANE_OPERATOR(*)
+LANE_OPERATOR(<<)
+LANE_OPERATOR(>>)
+#undef LANE_OPERATOR
+inline Vec operator+(Vec a, uint32_t b) {
+    for (auto& lane : a.v) lane += b;
+    return a;
+}
+inline Vec operator>>(Vec a, int shift) {
+    for (auto& lane : a.v) lane >>= shift;
+    return a;
+}
+inline Vec operator~(Vec a) {
+    for (auto& lane : a.v) lane = ~lane;
+    return a;
+}
+inline Vec laneEqual(Vec a, Vec b) {
+    for (size_t i = 0; i < CHUNK; ++i) a.v[i] = a.v[i] == b.v[i] ? ~0u : 0u;
+    return a;
+}
+inline Vec laneBelow(Vec a, Vec b) {
+    for (size_t i = 0; i < CHUNK; ++i) a.v[i] = a.v[i] < b.v[i] ? ~0u : 0u;
+    return a;
+}
+inline Vec laneSar(Vec a, Vec n) {
+    for (size_t i = 0; i < CHUNK; ++i) a.v[i] = static_cast<uint32_t>(static_cast<int32_t>(a.v[i]) >> n.v[i]);
+    return a;
+}
+#define LANE_EQUAL(a, b) laneEqual(a, b)
+#define LANE_BELOW(a, b) laneBelow(a, b)
+#define LANE_SAR(a, n) laneSar(a, n)
+#endif
+
+// Macros rather than functions, so nothing is called across the kernels' targets
+#define LANE_SPLAT(x) (Vec{} + static_cast<uint32_t>(x))
+#define LANE_SELECT(m, a, b) (((a) & (m)) | ((b) & ~(m)))
+#define LANE_NEGATIVE(a) (LANE_SPLAT(0) - ((a) >> 31))
+#define LANE_COUNT(a) ((a) & LANE_SPLAT(31))
+
+// Lowest PC among the active lanes. Fills mask with the active lanes at that PC and
+// sets count to how many there are, 0 once no lane is active.
+CPU32_LANE_KERNEL
+uint32_t gatherLanes(const uint32_t* pcs, const uint32_t* active, uint32_t* mask, size_t chunks, size_t* count) {
+    auto pc = reinterpret_cast<const Vec*>(pcs);
+    auto running = reinterpret_cast<const Vec*>(active);
+    auto issue = reinterpret_cast<Vec*>(mask);
+
+    Vec lowest = LANE_SPLAT(UINT32_MAX);
+    for (size_t c = 0; c < chunks; ++c) {
+        Vec candidate = LANE_SELECT(running[c], pc[c], LANE_SPLAT(UINT32_MAX));
+        lowest = LANE_SELECT(LANE_BELOW(candidate, lowest), candidate, lowest);
+    }
+    const auto* lanes = reinterpret_cast<const uint32_t*>(&lowest);
+    uint32_t minimum = UINT32_MAX;
+    for (size_t i = 0; i < CHUNK; ++i) {
+        minimum = lanes[i] < minimum ? lanes[i] : minimum;
+    }
+
+    Vec target = LANE_SPLAT(minimum);
+    Vec issued = LANE_SPLAT(0);
+    for (size_t c = 0; c < chunks; ++c) {
+        issue[c] = running[c] & LANE_EQUAL(pc[c], target);
+        issued = issued + (issue[c] & LANE_SPLAT(1));
+    }
+    const auto* sums = reinterpret_cast<const uint32_t*>(&issued);
+    size_t total = 0;
+    for (size_t i = 0; i < CHUNK; ++i) {
+        total += sums[i];
+    }
+    *count = total;
+    return minimum;
+}
+
+// Pointers to the arrays a vector instruction reads and writes
+struct LaneArrays {
+    uint32_t* reg1;
+    const uint32_t* reg2;
+    uint32_t* pc;
+    uint32_t* zero;
+    uint32_t* sign;
+    const uint32_t* mask;
+};
+
+// Applies a register, flag or jump instruction to the lanes in the mask and moves
+// their PCs on. `immediate` is the instruction's immediate operand, `target` its jump
+// target, `next` the PC after it.
+CPU32_LANE_KERNEL
+void executeVector(uint8_t opcode, const LaneArrays& arrays, uint32_t immediate, uint32_t target, uint32_t next,
+                   size_t chunks) {
+    auto reg1 = reinterpret_cast<Vec*>(arrays.reg1);
+    auto reg2 = reinterpret_cast<const Vec*>(arrays.reg2);
+    auto pc = reinterpret_cast<Vec*>(arrays.pc);
+    auto zero = reinterpret_cast<Vec*>(arrays.zero);
+    auto sign = reinterpret_cast<Vec*>(arrays.sign);
+    auto mask = reinterpret_cast<const Vec*>(arrays.mask);
+    const Vec value = LANE_SPLAT(immediate);
+    const Vec following = LANE_SPLAT(next);
+    const Vec jump = LANE_SPLAT(target);
+
+// Runs `body` for every chunk with `m` its mask, then advances the issued lanes' PCs
+#define LANE_FOR(body)                                        \
+    for (size_t c = 0; c < chunks; ++c) {                     \
+        const Vec m = mask[c];                                \
+        body;                                                 \
+        pc[c] = LANE_SELECT(m, following, pc[c]);             \
+    }                                                         \
+    return
+// An ALU result: written back and setting ZERO and SIGN
+#define LANE_RESULT(expression)                               \
+    LANE_FOR(Vec r = (expression); reg1[c] = LANE_SELECT(m, r, reg1[c]); \
+             zero[c] = LANE_SELECT(m, r, zero[c]); sign[c] = LANE_SELECT(m, r, sign[c]))
+// A comparison: flags only
+#define LANE_COMPARE(expression)                              \
+    LANE_FOR(Vec r = (expression); zero[c] = LANE_SELECT(m, r, zero[c]); \
+             sign[c] = LANE_SELECT(m, r, sign[c]))
+// A jump taken where `condition` holds
+#define LANE_JUMP(condition)                                  \
+    for (size_t c = 0; c < chunks; ++c) {                     \
+        const Vec m = mask[c];                                \
+        const Vec isZero = LANE_EQUAL(zero[c], LANE_SPLAT(0)); \
+        const Vec isNegative = LANE_NEGATIVE(sign[c]);        \
+        (void) isZero;                                        \
+        (void) isNegative;                                    \
+        const Vec taken = m & (condition);                    \
+        pc[c] = LANE_SELECT(taken, jump, LANE_SELECT(m, following, pc[c])); \
+    }                                                         \
+    return
+
+    switch (opcode) {
+        case 0x01: LANE_FOR(reg1[c] = LANE_SELECT(m, reg2[c], reg1[c]));  // MOV reg, reg
+        case 0x02:                                                         // MOV reg, imm16
+        case 0xE2: LANE_FOR(reg1[c] = LANE_SELECT(m, value, reg1[c]));    // MOV reg, imm32
+        case 0x05: LANE_RESULT(reg1[c] + reg2[c]);                        // ADD
+        case 0x06: LANE_RESULT(reg1[c] - reg2[c]);                        // SUB
+        case 0x07: LANE_RESULT(reg1[c] & reg2[c]);                        // AND
+        case 0x08: LANE_RESULT(reg1[c] | reg2[c]);                        // OR
+        case 0x09: LANE_RESULT(reg1[c] ^ reg2[c]);                        // XOR
+        case 0x0A: LANE_RESULT(~reg1[c]);                                 // NOT
+        case 0x20: LANE_RESULT(reg1[c] * reg2[c]);                        // MUL
+        case 0x27: LANE_RESULT(reg1[c] << LANE_COUNT(reg2[c]));           // SHL
+        case 0x28: LANE_RESULT(reg1[c] >> LANE_COUNT(reg2[c]));           // SHR
+        case 0x29: LANE_RESULT(LANE_SAR(reg1[c], LANE_COUNT(reg2[c])));   // SAR
+        case 0x2A: LANE_RESULT((reg1[c] << LANE_COUNT(reg2[c])) |          // ROL
+                               (reg1[c] >> LANE_COUNT(LANE_SPLAT(0) - reg2[c])));
+        case 0x2B: LANE_RESULT((reg1[c] >> LANE_COUNT(reg2[c])) |          // ROR
+                               (reg1[c] << LANE_COUNT(LANE_SPLAT(0) - reg2[c])));
+        case 0x10: LANE_COMPARE(reg1[c] - value);                         // CMP reg, imm16
+        case 0x11: LANE_COMPARE(reg1[c] - reg2[c]);                       // CMP reg, reg
+        case 0xE5:                                                         // ADD reg, imm16 (only ZERO)
+            LANE_FOR(Vec r = reg1[c] + value; reg1[c] = LANE_SELECT(m, r, reg1[c]);
+                     zero[c] = LANE_SELECT(m, r, zero[c]));
+        case 0x12: LANE_JUMP(LANE_SPLAT(~0u));                            // JMP
+        case 0x13: LANE_JUMP(isZero);                                     // JZ
+        case 0x14: LANE_JUMP(~isZero);                                    // JNZ
+        case 0x15: LANE_JUMP(isNegative);                                 // JL
+        case 0x16: LANE_JUMP(~isNegative & ~isZero);                      // JG
+        case 0x17: LANE_JUMP(isNegative | isZero);                        // JLE
+        case 0x18: LANE_JUMP(~isNegative | isZero);                       // JGE
+        default: LANE_FOR((void) 0);                                       // NOP, HLT
+    }
+#undef LANE_FOR
+#undef LANE_RESULT
+#undef LANE_COMPARE
+#undef LANE_JUMP
+}
+
+// How the lockstep engine runs each opcode
+enum class Execution : uint8_t { Trap, Vector, Scalar, Halt, Unsupported };
+
+constexpr std::array<Execution, 256> executions = [] {
+    std::array<Execution, 256> table{};
+    for (uint8_t opcode : {0x00, 0x01, 0x02, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+                           0x16, 0x17, 0x18, 0x20, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0xE2, 0xE5}) {
+        table[opcode] = Execution::Vector;
+    }
+    for (uint8_t opcode : {0x03, 0x04, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x2C, 0x2D, 0x30, 0x31, 0x32, 0x33, 0xE4}) {
+        table[opcode] = Execution::Scalar;
+    }
+    for (uint8_t opcode : {0x40, 0x41, 0x50, 0x51, 0x52, 0x60, 0x61, 0x62, 0x70, 0x71, 0x72}) {
+        table[opcode] = Execution::Unsupported;
+    }
+    for (uint8_t opcode = 0x80; opcode <= 0x8A; ++opcode) {
+        table[opcode] = Execution::Unsupported;
+    }
+    table[0xFF] = Execution::Halt;
+    return table;
+}();
+
+} // namespace
+
+LockstepCPU32::LockstepCPU32(size_t lanes, size_t memorySize)
+        : laneCount(lanes), chunks((lanes + CHUNK - 1) / CHUNK), memorySize(memorySize),
+          state(ARRAYS * chunks), reasons(lanes, StopReason32::BudgetExhausted), faults(lanes) {
+    if (lanes == 0) {
+        throw std::invalid_argument("A lockstep CPU needs at least one lane");
+    }
+    memories.reserve(lanes);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        memories.push_back(std::make_shared<Memory32>(memorySize));
+        at(SP, lane) = static_cast<uint32_t>(memorySize); // 0 for a full address space, as for CPU32
+        at(ZERO, lane) = 1;                               // ZERO starts clear
+        at(ACTIVE, lane) = ~0u;
+    }
+}
+
+void LockstepCPU32::loadProgram(const std::vector<uint32_t>& program, uint32_t startAddress) {
+    for (auto& memory : memories) {
+        memory->storeBlock(startAddress, program);
+    }
+    code.assign(program.size(), Op{});
+    codeStart = startAddress;
+    for (size_t i = 0; i < program.size(); ++i) {
+        Op& op = code[i];
+        op.instruction = program[i];
+        op.opcode = (op.instruction >> 24) & 0xFF;
+        op.reg1 = (op.instruction >> 16) & 0x0F;
+        op.reg2 = (op.instruction >> 8) & 0x0F;
+        // Trailing operand words as CPU32 decodes them
+        bool isJump = op.opcode >= 0x12 && op.opcode <= 0x18;
+        uint8_t length = op.opcode == 0xE4 ? 3 : !isJump && (op.instruction & 0xFF) == 0xFF ? 2 : 1;
+        if (i + length > program.size()) {
+            continue; // Runs off the end of the program
+        }
+        if (op.opcode == 0xE4) {
+            op.address = program[i + 1];
+            op.immediate = program[i + 2];
+        } else if (op.opcode == 0xE2) {
+            // MOV reg, imm32 takes its trailing word, and 0 when it has none
+            op.immediate = length == 2 ? program[i + 1] : 0;
+        } else {
+            // Everything else uses its 16-bit field, whatever the length
+            op.immediate = op.instruction & 0xFFFF;
+        }
+        op.length = length;
+    }
+    for (size_t lane = 0; lane < laneCount; ++lane) {
+        at(PC, lane) = startAddress;
+    }
+}
+
+LockstepCPU32::Result LockstepCPU32::run(uint64_t maxSteps) {
+    Result result;
+    size_t count = 0;
+    while (true) {
+        uint32_t pc = gatherLanes(array(PC)->lane, array(ACTIVE)->lane, array(MASK)->lane, chunks, &count);
+        if (count == 0 || result.steps >= maxSteps) {
+            break;
+        }
+        uint32_t offset = pc - codeStart;
+        if (offset >= code.size() || code[offset].length == 0) {
+            stopMasked(StopReason32::Fault, "PC outside the program");
+            continue;
+        }
+        const Op& op = code[offset];
+        uint32_t next = pc + op.length;
+        LaneArrays arrays{array(REGISTERS + op.reg1)->lane, array(REGISTERS + op.reg2)->lane, array(PC)->lane,
+                          array(ZERO)->lane, array(SIGN)->lane, array(MASK)->lane};
+
+        switch (executions[op.opcode]) {
+            case Execution::Vector:
+                executeVector(op.opcode, arrays, op.immediate, op.instruction & 0xFFFF, next, chunks);
+                break;
+            case Execution::Scalar:
+                // Lanes that fault do not retire the instruction
+                count -= executeScalar(op, pc);
+                break;
+            case Execution::Halt:
+            case Execution::Trap: // An unknown opcode halts, as on CPU32
+                executeVector(0x00, arrays, 0, 0, next, chunks);
+                stopMasked(StopReason32::Halted, "");
+                break;
+            case Execution::Unsupported:
+                stopMasked(StopReason32::Fault, "Instruction not supported in lockstep execution");
+                continue;
+        }
+        ++result.steps;
+        result.laneInstructions += count;
+    }
+    result.finished = count == 0;
+    return result;
+}
+
+size_t LockstepCPU32::executeScalar(const Op& op, uint32_t pc) {
+    uint32_t next = pc + op.length;
+    size_t faulted = 0;
+    LaneALU alu;
+    for (size_t lane = 0; lane < laneCount; ++lane) {
+        if (!at(MASK, lane)) {
+            continue;
+        }
+        Memory32& memory = *memories[lane];
+        uint32_t& reg1 = at(REGISTERS + op.reg1, lane);
+        uint32_t reg2 = at(REGISTERS + op.reg2, lane);
+        uint32_t& sp = at(SP, lane);
+        uint32_t nextPC = next;
+        try {
+            switch (op.opcode) {
+                case 0x03: reg1 = memory.load(reg2); break;                 // LOAD
+                case 0x04: memory.store(reg2, reg1); break;                 // STORE
+                case 0xE4: memory.store(op.address, op.immediate); break;   // STORE_IMM32
+                case 0x30:                                                   // CALL
+                    // SP moves first, as on CPU32, so a faulting store leaves it moved
+                    --sp;
+                    memory.store(sp, next);
+                    nextPC = op.instruction & 0xFFFF;
+                    break;
+                case 0x31:                                                   // RET
+                    nextPC = memory.load(sp);
+                    ++sp;
+                    break;
+                case 0x32:                                                   // PUSH
+                    if (static_cast<uint32_t>(sp - 1) >= memorySize) {
+                        throw std::runtime_error("Stack overflow");
+                    }
+                    memory.store(sp - 1, reg1);
+                    --sp;
+                    break;
+                case 0x33: {                                                 // POP
+                    if (sp >= memorySize) {
+                        throw std::runtime_error("Stack underflow");
+                    }
+                    uint32_t value = memory.load(sp);
+                    ++sp;
+                    reg1 = value;
+                    break;
+                }
+                case 0x21: case 0x22: case 0x23: case 0x24: case 0x25: case 0x26: { // MULH .. SMOD
+                    static constexpr LaneALU::Operation operations[] = {
+                            LaneALU::MULH, LaneALU::MULHS, LaneALU::DIV, LaneALU::MOD, LaneALU::SDIV, LaneALU::SMOD};
+                    if (op.opcode >= 0x23 && reg2 == 0) {
+                        throw std::runtime_error("Division by zero");
+                    }
+                    alu.setInputs(reg1, reg2);
+                    alu.setOperation(operations[op.opcode - 0x21]);
+                    reg1 = at(ZERO, lane) = at(SIGN, lane) = alu.GetState();
+                    break;
+                }
+                case 0x2C: case 0x2D:                                        // POPCNT, CLZ
+                    alu.setInputs(reg2, 0);
+                    alu.setOperation(op.opcode == 0x2C ? LaneALU::POPCNT : LaneALU::CLZ);
+                    reg1 = at(ZERO, lane) = at(SIGN, lane) = alu.GetState();
+                    break;
+                default: break;
+            }
+            at(PC, lane) = nextPC;
+        } catch (const std::exception& error) {
+            stopLane(lane, StopReason32::Fault, error.what());
+            ++faulted;
+        }
+    }
+    return faulted;
+}
+
+void LockstepCPU32::stopMasked(StopReason32 reason, const std::string& message) {
+    for (size_t lane = 0; lane < laneCount; ++lane) {
+        if (at(MASK, lane)) {
+            stopLane(lane, reason, message);
+        }
+    }
+}
+
+void LockstepCPU32::stopLane(size_t lane, StopReason32 reason, const std::string& message) {
+    at(ACTIVE, lane) = 0;
+    at(MASK, lane) = 0;
+    reasons[lane] = reason;
+    faults[lane] = message;
+}
+
+uint32_t LockstepCPU32::getRegister(size_t lane, uint8_t index) const {
+    return at(REGISTERS + (index & 0x0F), lane);
+}
+
+void LockstepCPU32::setRegister(size_t lane, uint8_t index, uint32_t value) {
+    at(REGISTERS + (index & 0x0F), lane) = value;
+}
+
+uint32_t LockstepCPU32::getProgramCounter(size_t lane) const {
+    return at(PC, lane);
+}
+
+uint32_t LockstepCPU32::getStackPointer(size_t lane) const {
+    return at(SP, lane);
+}
+
+bool LockstepCPU32::getZeroFlag(size_t lane) const {
+    return at(ZERO, lane) == 0;
+}
+
+bool LockstepCPU32::getSignFlag(size_t lane) const {
+    return static_cast<int32_t>(at(SIGN, lane)) < 0;
+}
+
+bool LockstepCPU32::stopped(size_t lane) const {
+    return at(ACTIVE, lane) == 0;
+}
+
+const char* LockstepCPU32::vectorISA() {
+#if CPU32_LANE_CLONES
+    if (__builtin_cpu_supports("avx512f")) {
+        return "avx512f";
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return "avx2";
+    }
+    return "sse2";
+#elif defined(__GNUC__) || defined(__clang__)
+    return "generic vectors";
+#else
+    return "scalar";
+#endif
+}
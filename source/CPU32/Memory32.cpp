@@ -0,0 +1,828 @@
+#include <CPU32/Memory32.hpp>
+#include <algorithm>
+#include <bit>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#if CPU32_MMAP_AVAILABLE
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Calls fn(page, offset, count, done) for each run of [address, address + count) that
+// stays within one page, in ascending order; `done` is the words already visited
+template <typename Fn>
+void forEachPage(uint32_t address, size_t count, Fn fn) {
+    size_t done = 0;
+    while (done < count) {
+        uint32_t current = static_cast<uint32_t>(address + done);
+        uint32_t offset = current & Memory32::PAGE_MASK;
+        size_t chunk = std::min<size_t>(Memory32::PAGE_WORDS - offset, count - done);
+        fn(current >> Memory32::PAGE_SHIFT, offset, chunk, done);
+        done += chunk;
+    }
+}
+
+#if CPU32_GUARD_PAGES && CPU32_MMAP_AVAILABLE
+// Every 32-bit word address, in bytes
+constexpr size_t RESERVATION_BYTES = Memory32::ADDRESS_SPACE * sizeof(uint32_t);
+
+// Live reservations, scanned by the signal handler. Each takes 16 GiB of host address
+// space, so a 47-bit user space cannot hold many more than this anyway.
+constexpr size_t MAX_RESERVATIONS = 8192;
+std::atomic<uintptr_t> reservations[MAX_RESERVATIONS];
+
+struct sigaction previousAction;
+
+bool inReservation(uintptr_t address) {
+    for (const auto& slot : reservations) {
+        uintptr_t start = slot.load(std::memory_order_acquire);
+        if (start && address - start < RESERVATION_BYTES) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void guardFault(int signal, siginfo_t* info, void* context) {
+    if (inReservation(reinterpret_cast<uintptr_t>(info->si_addr))) {
+        // Unwinds out of the handler into the faulting access (-fnon-call-exceptions)
+        throw std::out_of_range("Memory access out of bounds");
+    }
+    // Not a guest access: hand it to whoever was installed before us
+    if (previousAction.sa_flags & SA_SIGINFO) {
+        previousAction.sa_sigaction(signal, info, context);
+    } else if (previousAction.sa_handler != SIG_DFL && previousAction.sa_handler != SIG_IGN) {
+        previousAction.sa_handler(signal);
+    } else {
+        // Returning re-runs the faulting instruction, which now takes the default action
+        ::signal(SIGSEGV, SIG_DFL);
+    }
+}
+
+void installGuardHandler() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        struct sigaction action {};
+        action.sa_sigaction = guardFault;
+        // SA_NODEFER: the handler is left by an exception, never by sigreturn, so
+        // SIGSEGV must not stay blocked afterwards
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, &previousAction);
+    });
+}
+#endif
+
+} // namespace
+
+Memory32::Mapping::~Mapping() {
+#if CPU32_MMAP_AVAILABLE
+    munmap(base, length);
+#endif
+}
+
+Memory32::Reservation::~Reservation() {
+#if CPU32_GUARD_PAGES && CPU32_MMAP_AVAILABLE
+    for (auto& slot : reservations) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(base);
+        if (slot.compare_exchange_strong(start, 0, std::memory_order_acq_rel)) {
+            break;
+        }
+    }
+    munmap(base, RESERVATION_BYTES);
+#endif
+}
+
+void Memory32::reserve() {
+#if CPU32_GUARD_PAGES && CPU32_MMAP_AVAILABLE
+    size_t hostPage = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t accessible = size * sizeof(uint32_t);
+    if (accessible % hostPage != 0) {
+        return; // Words past the end on the last host page could not fault: stay checked
+    }
+    installGuardHandler();
+    void* start = mmap(nullptr, RESERVATION_BYTES, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (start == MAP_FAILED) {
+        return; // Stay in Mode::Checked
+    }
+    if (accessible && mprotect(start, accessible, PROT_READ | PROT_WRITE) != 0) {
+        munmap(start, RESERVATION_BYTES);
+        return;
+    }
+    auto held = std::unique_ptr<Reservation>(new Reservation{static_cast<uint32_t*>(start), accessible});
+    for (auto& slot : reservations) {
+        uintptr_t empty = 0;
+        if (slot.compare_exchange_strong(empty, reinterpret_cast<uintptr_t>(start), std::memory_order_acq_rel)) {
+            reservation = std::move(held);
+            base = reservation->base;
+            return;
+        }
+    }
+    // Every slot taken: `held` unmaps the reservation and the memory stays checked
+#endif
+}
+
+size_t Memory32::residentPages() const {
+#if CPU32_GUARD_PAGES && CPU32_MMAP_AVAILABLE
+    if (base) {
+        size_t hostPage = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        std::vector<unsigned char> resident(reservation->accessible / hostPage);
+        if (resident.empty() || mincore(base, reservation->accessible, resident.data()) != 0) {
+            return 0;
+        }
+        size_t count = std::count_if(resident.begin(), resident.end(), [](unsigned char page) { return page & 1; });
+        return count * hostPage / sizeof(Page);
+    }
+#endif
+    return pages.size();
+}
+
+size_t Memory32::mapImage(const std::string& path, uint32_t address) {
+    if (address & PAGE_MASK) {
+        throw std::invalid_argument("Image address must be page aligned");
+    }
+
+#if CPU32_MMAP_AVAILABLE
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open image " + path);
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot read image " + path);
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Cannot open image " + path);
+    }
+    size_t bytes = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+#endif
+
+    auto fail = [&](auto error) {
+#if CPU32_MMAP_AVAILABLE
+        close(fd);
+#endif
+        throw error;
+    };
+    if (bytes % sizeof(uint32_t)) {
+        fail(std::invalid_argument("Image size must be a whole number of words"));
+    }
+    size_t words = bytes / sizeof(uint32_t);
+    if (address + words > size) {
+        fail(std::out_of_range("Image does not fit in memory"));
+    }
+    if (words == 0) {
+        fail(std::invalid_argument("Image is empty"));
+    }
+
+#if CPU32_MMAP_AVAILABLE
+    // Guarded memory maps the image in place, which needs host pages the size of ours
+    if (base && hostPageSize() != sizeof(Page)) {
+        close(fd);
+        readImage(path, address, words);
+        return words;
+    }
+    // Whole guest pages; the tail of the last one lies past EOF and reads as zero
+    size_t imagePages = (words + PAGE_WORDS - 1) >> PAGE_SHIFT;
+    size_t length = imagePages * sizeof(Page);
+    void* mapped = base
+                   ? mmap(base + address, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0)
+                   : mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot map image " + path);
+    }
+    uint32_t first = address >> PAGE_SHIFT;
+    if (base) {
+        // Replaced in place; the reservation's munmap releases it with the rest
+        for (size_t page = 0; page < imagePages; ++page) {
+            pageReplaced(first + page);
+        }
+        return words;
+    }
+    mappings.push_back(std::shared_ptr<Mapping>(new Mapping{mapped, length}));
+
+    auto* image = static_cast<uint32_t*>(mapped);
+    for (size_t page = 0; page < imagePages; ++page) {
+        setPage(first + page, image + (page << PAGE_SHIFT));
+    }
+#else
+    file.close();
+    readImage(path, address, words);
+#endif
+    return words;
+}
+
+void Memory32::mapPages(const std::string& path, uint64_t offset, std::span<const uint32_t> indices) {
+    for (uint32_t index : indices) {
+        if (index >= pageCount) {
+            throw std::out_of_range("Page lies outside memory");
+        }
+    }
+    if (indices.empty()) {
+        return;
+    }
+
+#if CPU32_MMAP_AVAILABLE
+    auto hostPage = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    if (offset % hostPage) {
+        throw std::invalid_argument("Page offset must be a multiple of the host page size");
+    }
+    // Guarded memory maps each run of pages in place, which needs host pages the size
+    // of ours
+    if (base && hostPageSize() != sizeof(Page)) {
+        readPages(path, offset, indices);
+        return;
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    if (base) {
+        size_t start = 0;
+        while (start < indices.size()) {
+            size_t end = start + 1;
+            while (end < indices.size() && indices[end] == indices[end - 1] + 1) {
+                ++end;
+            }
+            void* mapped = mmap(base + (static_cast<size_t>(indices[start]) << PAGE_SHIFT), (end - start) * sizeof(Page),
+                                PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+                                static_cast<off_t>(offset + start * sizeof(Page)));
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Cannot map " + path);
+            }
+            start = end;
+        }
+        close(fd);
+        for (uint32_t index : indices) {
+            pageReplaced(index);
+        }
+        return;
+    }
+    size_t length = indices.size() * sizeof(Page);
+    void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot map " + path);
+    }
+    mappings.push_back(std::shared_ptr<Mapping>(new Mapping{mapped, length}));
+    auto* file = static_cast<uint32_t*>(mapped);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        setPage(indices[i], file + (i << PAGE_SHIFT));
+    }
+#else
+    readPages(path, offset, indices);
+#endif
+}
+
+void Memory32::readPages(const std::string& path, uint64_t offset, std::span<const uint32_t> indices) {
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    std::vector<uint32_t> buffer(PAGE_WORDS);
+    for (uint32_t index : indices) {
+        if (!file.read(reinterpret_cast<char*>(buffer.data()), sizeof(Page))) {
+            throw std::runtime_error("Cannot read pages from " + path);
+        }
+        uint32_t address = index << PAGE_SHIFT;
+        size_t count = std::min<size_t>(PAGE_WORDS, size - address);
+        storeBlock(address, std::span<const uint32_t>(buffer.data(), count));
+    }
+}
+
+void Memory32::readImage(const std::string& path, uint32_t address, size_t words) {
+    std::ifstream file(path, std::ios::binary);
+    // Padded like a mapping, whose last page reads as zero past the end of the file
+    size_t padded = std::min<size_t>(((words + PAGE_WORDS - 1) >> PAGE_SHIFT) << PAGE_SHIFT, size - address);
+    std::vector<uint32_t> image(padded);
+    if (!file.read(reinterpret_cast<char*>(image.data()), static_cast<std::streamsize>(words * sizeof(uint32_t)))) {
+        throw std::runtime_error("Cannot read image " + path);
+    }
+    storeBlock(address, image);
+}
+
+size_t Memory32::hostPageSize() {
+    size_t bytes = hostPageOverride.load(std::memory_order_relaxed);
+#if CPU32_MMAP_AVAILABLE
+    if (!bytes) {
+        bytes = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return bytes ? bytes : sizeof(Page);
+}
+
+void Memory32::setPage(uint32_t index, uint32_t* page) {
+    pages.erase(index);
+    setEntry(index, (table[index] & WATCHED) | reinterpret_cast<uintptr_t>(page));
+    pageReplaced(index);
+}
+
+void Memory32::pageReplaced(uint32_t index) {
+    markDirty(index);
+    if (table[index] & WATCHED) {
+        uint32_t first = index << PAGE_SHIFT;
+        for (uint32_t offset = 0; offset < PAGE_WORDS && first + offset < size; ++offset) {
+            notifyWrite(first + offset);
+        }
+    }
+}
+
+void Memory32::checkRange(uint32_t address, size_t count) const {
+    if (static_cast<uint64_t>(address) + count > size) {
+        throw std::out_of_range("Memory access out of bounds");
+    }
+}
+
+uint32_t* Memory32::writablePage(uint32_t index) {
+    if (!(table[index] & DIRTY)) {
+        markDirty(index);
+    }
+    uintptr_t entry = table[index];
+    uint32_t* page = words(entry);
+    if (page && !(entry & SHARED)) {
+        return page;
+    }
+    if (page) {
+        auto owned = pages.find(index);
+        if (owned != pages.end() && owned->second.use_count() == 1) {
+            // Every other holder has let go; pairs with their release of the count
+            std::atomic_thread_fence(std::memory_order_acquire);
+            setEntry(index, entry & ~SHARED);
+            return page;
+        }
+    }
+    auto fresh = std::make_shared<Page>();
+    if (page) {
+        std::memcpy(fresh->words, page, sizeof(Page));
+    }
+    uint32_t* storage = fresh->words;
+    pages[index] = std::move(fresh); // Drops this memory's hold on a shared page
+    setEntry(index, (entry & FLAGS & ~SHARED) | reinterpret_cast<uintptr_t>(storage));
+    return storage;
+}
+
+void Memory32::storeSlow(uint32_t address, uint32_t value) {
+    uint32_t index = address >> PAGE_SHIFT;
+    // Device pages only change with mapDevice, which no other thread may overlap
+    if (isDevicePage(index)) {
+        deviceStore(address, value);
+        return;
+    }
+    auto lock = exclusive();
+    uintptr_t entry = table[index];
+    // Zero stores into an untouched page change nothing, so only allocate for others
+    if (words(entry) || value != 0) {
+        storeWord(writablePage(index) + (address & PAGE_MASK), value);
+    }
+    if (entry & WATCHED) {
+        notifyWrite(address);
+    }
+}
+
+uint32_t* Memory32::atomicWord(uint32_t address) {
+    checkRange(address, 1);
+    uint32_t index = address >> PAGE_SHIFT;
+    uintptr_t entry = entryAt(index, std::memory_order_acquire);
+    if (base) {
+        if (!(entry & DIRTY)) {
+            auto lock = exclusive();
+            if (!(table[index] & DIRTY)) {
+                markDirty(index);
+            }
+        }
+        return base + address;
+    }
+    if (words(entry) && (entry & (DIRTY | SHARED)) == DIRTY) {
+        return words(entry) + (address & PAGE_MASK);
+    }
+    auto lock = exclusive();
+    if (isDevicePage(index)) {
+        return nullptr;
+    }
+    return writablePage(index) + (address & PAGE_MASK);
+}
+
+void Memory32::atomicWritten(uint32_t address) {
+    if (entryAt(address >> PAGE_SHIFT) & WATCHED) {
+        auto lock = exclusive();
+        notifyWrite(address);
+    }
+}
+
+uint32_t Memory32::compareExchange(uint32_t address, uint32_t expected, uint32_t desired) {
+    uint32_t* word = atomicWord(address);
+    if (!word) {
+        auto lock = deviceAccess();
+        const DeviceRange& range = deviceAt(address);
+        uint32_t old = range.device->read(address - range.start);
+        if (old == expected) {
+            range.device->write(address - range.start, desired);
+        }
+        return old;
+    }
+    uint32_t old = expected;
+    if (std::atomic_ref<uint32_t>(*word).compare_exchange_strong(old, desired)) {
+        atomicWritten(address);
+    }
+    return old;
+}
+
+uint32_t Memory32::fetchAdd(uint32_t address, uint32_t value) {
+    uint32_t* word = atomicWord(address);
+    if (!word) {
+        auto lock = deviceAccess();
+        const DeviceRange& range = deviceAt(address);
+        uint32_t old = range.device->read(address - range.start);
+        range.device->write(address - range.start, old + value);
+        return old;
+    }
+    uint32_t old = std::atomic_ref<uint32_t>(*word).fetch_add(value);
+    atomicWritten(address);
+    return old;
+}
+
+void Memory32::claim(IObserver* observer) {
+    auto lock = exclusive();
+    for (auto& watcher : observers_) {
+        if (watcher.observer == observer) {
+            watcher.owner = std::this_thread::get_id();
+        }
+    }
+}
+
+void Memory32::deliverWrites() {
+    std::vector<std::pair<IObserver*, std::vector<uint32_t>>> delivery;
+    {
+        auto lock = exclusive();
+        auto self = std::this_thread::get_id();
+        for (auto& watcher : observers_) {
+            if (watcher.owner == self && !watcher.pending.empty()) {
+                delivery.emplace_back(watcher.observer, std::move(watcher.pending));
+                watcher.pending.clear();
+            }
+        }
+    }
+    // Outside the lock, so observers may use the memory
+    for (const auto& [observer, addresses] : delivery) {
+        for (uint32_t address : addresses) {
+            observer->Update(address);
+        }
+    }
+}
+
+void Memory32::notifyConcurrent(uint32_t address) {
+    auto self = std::this_thread::get_id();
+    for (auto& watcher : observers_) {
+        if (watcher.owner == std::thread::id() || watcher.owner == self) {
+            watcher.observer->Update(address);
+        } else {
+            watcher.pending.push_back(address);
+        }
+    }
+}
+
+void Memory32::markRange(uint32_t address, size_t count) {
+    forEachPage(address, count, [&](uint32_t index, uint32_t, size_t, size_t) {
+        if (!(table[index] & DIRTY)) {
+            markDirty(index);
+        }
+    });
+}
+
+void Memory32::notifyRange(uint32_t address, size_t count) {
+    if (observers_.empty()) {
+        return;
+    }
+    forEachPage(address, count, [&](uint32_t index, uint32_t, size_t chunk, size_t done) {
+        if (table[index] & WATCHED) {
+            for (size_t i = 0; i < chunk; ++i) {
+                notifyWrite(static_cast<uint32_t>(address + done + i));
+            }
+        }
+    });
+}
+
+std::span<uint32_t> Memory32::loadBlock(uint32_t address, std::span<uint32_t> out) const {
+    checkRange(address, out.size());
+    if (base) {
+        std::memcpy(out.data(), base + address, out.size_bytes());
+        return out;
+    }
+    forEachPage(address, out.size(), [&](uint32_t index, uint32_t offset, size_t chunk, size_t done) {
+        uintptr_t entry = entryAt(index, std::memory_order_acquire);
+        const uint32_t* page = words(entry);
+        if (page) {
+            std::memcpy(out.data() + done, page + offset, chunk * sizeof(uint32_t));
+        } else if (entry & DEVICE) {
+            for (size_t i = 0; i < chunk; ++i) {
+                out[done + i] = deviceLoad(static_cast<uint32_t>(address + done + i));
+            }
+        } else {
+            std::fill_n(out.data() + done, chunk, 0u);
+        }
+    });
+    return out;
+}
+
+void Memory32::storeBlock(uint32_t address, std::span<const uint32_t> values) {
+    checkRange(address, values.size());
+    if (base) {
+        std::memcpy(base + address, values.data(), values.size_bytes());
+        auto lock = exclusive();
+        markRange(address, values.size());
+        notifyRange(address, values.size());
+        return;
+    }
+    // The lock is taken a page at a time, and not at all for device pages
+    forEachPage(address, values.size(), [&](uint32_t index, uint32_t offset, size_t chunk, size_t done) {
+        const uint32_t* source = values.data() + done;
+        auto first = static_cast<uint32_t>(address + done);
+        bool device = isDevicePage(index);
+        if (device) {
+            for (size_t i = 0; i < chunk; ++i) {
+                deviceStore(static_cast<uint32_t>(first + i), source[i]);
+            }
+        }
+        auto lock = exclusive();
+        // Zeros into an untouched page change nothing
+        if (!device && (words(table[index]) ||
+                        !std::all_of(source, source + chunk, [](uint32_t word) { return word == 0; }))) {
+            std::memcpy(writablePage(index) + offset, source, chunk * sizeof(uint32_t));
+        }
+        notifyRange(first, chunk);
+    });
+}
+
+void Memory32::fill(uint32_t address, size_t count, uint32_t value) {
+    checkRange(address, count);
+    if (base) {
+        std::fill_n(base + address, count, value);
+        auto lock = exclusive();
+        markRange(address, count);
+        notifyRange(address, count);
+        return;
+    }
+    // As storeBlock, the lock a page at a time and not for device pages
+    forEachPage(address, count, [&](uint32_t index, uint32_t offset, size_t chunk, size_t done) {
+        auto first = static_cast<uint32_t>(address + done);
+        bool device = isDevicePage(index);
+        if (device) {
+            for (size_t i = 0; i < chunk; ++i) {
+                deviceStore(static_cast<uint32_t>(first + i), value);
+            }
+        }
+        auto lock = exclusive();
+        if (!device && (value != 0 || words(table[index]))) {
+            std::fill_n(writablePage(index) + offset, chunk, value);
+        }
+        notifyRange(first, chunk);
+    });
+}
+
+void Memory32::copy(uint32_t destination, uint32_t source, size_t count) {
+    checkRange(destination, count);
+    checkRange(source, count);
+    if (count == 0 || destination == source) {
+        return;
+    }
+    if (base) {
+        std::memmove(base + destination, base + source, count * sizeof(uint32_t));
+        auto lock = exclusive();
+        markRange(destination, count);
+        notifyRange(destination, count);
+    } else {
+        // Page-sized pieces through a buffer. Copying them from the end first when the
+        // destination is above the source means overlapping words are read before
+        // they are overwritten.
+        uint32_t buffer[PAGE_WORDS];
+        bool backwards = destination > source;
+        for (size_t done = 0; done < count; done += PAGE_WORDS) {
+            size_t chunk = std::min<size_t>(PAGE_WORDS, count - done);
+            size_t start = backwards ? count - done - chunk : done;
+            std::span<uint32_t> piece(buffer, chunk);
+            storeBlock(static_cast<uint32_t>(destination + start),
+                       loadBlock(static_cast<uint32_t>(source + start), piece));
+        }
+        // storeBlock has notified
+    }
+}
+
+size_t Memory32::compare(uint32_t first, uint32_t second, size_t count) const {
+    checkRange(first, count);
+    checkRange(second, count);
+    if (base) {
+        const uint32_t* a = base + first;
+        const uint32_t* b = base + second;
+        // memcmp finds the differing region; mismatch then finds the word within it
+        for (size_t done = 0; done < count; done += PAGE_WORDS) {
+            size_t chunk = std::min<size_t>(PAGE_WORDS, count - done);
+            if (std::memcmp(a + done, b + done, chunk * sizeof(uint32_t)) != 0) {
+                return done + (std::mismatch(a + done, a + done + chunk, b + done).first - (a + done));
+            }
+        }
+        return count;
+    }
+    uint32_t left[PAGE_WORDS];
+    uint32_t right[PAGE_WORDS];
+    for (size_t done = 0; done < count; done += PAGE_WORDS) {
+        size_t chunk = std::min<size_t>(PAGE_WORDS, count - done);
+        loadBlock(static_cast<uint32_t>(first + done), std::span<uint32_t>(left, chunk));
+        loadBlock(static_cast<uint32_t>(second + done), std::span<uint32_t>(right, chunk));
+        if (std::memcmp(left, right, chunk * sizeof(uint32_t)) != 0) {
+            return done + (std::mismatch(left, left + chunk, right).first - left);
+        }
+    }
+    return count;
+}
+
+void Memory32::mapDevice(uint32_t address, size_t count, std::shared_ptr<Device32> device) {
+    if (base) {
+        throw std::logic_error("Memory-mapped devices need Mode::Checked");
+    }
+    if (address & PAGE_MASK) {
+        throw std::invalid_argument("Device address must be page aligned");
+    }
+    size_t pagesSpanned = (count + PAGE_WORDS - 1) >> PAGE_SHIFT;
+    uint64_t end = static_cast<uint64_t>(address) + (pagesSpanned << PAGE_SHIFT);
+    if (count == 0 || end > (static_cast<uint64_t>(pageCount) << PAGE_SHIFT)) {
+        throw std::out_of_range("Device range does not fit in memory");
+    }
+    auto position = std::lower_bound(devices.begin(), devices.end(), address,
+                                     [](const DeviceRange& range, uint32_t start) { return range.start < start; });
+    if ((position != devices.end() && position->start < end) ||
+        (position != devices.begin() && std::prev(position)->end > address)) {
+        throw std::invalid_argument("Device range overlaps another device");
+    }
+    devices.insert(position, {address, end, std::move(device)});
+
+    for (size_t page = 0; page < pagesSpanned; ++page) {
+        uint32_t index = (address >> PAGE_SHIFT) + static_cast<uint32_t>(page);
+        setPage(index, nullptr);
+        table[index] |= DEVICE;
+    }
+}
+
+void Memory32::replaceDevice(const Device32* device, std::shared_ptr<Device32> replacement) {
+    auto lock = exclusive();
+    for (DeviceRange& range : devices) {
+        if (range.device.get() == device) {
+            range.device = replacement;
+        }
+    }
+}
+
+uint32_t Memory32::deviceLoad(uint32_t address) const {
+    auto lock = deviceAccess();
+    const DeviceRange& range = deviceAt(address);
+    return range.device->read(address - range.start);
+}
+
+void Memory32::deviceStore(uint32_t address, uint32_t value) {
+    auto lock = deviceAccess();
+    const DeviceRange& range = deviceAt(address);
+    range.device->write(address - range.start, value);
+}
+
+const Memory32::DeviceRange& Memory32::deviceAt(uint32_t address) const {
+    // Device pages only exist inside a range, so the last range starting at or below
+    // address is the one
+    auto position = std::upper_bound(devices.begin(), devices.end(), address,
+                                     [](uint32_t start, const DeviceRange& range) { return start < range.start; });
+    return *std::prev(position);
+}
+
+std::vector<uint32_t> Memory32::dirtyPages() const {
+    std::vector<uint32_t> indices;
+    for (size_t word = 0; word < dirty.size(); ++word) {
+        for (uint64_t bits = dirty[word]; bits; bits &= bits - 1) {
+            auto index = static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+            if (!isDevicePage(index)) {
+                indices.push_back(index);
+            }
+        }
+    }
+    return indices;
+}
+
+void Memory32::clearDirty() {
+    for (size_t word = 0; word < dirty.size(); ++word) {
+        for (uint64_t bits = dirty[word]; bits; bits &= bits - 1) {
+            table[word * 64 + std::countr_zero(bits)] &= ~DIRTY;
+        }
+        dirty[word] = 0;
+    }
+}
+
+void Memory32::reset() {
+#if CPU32_GUARD_PAGES && CPU32_MMAP_AVAILABLE
+    if (base) {
+        // A fresh anonymous mapping over the accessible prefix zeroes it and replaces
+        // any images mapped into it
+        if (reservation->accessible &&
+            mmap(base, reservation->accessible, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0) == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+    }
+#endif
+    // Before the walk, which marks the watched pages written again
+    std::fill(writtenBits.begin(), writtenBits.end(), 0);
+    for (size_t index = 0; index < pageCount; ++index) {
+        uintptr_t& entry = table[index];
+        if (!(entry & (WATCHED | WRITTEN)) && !words(entry)) {
+            continue;
+        }
+        bool hadContents = base || words(entry);
+        entry &= WATCHED | DEVICE; // Clears WRITTEN, unlike clearDirty()
+        if (hadContents && (entry & WATCHED)) {
+            pageReplaced(static_cast<uint32_t>(index));
+        }
+    }
+    pages.clear();
+    mappings.clear();
+    clearDirty();
+}
+
+std::vector<uint32_t> Memory32::writtenPages() const {
+    std::vector<uint32_t> indices;
+    for (size_t word = 0; word < writtenBits.size(); ++word) {
+        for (uint64_t bits = writtenBits[word]; bits; bits &= bits - 1) {
+            auto index = static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+            if (!isDevicePage(index)) {
+                indices.push_back(index);
+            }
+        }
+    }
+    return indices;
+}
+
+uint64_t Memory32::digest() const {
+    // FNV-1a over the index and words of every page holding a non-zero word, taking a
+    // word rather than a byte per step
+    constexpr uint64_t PRIME = 0x100000001B3;
+    uint64_t hash = 0xCBF29CE484222325;
+    uint32_t buffer[PAGE_WORDS];
+    for (uint32_t index : writtenPages()) {
+        uint32_t address = index << PAGE_SHIFT;
+        size_t count = std::min<size_t>(PAGE_WORDS, size - address);
+        std::span<uint32_t> words = loadBlock(address, std::span<uint32_t>(buffer, count));
+        if (std::all_of(words.begin(), words.end(), [](uint32_t word) { return word == 0; })) {
+            continue;
+        }
+        hash = (hash ^ index) * PRIME;
+        for (uint32_t word : words) {
+            hash = (hash ^ word) * PRIME;
+        }
+    }
+    return hash;
+}
+
+std::shared_ptr<Memory32> Memory32::fork() {
+    auto child = std::make_shared<Memory32>(size);
+    child->dirty = dirty;
+    child->writtenBits = writtenBits;
+    child->devices = devices;
+    if (base) {
+        for (uint32_t index : writtenPages()) {
+            auto page = std::make_shared<Page>();
+            std::memcpy(page->words, base + (index << PAGE_SHIFT), sizeof(Page));
+            child->table[index] = (table[index] & (DIRTY | WRITTEN)) | reinterpret_cast<uintptr_t>(page->words);
+            child->pages.emplace(index, std::move(page));
+        }
+        return child;
+    }
+    child->pages = pages;
+    child->mappings = mappings;
+    // Every other entry is empty or merely watched, which the child starts as. Device
+    // pages may have lost WRITTEN to a reset(), so their ranges are walked as well.
+    auto share = [&](size_t index) {
+        uintptr_t& entry = table[index];
+        if (words(entry)) {
+            entry |= SHARED;
+        }
+        child->table[index] = entry & ~WATCHED;
+    };
+    for (size_t word = 0; word < writtenBits.size(); ++word) {
+        for (uint64_t bits = writtenBits[word]; bits; bits &= bits - 1) {
+            share(word * 64 + std::countr_zero(bits));
+        }
+    }
+    for (const DeviceRange& range : devices) {
+        for (uint64_t index = range.start >> PAGE_SHIFT; index < range.end >> PAGE_SHIFT; ++index) {
+            share(index);
+        }
+    }
+    return child;
+}
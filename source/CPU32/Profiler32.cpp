@@ -0,0 +1,147 @@
+#include <CPU32/Profiler32.hpp>
+#include <algorithm>
+#include <cstdio>
+
+Profiler32::Profiler32() = default;
+
+Profiler32::~Profiler32() {
+    clearTree();
+}
+
+void Profiler32::reset() {
+    total = 0;
+    opcodes.fill(0);
+    pcs.clear();
+    branchCounts.clear();
+    clearTree();
+    root.self = 0;
+    current = &root;
+    stack.clear();
+    active.clear();
+    callCount.clear();
+    inclusiveDone.clear();
+}
+
+void Profiler32::setSymbol(uint32_t address, const std::string& name) {
+    symbols[address] = name;
+}
+
+void Profiler32::enter(uint32_t target) {
+    ++callCount[target];
+    stack.push_back({target, total});
+    ++active[target];
+
+    auto& child = current->children[target];
+    if (!child) {
+        child = std::make_unique<Node>();
+        child->target = target;
+        child->parent = current;
+    }
+    current = child.get();
+}
+
+void Profiler32::leave() {
+    if (stack.empty()) {
+        return; // RET without a matching CALL: stay at the root
+    }
+    Frame frame = stack.back();
+    stack.pop_back();
+    // Only the outermost frame of a recursive target adds to its inclusive count
+    if (--active[frame.target] == 0) {
+        inclusiveDone[frame.target] += total - frame.start;
+    }
+    current = current->parent;
+}
+
+void Profiler32::clearTree() {
+    // The tree is one level deeper per nested CALL, so each node is unlinked from its
+    // children before it is freed rather than letting ~Node recurse
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (auto& [target, child] : root.children) {
+        nodes.push_back(std::move(child));
+    }
+    root.children.clear();
+    while (!nodes.empty()) {
+        std::unique_ptr<Node> node = std::move(nodes.back());
+        nodes.pop_back();
+        for (auto& [target, child] : node->children) {
+            nodes.push_back(std::move(child));
+        }
+    }
+}
+
+std::map<uint32_t, Profiler32::CallCounts> Profiler32::calls() const {
+    std::map<uint32_t, CallCounts> result;
+    for (const auto& [target, count] : callCount) {
+        result[target].calls = count;
+    }
+    for (const auto& [target, count] : inclusiveDone) {
+        result[target].inclusive += count;
+    }
+    // Frames still on the stack: the outermost one per target covers everything since
+    std::unordered_map<uint32_t, bool> seen;
+    for (const auto& frame : stack) {
+        if (!seen[frame.target]) {
+            seen[frame.target] = true;
+            result[frame.target].inclusive += total - frame.start;
+        }
+    }
+
+    std::vector<const Node*> pending{&root};
+    while (!pending.empty()) {
+        const Node* node = pending.back();
+        pending.pop_back();
+        for (const auto& [target, child] : node->children) {
+            result[target].exclusive += child->self;
+            pending.push_back(child.get());
+        }
+    }
+    return result;
+}
+
+std::string Profiler32::frameName(uint32_t target) const {
+    auto symbol = symbols.find(target);
+    if (symbol != symbols.end()) {
+        return symbol->second;
+    }
+    char name[16];
+    std::snprintf(name, sizeof(name), "0x%08X", target);
+    return name;
+}
+
+void Profiler32::writeCollapsedStacks(std::ostream& out) const {
+    // Depth-first with an explicit stack, since the tree is as deep as the guest's calls
+    struct Level {
+        std::vector<std::pair<uint32_t, const Node*>> children;
+        size_t next;
+        size_t pathLength;
+    };
+    std::string path = "root";
+    std::vector<Level> levels;
+    auto open = [&](const Node& node) {
+        if (node.self) {
+            out << path << ' ' << node.self << '\n';
+        }
+        Level& level = levels.emplace_back();
+        for (const auto& [target, child] : node.children) {
+            level.children.emplace_back(target, child.get());
+        }
+        // Sorted so the output is stable from run to run
+        std::sort(level.children.begin(), level.children.end());
+        level.next = 0;
+        level.pathLength = path.size();
+    };
+
+    open(root);
+    while (!levels.empty()) {
+        Level& level = levels.back();
+        if (level.next == level.children.size()) {
+            levels.pop_back();
+            continue;
+        }
+        auto [target, child] = level.children[level.next++];
+        path.resize(level.pathLength);
+        path += ';' + frameName(target);
+        open(*child);
+    }
+}
@@ -0,0 +1,84 @@
+#include <CPU32/Scheduler32.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+Scheduler32::Scheduler32(uint64_t slice) : slice(slice) {
+    if (slice == 0) {
+        throw std::invalid_argument("A scheduler slice must be at least one instruction");
+    }
+}
+
+Scheduler32::GuestId Scheduler32::spawn(std::shared_ptr<FastCPU32> cpu, uint64_t maxInstructions) {
+    if (!cpu) {
+        throw std::invalid_argument("Guest has no CPU");
+    }
+    auto guest = std::make_unique<Guest>();
+    guest->cpu = std::move(cpu);
+    guest->budget = maxInstructions;
+    guest->task = execute(*guest);
+    ready.push_back(guest.get());
+    guests.push_back(std::move(guest));
+    return guests.size() - 1;
+}
+
+size_t Scheduler32::run() {
+    while (true) {
+        // Wake the guests whose device has become ready, in the order they began waiting
+        size_t kept = 0;
+        for (Guest* guest : waiting) {
+            if (deviceReady(*guest)) {
+                ready.push_back(guest);
+            } else {
+                waiting[kept++] = guest;
+            }
+        }
+        waiting.resize(kept);
+        if (ready.empty()) {
+            return waiting.size();
+        }
+
+        // One pass over the guests ready now; those that yield queue up for the next
+        for (size_t count = ready.size(); count > 0; --count) {
+            Guest* guest = ready.front();
+            ready.pop_front();
+            guest->task.resume();
+            if (guest->task.done()) {
+                guest->task = {}; // Frees the frame
+            }
+        }
+    }
+}
+
+GuestTask32 Scheduler32::execute(Guest& guest) {
+    FastCPU32& cpu = *guest.cpu;
+    RunResult32& total = guest.result;
+    while (true) {
+        RunResult32 run = cpu.run(std::min(slice, guest.budget - total.instructions));
+        total.instructions += run.instructions;
+        total.cycles += run.cycles;
+        total.reason = run.reason;
+        total.fault = std::move(run.fault);
+
+        if (run.reason == StopReason32::IOWait) {
+            // The PC is left on the IN or OUT that has to wait
+            uint32_t instruction = cpu.GetMemory()->load(cpu.GetProgramCounter()->GetState());
+            uint8_t opcode = (instruction >> 24) & 0xFF;
+            guest.waitOpcode = opcode == 0x40 || opcode == 0x41 ? opcode : 0;
+            guest.waitPort = (instruction >> 8) & 0xFF;
+            co_await Suspend{*this, guest, true};
+        } else if (run.reason == StopReason32::BudgetExhausted && total.instructions < guest.budget) {
+            co_await Suspend{*this, guest, false};
+        } else {
+            guest.finished = true;
+            co_return;
+        }
+    }
+}
+
+bool Scheduler32::deviceReady(const Guest& guest) const {
+    switch (guest.waitOpcode) {
+        case 0x40: return guest.cpu->GetBus()->ready(guest.waitPort);
+        case 0x41: return guest.cpu->GetBus()->writable(guest.waitPort);
+        default: return true;
+    }
+}
@@ -31,6 +31,13 @@ uint32_t Instructor::parseRegister(const std::string& reg) {
     return std::stoi(reg.substr(1));
 }
 
+uint32_t Instructor::parseVectorRegister(const std::string& reg) {
+    if (reg[0] != 'v' && reg[0] != 'V') {
+        throw std::runtime_error("Invalid vector register format");
+    }
+    return std::stoi(reg.substr(1));
+}
+
 uint32_t Instructor::parseImmediate(const std::string& imm, int bitSize) {
     uint32_t value;
     std::stringstream ss;
@@ -127,10 +134,41 @@ std::vector<uint32_t> Instructor::assemble(const std::string& code) {
             instructions.push_back(instruction);
             address++;
         } else if (opcode == opcodeMap["MOV_REG"] || opcode == opcodeMap["CMP_REG"] || opcode == opcodeMap["ADD"] ||
-                   opcode == opcodeMap["SUB"] || opcode == opcodeMap["AND"] || opcode == opcodeMap["OR"] || opcode == opcodeMap["XOR"]) {
+                   opcode == opcodeMap["SUB"] || opcode == opcodeMap["AND"] || opcode == opcodeMap["OR"] || opcode == opcodeMap["XOR"] ||
+                   opcode == opcodeMap["XADD"] || (opcode >= opcodeMap["MUL"] && opcode <= opcodeMap["CLZ"])) {
             instruction = (opcode << 24) | (parseRegister(tokens[1]) << 16) | (parseRegister(tokens[2]) << 8);
             instructions.push_back(instruction);
             address++;
+        } else if (opcode == opcodeMap["BMOV"] || opcode == opcodeMap["BFILL"] || opcode == opcodeMap["BCMP"] ||
+                   opcode == opcodeMap["CAS"]) {
+            if (tokens.size() != 4) {
+                throw std::runtime_error("Invalid instruction format");
+            }
+            instruction = (opcode << 24) | (parseRegister(tokens[1]) << 16) | (parseRegister(tokens[2]) << 8) |
+                          parseRegister(tokens[3]);
+            instructions.push_back(instruction);
+            address++;
+        } else if (opcode >= opcodeMap["VLOAD"] && opcode <= opcodeMap["VSPLAT"]) {
+            // Vector operations on V registers; addresses, VSUM's result and VSPLAT's value are R registers
+            if (tokens.size() != 3) {
+                throw std::runtime_error("Invalid instruction format");
+            }
+            bool scalarFirst = opcode == opcodeMap["VSUM"];
+            bool scalarSecond = opcode == opcodeMap["VLOAD"] || opcode == opcodeMap["VSTORE"] || opcode == opcodeMap["VSPLAT"];
+            uint32_t first = scalarFirst ? parseRegister(tokens[1]) : parseVectorRegister(tokens[1]);
+            uint32_t second = scalarSecond ? parseRegister(tokens[2]) : parseVectorRegister(tokens[2]);
+            instruction = (opcode << 24) | (first << 16) | (second << 8);
+            instructions.push_back(instruction);
+            address++;
+        } else if ((opcode == opcodeMap["IN"] || opcode == opcodeMap["OUT"]) && tokens.size() == 3) {
+            // IN/OUT register, port
+            uint32_t port = parseImmediate(tokens[2], 16);
+            if (port > 0xFF) {
+                throw std::runtime_error("Port out of range: " + tokens[2]);
+            }
+            instruction = (opcode << 24) | (parseRegister(tokens[1]) << 16) | (port << 8);
+            instructions.push_back(instruction);
+            address++;
         } else if (opcode == opcodeMap["NOT"] || opcode == opcodeMap["IN"] || opcode == opcodeMap["OUT"]) {
             instruction = (opcode << 24) | (parseRegister(tokens[1]) << 16);
             instructions.push_back(instruction);
@@ -179,6 +217,20 @@ void Instructor::initializeOpcodeMap() {
     opcodeMap["OR"] = 0x08;
     opcodeMap["XOR"] = 0x09;
     opcodeMap["NOT"] = 0x0A;
+    opcodeMap["MUL"] = 0x20;
+    opcodeMap["MULH"] = 0x21;
+    opcodeMap["MULHS"] = 0x22;
+    opcodeMap["DIV"] = 0x23;
+    opcodeMap["MOD"] = 0x24;
+    opcodeMap["SDIV"] = 0x25;
+    opcodeMap["SMOD"] = 0x26;
+    opcodeMap["SHL"] = 0x27;
+    opcodeMap["SHR"] = 0x28;
+    opcodeMap["SAR"] = 0x29;
+    opcodeMap["ROL"] = 0x2A;
+    opcodeMap["ROR"] = 0x2B;
+    opcodeMap["POPCNT"] = 0x2C;
+    opcodeMap["CLZ"] = 0x2D;
     opcodeMap["CMP_IMM16"] = 0x10;
     opcodeMap["CMP_REG"] = 0x11;
     opcodeMap["JMP"] = 0x12;
@@ -190,6 +242,26 @@ void Instructor::initializeOpcodeMap() {
     opcodeMap["JGE"] = 0x18;
     opcodeMap["CALL"] = 0x30;
     opcodeMap["RET"] = 0x31;
+    opcodeMap["BMOV"] = 0x50;
+    opcodeMap["BFILL"] = 0x51;
+    opcodeMap["BCMP"] = 0x52;
+    opcodeMap["CAS"] = 0x60;
+    opcodeMap["XADD"] = 0x61;
+    opcodeMap["FENCE"] = 0x62;
+    opcodeMap["EI"] = 0x70;
+    opcodeMap["DI"] = 0x71;
+    opcodeMap["IRET"] = 0x72;
+    opcodeMap["VLOAD"] = 0x80;
+    opcodeMap["VSTORE"] = 0x81;
+    opcodeMap["VADD"] = 0x82;
+    opcodeMap["VSUB"] = 0x83;
+    opcodeMap["VAND"] = 0x84;
+    opcodeMap["VOR"] = 0x85;
+    opcodeMap["VXOR"] = 0x86;
+    opcodeMap["VCMPEQ"] = 0x87;
+    opcodeMap["VCMPGT"] = 0x88;
+    opcodeMap["VSUM"] = 0x89;
+    opcodeMap["VSPLAT"] = 0x8A;
     opcodeMap["IN"] = 0x40;
     opcodeMap["OUT"] = 0x41;
     opcodeMap["HLT"] = 0xFF;
@@ -5,9 +5,14 @@
 #include <string>
 #include <stdexcept>
 #include <CPU32/CPU32.hpp>
+#include <CPU32/Batch32.hpp>
 #include <regex>
 #include <algorithm>
 #include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <span>
 
 //// Function to convert a string to a uint32_t value, handling both hex and decimal formats
 //uint32_t stringToUInt32(const std::string& str) {
@@ -305,6 +310,8 @@ void showHelp() {
     std::cout << "  print               - Print the CPU state (registers, PC, flags)\n";
     std::cout << "  clr                 - Clear the console\n";
     std::cout << "  reset               - Reset the CPU state\n";
+    std::cout << "  save <file>         - Write a checkpoint of the CPU state to a file\n";
+    std::cout << "  restore <file>      - Load a checkpoint written by save\n";
 }
 
 void printCPUState(const CPU32& cpu) {
@@ -319,12 +326,37 @@ void printCPUState(const CPU32& cpu) {
     std::cout << "Halted: " << (cpu.halted ? "True" : "False") << std::endl;
 }
 
-void printMemory(const CPU32& cpu, uint32_t startAddress, uint32_t endAddress) {
+// Calls show(address, value) for every word from startAddress to endAddress inclusive,
+// loading a page at a time so that a large range never needs a buffer of its size.
+// Returns false, showing nothing, if the range is reversed or runs past the memory.
+template <typename Show>
+bool forEachMemoryWord(const CPU32& cpu, uint32_t startAddress, uint32_t endAddress, Show show) {
     auto memory = cpu.GetMemory();
+    if (endAddress < startAddress || endAddress >= memory->getSize()) {
+        return false;
+    }
+    uint32_t buffer[Memory32::PAGE_WORDS];
+    uint64_t end = static_cast<uint64_t>(endAddress) + 1;
+    for (uint64_t address = startAddress; address < end; address += Memory32::PAGE_WORDS) {
+        std::span<uint32_t> values(buffer, static_cast<size_t>(std::min<uint64_t>(Memory32::PAGE_WORDS, end - address)));
+        memory->loadBlock(static_cast<uint32_t>(address), values);
+        for (size_t i = 0; i < values.size(); ++i) {
+            show(static_cast<uint32_t>(address + i), values[i]);
+        }
+    }
+    return true;
+}
+
+void printMemory(const CPU32& cpu, uint32_t startAddress, uint32_t endAddress) {
+    if (endAddress < startAddress) {
+        std::swap(startAddress, endAddress);
+    }
     std::cout << "Memory contents from " << uint32ToHexString(startAddress) << " to " << uint32ToHexString(endAddress) << ":" << std::endl;
-    for (uint32_t address = startAddress; address <= endAddress; ++address) {
-        uint32_t value = memory->load(address);
+    bool shown = forEachMemoryWord(cpu, startAddress, endAddress, [](uint32_t address, uint32_t value) {
         std::cout << uint32ToHexString(address) << ": " << uint32ToHexString(value) << std::endl;
+    });
+    if (!shown) {
+        std::cerr << "Memory range out of bounds." << std::endl;
     }
 }
 
@@ -375,8 +407,133 @@ std::string getInstructionDescription(uint32_t opcode) {
     }
 }
 
-int main() {
-    CPU32 cpu(1024);
+const char* stopReasonName(StopReason32 reason) {
+    switch (reason) {
+        case StopReason32::Halted: return "halted";
+        case StopReason32::BudgetExhausted: return "budget";
+        case StopReason32::Breakpoint: return "breakpoint";
+        case StopReason32::Fault: return "fault";
+        case StopReason32::IOWait: return "iowait";
+    }
+    return "?";
+}
+
+// Reads a binary image: words in host byte order, as for CPU32::loadImage
+std::vector<uint32_t> readImage(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    auto bytes = static_cast<size_t>(file.tellg());
+    if (bytes % sizeof(uint32_t)) {
+        throw std::runtime_error(path + " is not a whole number of words");
+    }
+    std::vector<uint32_t> words(bytes / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(words.data()), static_cast<std::streamsize>(bytes));
+    return words;
+}
+
+void showBatchUsage() {
+    std::cerr << "Usage: CPUSimulator --batch <list> [--threads N] [--budget N] [--memory WORDS]\n";
+    std::cerr << "  Each line of <list> names a program image and optionally an input image.\n";
+    std::cerr << "  The program runs from address 0 with R0 = input address, R1 = input words.\n";
+    std::cerr << "  Prints one line per job: program, stop reason, instructions, memory digest\n";
+    std::cerr << "  and R0-R15.\n";
+}
+
+// Runs every job of a list file on a BatchRunner32 and prints the results in list order
+int runBatch(int argc, char* argv[]) {
+    std::string listPath;
+    size_t threads = 0;
+    BatchOptions32 options;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            std::string argument = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (argument == "--threads" && hasValue) {
+                threads = std::stoull(argv[++i], nullptr, 0);
+            } else if (argument == "--budget" && hasValue) {
+                options.maxInstructions = std::stoull(argv[++i], nullptr, 0);
+            } else if (argument == "--memory" && hasValue) {
+                options.memorySize = std::stoull(argv[++i], nullptr, 0);
+            } else if (argument.starts_with("--")) {
+                throw std::invalid_argument(argument);
+            } else {
+                listPath = argument;
+            }
+        }
+    } catch (const std::exception&) {
+        showBatchUsage();
+        return 1;
+    }
+    if (listPath.empty()) {
+        showBatchUsage();
+        return 1;
+    }
+
+    std::vector<BatchJob32> jobs;
+    std::vector<std::string> names;
+    try {
+        std::ifstream list(listPath);
+        if (!list) {
+            throw std::runtime_error("Cannot open " + listPath);
+        }
+        // Jobs naming the same program share one copy of it
+        std::map<std::string, std::shared_ptr<const std::vector<uint32_t>>> programs;
+        std::string line;
+        while (std::getline(list, line)) {
+            std::istringstream fields(line);
+            std::string programPath, inputPath;
+            if (!(fields >> programPath) || programPath[0] == '#') {
+                continue;
+            }
+            auto& program = programs[programPath];
+            if (!program) {
+                program = std::make_shared<const std::vector<uint32_t>>(readImage(programPath));
+            }
+            BatchJob32 job{program, {}};
+            if (fields >> inputPath) {
+                job.input = readImage(inputPath);
+            }
+            jobs.push_back(std::move(job));
+            names.push_back(programPath);
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    BatchRunner32 runner(threads);
+    auto start = std::chrono::steady_clock::now();
+    auto results = runner.run(jobs, options);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    uint64_t instructions = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        instructions += result.instructions;
+        std::cout << names[i] << ' ' << stopReasonName(result.reason) << ' ' << std::dec << result.instructions << ' '
+                  << std::hex << std::setw(16) << std::setfill('0') << result.memoryDigest;
+        for (uint32_t value : result.registers) {
+            std::cout << ' ' << uint32ToHexString(value);
+        }
+        std::cout << std::dec << '\n';
+    }
+    std::cerr << results.size() << " jobs, " << instructions << " instructions in " << elapsed.count() << " s ("
+              << static_cast<double>(instructions) / 1e6 / std::max(elapsed.count(), 1e-9) << " MIPS) on "
+              << runner.threads() << " threads" << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        return runBatch(argc, argv);
+    }
+
+    // `reset` forks this untouched machine rather than building a new one
+    const CPU32 pristine(1024);
+    CPU32 cpu = pristine.fork();
     std::string line;
     std::vector<uint32_t> program;
 
@@ -501,8 +658,15 @@ int main() {
                     endAddress = stringToUInt32(match[3]);
                 }
 
-                for (uint32_t addr = startAddress; addr <= endAddress; ++addr) {
-                    std::cout << "Memory[" << uint32ToHexString(addr) << "]: " << uint32ToHexString(cpu.GetMemory()->load(addr)) << std::endl;
+                if (endAddress < startAddress) {
+                    std::cerr << "Memory range ends before it starts." << std::endl;
+                    continue;
+                }
+                bool shown = forEachMemoryWord(cpu, startAddress, endAddress, [](uint32_t address, uint32_t value) {
+                    std::cout << "Memory[" << uint32ToHexString(address) << "]: " << uint32ToHexString(value) << std::endl;
+                });
+                if (!shown) {
+                    std::cerr << "Memory range out of bounds." << std::endl;
                 }
             } else {
                 std::cerr << "Invalid memory range format." << std::endl;
@@ -512,9 +676,27 @@ int main() {
         } else if (command == "clr" || command == "clear") {
             std::cout << "\033[2J\033[1;1H"; // ANSI escape code to clear the console
         } else if (command == "reset") {
-            cpu = CPU32(1024); // Reinitialize the CPU to reset its state
+            cpu = pristine.fork();
             program.clear();
             std::cout << "CPU state reset." << std::endl;
+        } else if (command == "save" || command == "restore") {
+            std::string path;
+            if (!(iss >> path)) {
+                std::cerr << "No checkpoint file given." << std::endl;
+                continue;
+            }
+            try {
+                if (command == "save") {
+                    cpu.saveCheckpoint(path);
+                    std::cout << "Checkpoint written to " << path << "." << std::endl;
+                } else {
+                    cpu.loadCheckpoint(path);
+                    program.clear();
+                    std::cout << "Checkpoint restored from " << path << "." << std::endl;
+                }
+            } catch (const std::exception& error) {
+                std::cerr << error.what() << std::endl;
+            }
         } else {
             std::cerr << "Unknown command: " << command << std::endl;
         }
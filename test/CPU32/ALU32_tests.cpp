@@ -47,3 +47,59 @@ TEST_F(ALU32Test, NotOperation) {
     alu.setOperation(ALU32::NOT);
     EXPECT_EQ(alu.GetState(), ~0b1100);
 }
+
+TEST_F(ALU32Test, MultiplyOperations) {
+    alu.setInputs(0x12345678, 0x9ABCDEF0);
+    alu.setOperation(ALU32::MUL);
+    EXPECT_EQ(alu.GetState(), 0x242D2080u);
+    alu.setOperation(ALU32::MULH);
+    EXPECT_EQ(alu.GetState(), 0x0B00EA4Eu);
+    alu.setInputs(0xFFFFFFFE, 3); // -2 * 3
+    alu.setOperation(ALU32::MULHS);
+    EXPECT_EQ(alu.GetState(), 0xFFFFFFFFu);
+}
+
+TEST_F(ALU32Test, DivisionOperations) {
+    alu.setInputs(0xFFFFFFF9, 2); // -7 and 2
+    alu.setOperation(ALU32::DIV);
+    EXPECT_EQ(alu.GetState(), 0x7FFFFFFCu);
+    alu.setOperation(ALU32::MOD);
+    EXPECT_EQ(alu.GetState(), 1);
+    alu.setOperation(ALU32::SDIV);
+    EXPECT_EQ(alu.GetState(), static_cast<uint32_t>(-3));
+    alu.setOperation(ALU32::SMOD);
+    EXPECT_EQ(alu.GetState(), static_cast<uint32_t>(-1));
+
+    alu.setInputs(0x80000000, 0xFFFFFFFF); // INT_MIN / -1 wraps
+    EXPECT_EQ(alu.GetState(), 0);
+    alu.setOperation(ALU32::SDIV);
+    EXPECT_EQ(alu.GetState(), 0x80000000u);
+    alu.setInputs(5, 0);
+    EXPECT_EQ(alu.GetState(), 0);
+}
+
+TEST_F(ALU32Test, ShiftAndRotateOperations) {
+    alu.setInputs(0x80000001, 33); // Counts are taken modulo 32
+    alu.setOperation(ALU32::SHL);
+    EXPECT_EQ(alu.GetState(), 2);
+    alu.setOperation(ALU32::SHR);
+    EXPECT_EQ(alu.GetState(), 0x40000000u);
+    alu.setOperation(ALU32::SAR);
+    EXPECT_EQ(alu.GetState(), 0xC0000000u);
+    alu.setOperation(ALU32::ROL);
+    EXPECT_EQ(alu.GetState(), 3);
+    alu.setOperation(ALU32::ROR);
+    EXPECT_EQ(alu.GetState(), 0xC0000000u);
+    alu.setInputs(0x80000001, 0);
+    EXPECT_EQ(alu.GetState(), 0x80000001u);
+}
+
+TEST_F(ALU32Test, BitCountOperations) {
+    alu.setInputs(0x00F0F001, 0);
+    alu.setOperation(ALU32::POPCNT);
+    EXPECT_EQ(alu.GetState(), 9);
+    alu.setOperation(ALU32::CLZ);
+    EXPECT_EQ(alu.GetState(), 8);
+    alu.setInputs(0, 0);
+    EXPECT_EQ(alu.GetState(), 32);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <CPU32/Batch32.hpp>
+#include <numeric>
+#include <random>
+
+namespace {
+
+// Sums the input into R2 and stores the sum just past it
+std::shared_ptr<const std::vector<uint32_t>> sumProgram() {
+    return std::make_shared<const std::vector<uint32_t>>(std::vector<uint32_t>{
+            0x02020000, // 0: MOV R2, 0
+            0x02070001, // 1: MOV R7, 1
+            0x10010000, // 2: CMP R1, 0
+            0x13000009, // 3: JZ 9
+            0x03030000, // 4: LOAD R3, [R0]
+            0x05020300, // 5: ADD R2, R3
+            0x05000700, // 6: ADD R0, R7
+            0x06010700, // 7: SUB R1, R7
+            0x12000002, // 8: JMP 2
+            0x04020000, // 9: STORE R2, [R0]
+            0xFF000000  // 10: HLT
+    });
+}
+
+} // namespace
+
+TEST(Batch32Test, RunsJobsWithTheirInputs) {
+    auto program = sumProgram();
+    std::vector<BatchJob32> jobs;
+    std::mt19937 random(7);
+    for (int i = 0; i < 300; ++i) {
+        // Uneven lengths, so some threads finish early and steal
+        std::vector<uint32_t> input(random() % (i % 10 == 0 ? 2000 : 50));
+        for (auto& word : input) {
+            word = random() % 1000;
+        }
+        jobs.push_back({program, std::move(input)});
+    }
+
+    BatchRunner32 runner(4);
+    auto results = runner.run(jobs);
+    ASSERT_EQ(results.size(), jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const auto& input = jobs[i].input;
+        EXPECT_EQ(results[i].reason, StopReason32::Halted);
+        EXPECT_EQ(results[i].registers[2], std::accumulate(input.begin(), input.end(), 0u));
+        EXPECT_EQ(results[i].instructions, 6 + input.size() * 7);
+
+        BatchResult32 alone = BatchRunner32::runOne(jobs[i]);
+        EXPECT_EQ(results[i].registers, alone.registers);
+        EXPECT_EQ(results[i].pc, alone.pc);
+        EXPECT_EQ(results[i].memoryDigest, alone.memoryDigest);
+    }
+    EXPECT_NE(results[1].memoryDigest, results[2].memoryDigest);
+}
+
+TEST(Batch32Test, ReportsBudgetAndFaults) {
+    std::vector<BatchJob32> jobs = {
+            {std::make_shared<const std::vector<uint32_t>>(std::vector<uint32_t>{0x12000000}), {}}, // JMP 0
+            {std::make_shared<const std::vector<uint32_t>>(std::vector<uint32_t>{
+                    0x02027000,   // MOV R2, 0x7000
+                    0x03030200}), // LOAD R3, [R2]  (past the end of memory)
+             {}},
+            {nullptr, {}},
+            {sumProgram(), std::vector<uint32_t>(5000, 1)} // Does not fit
+    };
+    BatchOptions32 options;
+    options.memorySize = 4096;
+    options.maxInstructions = 1000;
+    auto results = BatchRunner32(2).run(jobs, options);
+    EXPECT_EQ(results[0].reason, StopReason32::BudgetExhausted);
+    EXPECT_EQ(results[0].instructions, 1000);
+    EXPECT_EQ(results[1].reason, StopReason32::Fault);
+    EXPECT_EQ(results[2].reason, StopReason32::Fault);
+    EXPECT_EQ(results[3].reason, StopReason32::Fault);
+    EXPECT_EQ(results[3].instructions, 0);
+    EXPECT_TRUE(BatchRunner32(3).run(std::span<const BatchJob32>()).empty());
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <CPU32/BlockCache32.hpp>
+
+class BlockCache32Test : public ::testing::Test {
+protected:
+    using Cache = BlockCache32<void (*)()>;
+
+    std::shared_ptr<Memory32> memory = std::make_shared<Memory32>(4096);
+    Cache cache{memory};
+
+    Cache::Block* addBlock(uint32_t start, uint32_t end) {
+        auto block = std::make_unique<Cache::Block>();
+        block->startPC = start;
+        block->endPC = end;
+        memory->watch(start);
+        memory->watch(end - 1);
+        return cache.insert(std::move(block));
+    }
+};
+
+TEST_F(BlockCache32Test, FindByStartPC) {
+    auto* block = addBlock(10, 15);
+    EXPECT_EQ(cache.find(10), block);
+    EXPECT_EQ(cache.find(11), nullptr);
+    EXPECT_EQ(cache.size(), 1);
+}
+
+TEST_F(BlockCache32Test, StoreInsideBlockRetiresIt) {
+    addBlock(10, 15);
+    auto generation = cache.generation();
+    memory->store(14, 0);
+    EXPECT_EQ(cache.find(10), nullptr);
+    EXPECT_NE(cache.generation(), generation);
+}
+
+TEST_F(BlockCache32Test, StoreOutsideBlockKeepsIt) {
+    auto* block = addBlock(10, 15);
+    auto generation = cache.generation();
+    memory->store(15, 0);
+    memory->store(9, 0);
+    EXPECT_EQ(cache.find(10), block);
+    EXPECT_EQ(cache.generation(), generation);
+}
+
+TEST_F(BlockCache32Test, RetiringUnchainsSurvivors) {
+    auto* first = addBlock(10, 15);
+    auto* second = addBlock(15, 20);
+    auto* third = addBlock(20, 25);
+    first->fallthrough = second;
+    third->taken = first;
+
+    memory->store(17, 0);
+    cache.collect();
+    EXPECT_EQ(cache.find(15), nullptr);
+    EXPECT_EQ(first->fallthrough, nullptr);
+    EXPECT_EQ(third->taken, nullptr);
+}
+
+TEST_F(BlockCache32Test, BlockSpanningPagesIsRetiredFromEither) {
+    uint32_t start = Memory32::PAGE_WORDS - 2;
+    addBlock(start, start + 4);
+    memory->store(start + 3, 0);
+    EXPECT_EQ(cache.find(start), nullptr);
+}
+
+TEST(BlockCache32WrapTest, BlocksAtTheTopOfMemoryAreRetired) {
+    using Cache = BlockCache32<void (*)()>;
+    auto memory = std::make_shared<Memory32>(Memory32::ADDRESS_SPACE);
+    Cache cache{memory};
+    for (uint32_t end : {0u, 2u}) { // Ending exactly at 2^32, and running past it
+        auto block = std::make_unique<Cache::Block>();
+        block->startPC = 0xFFFFFFFC;
+        block->endPC = end;
+        memory->watch(0xFFFFFFFF);
+        memory->watch(0);
+        cache.insert(std::move(block));
+
+        memory->store(0xFFFFFFFF, 0);
+        EXPECT_EQ(cache.find(0xFFFFFFFC), nullptr);
+    }
+
+    auto block = std::make_unique<Cache::Block>();
+    block->startPC = 0xFFFFFFFC;
+    block->endPC = 2;
+    cache.insert(std::move(block));
+    memory->store(2, 0);
+    EXPECT_NE(cache.find(0xFFFFFFFC), nullptr);
+    memory->store(1, 0);
+    EXPECT_EQ(cache.find(0xFFFFFFFC), nullptr);
+}
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 #include <CPU32/CPU32.hpp>
+#include <CPU32/Devices32.hpp>
+#include <random>
+#include <fstream>
+#include <sstream>
 
 class CPU32Test : public ::testing::Test {
 protected:
@@ -239,20 +243,73 @@ TEST_F(CPU32Test, ExecuteStoreInstruction) {
 }
 
 TEST_F(CPU32Test, ExecuteInInstruction) {
-    // This test will need to be modified to handle actual input values if implemented
     std::vector<uint32_t> program = {0x40010000, 0xFF000000}; // IN R1
     cpu->loadProgram(program, 0);
     cpu->run();
-    EXPECT_EQ(cpu->GetRegisters()[1]->GetState(), 0); // Expecting 0 as placeholder
+    EXPECT_EQ(cpu->GetRegisters()[1]->GetState(), 0); // Nothing attached to port 0 reads as 0
 }
 
 TEST_F(CPU32Test, ExecuteOutInstruction) {
-    // This test will need to be modified to handle actual output values if implemented
     std::vector<uint32_t> program = {0x41010000, 0xFF000000}; // OUT R1
     cpu->loadProgram(program, 0);
     cpu->GetRegisters()[1]->loadValue(0x12345678);
     cpu->run();
-    // No state to check as OUT is placeholder
+    EXPECT_EQ(cpu->halted, true); // Writes to an unattached port are dropped
+}
+
+TEST_F(CPU32Test, ConsoleEchoWaitsForInput) {
+    std::vector<uint32_t> program = {
+            0x40010100, // 0: IN R1, 1
+            0x41010100, // 1: OUT R1, 1
+            0x1001000A, // 2: CMP R1, '\n'
+            0x14000000, // 3: JNZ 0
+            0xFF000000  // 4: HLT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks}) {
+        std::ostringstream out;
+        auto console = std::make_shared<ConsoleDevice32>(out);
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.GetBus()->attachPorts(1, 1, console);
+        machine.loadProgram(program, 0);
+
+        console->feed("hi");
+        RunResult32 result = machine.run(100);
+        EXPECT_EQ(result.reason, StopReason32::IOWait);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 0); // Parked on the IN
+        EXPECT_EQ(out.str(), "hi"); // Flushed when the run returned
+
+        console->feed("!\n");
+        machine.run(); // Unbounded runs return on IOWait too; this one reaches HLT
+        EXPECT_EQ(machine.halted, true);
+        EXPECT_EQ(out.str(), "hi!\n");
+    }
+}
+
+TEST_F(CPU32Test, WaitingTwoWordInParksOnItsFirstWord) {
+    std::vector<uint32_t> program = {
+            0x400101FF, 0x00000000, // 0: IN R1, 1 (a low byte of 0xFF adds a trailing word)
+            0xFF000000              // 2: HLT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks}) {
+        std::ostringstream out;
+        auto console = std::make_shared<ConsoleDevice32>(out);
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.GetBus()->attachPorts(1, 1, console);
+        machine.loadProgram(program, 0);
+
+        RunResult32 result = machine.run(100);
+        EXPECT_EQ(result.reason, StopReason32::IOWait);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 0);
+
+        console->feed("x");
+        machine.run();
+        EXPECT_EQ(machine.halted, true);
+        EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 'x');
+    }
 }
 
 TEST_F(CPU32Test, InvalidInstruction) {
@@ -304,3 +361,1054 @@ TEST_F(CPU32Test, PushAndPop) {
     EXPECT_EQ(cpu->GetRegisters()[4]->GetState(), 0x12345678);
     EXPECT_EQ(cpu->GetStackPointer()->GetState(), cpu->GetMemory()->getSize()); // Stack should be back at the initial position
 }
+
+TEST_F(CPU32Test, RunsMappedImage) {
+    std::vector<uint32_t> program = {
+            0x02010005, // MOV R1, 5
+            0x05010100, // ADD R1, R1
+            0xFF000000  // HALT
+    };
+    std::string path = ::testing::TempDir() + "cpu32_image.bin";
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(program.data()), static_cast<std::streamsize>(program.size() * sizeof(uint32_t)));
+    }
+    CPU32 machine(4 * Memory32::PAGE_WORDS);
+    machine.loadImage(path, Memory32::PAGE_WORDS);
+    machine.run();
+    EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 10);
+    EXPECT_EQ(machine.GetProgramCounter()->GetState(), Memory32::PAGE_WORDS + 3);
+}
+
+TEST_F(CPU32Test, IncrementalSnapshotsRestoreInSequence) {
+    std::vector<uint32_t> program = {
+            0x02030001, // 0: MOV R3, 1
+            0x05010300, // 1: ADD R1, R3
+            0x04010200, // 2: STORE R1, R2
+            0x05020400, // 3: ADD R2, R4
+            0x12000001  // 4: JMP 1
+    };
+    CPU32 machine(64 * Memory32::PAGE_WORDS);
+    machine.loadProgram(program, 0);
+    machine.GetRegisters()[2]->loadValue(8 * Memory32::PAGE_WORDS);
+    machine.GetRegisters()[4]->loadValue(Memory32::PAGE_WORDS); // One store per page
+
+    std::vector<Snapshot32> snapshots;
+    snapshots.push_back(machine.snapshot());
+    EXPECT_EQ(snapshots[0].pages, (std::vector<uint32_t>{0})); // Just the program
+    for (int i = 0; i < 3; ++i) {
+        machine.run(8);
+        snapshots.push_back(machine.snapshot());
+        EXPECT_EQ(snapshots.back().sequence, i + 1);
+        EXPECT_EQ(snapshots.back().pages.size(), 2); // Only what the last run stored into
+    }
+
+    CPU32 copy(64 * Memory32::PAGE_WORDS);
+    for (const auto& snapshot : snapshots) {
+        copy.restore(snapshot);
+    }
+    for (uint8_t reg = 0; reg < 16; ++reg) {
+        EXPECT_EQ(copy.GetRegisters()[reg]->GetState(), machine.GetRegisters()[reg]->GetState());
+    }
+    EXPECT_EQ(copy.GetProgramCounter()->GetState(), machine.GetProgramCounter()->GetState());
+    EXPECT_EQ(copy.GetFlagsRegister()->GetState(), machine.GetFlagsRegister()->GetState());
+    for (uint32_t page = 0; page < 64; ++page) {
+        uint32_t address = page * Memory32::PAGE_WORDS;
+        EXPECT_EQ(copy.GetMemory()->load(address), machine.GetMemory()->load(address));
+    }
+    copy.run(4);
+    machine.run(4);
+    EXPECT_EQ(copy.GetRegisters()[1]->GetState(), machine.GetRegisters()[1]->GetState());
+
+    // Rolling back: sequence 0 wipes what came after it
+    machine.restore(snapshots[0]);
+    EXPECT_EQ(machine.GetMemory()->load(8 * Memory32::PAGE_WORDS), 0);
+    EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 0);
+    EXPECT_THROW(machine.restore(snapshots[2]), std::invalid_argument);
+    machine.restore(snapshots[1]);
+    EXPECT_EQ(machine.GetMemory()->load(8 * Memory32::PAGE_WORDS), 1);
+    EXPECT_EQ(machine.snapshot().sequence, 2);
+
+    CPU32 smaller(32 * Memory32::PAGE_WORDS);
+    EXPECT_THROW(smaller.restore(snapshots[0]), std::invalid_argument);
+}
+
+TEST_F(CPU32Test, CheckpointWarmStart) {
+    std::vector<uint32_t> program = {
+            0x02010003, // 0: MOV R1, 3
+            0x11010200, // 1: CMP R1, R2   (sets CARRY: 3 < 5)
+            0x32010000, // 2: PUSH R1
+            0xFF000000, // 3: HLT
+            0x05010100, // 4: ADD R1, R1
+            0xFF000000  // 5: HLT
+    };
+    CPU32 machine(4 * Memory32::PAGE_WORDS);
+    machine.loadProgram(program, 0);
+    machine.GetRegisters()[2]->loadValue(5);
+    machine.run();
+    std::string path = ::testing::TempDir() + "cpu32_checkpoint.bin";
+    machine.saveCheckpoint(path);
+
+    CPU32 warm(4 * Memory32::PAGE_WORDS);
+    warm.loadCheckpoint(path);
+    EXPECT_EQ(warm.halted, true);
+    EXPECT_EQ(warm.GetRegisters()[1]->GetState(), 3);
+    EXPECT_EQ(warm.GetProgramCounter()->GetState(), 4);
+    EXPECT_EQ(warm.GetStackPointer()->GetState(), 4 * Memory32::PAGE_WORDS - 1);
+    EXPECT_EQ(warm.GetFlagsRegister()->GetState(), machine.GetFlagsRegister()->GetState());
+    EXPECT_TRUE(warm.GetFlagsRegister()->isFlagSet(FlagBits32::CARRY));
+    EXPECT_EQ(warm.GetMemory()->load(4 * Memory32::PAGE_WORDS - 1), 3);
+
+    warm.halted = false;
+    warm.run();
+    EXPECT_EQ(warm.GetRegisters()[1]->GetState(), 6);
+    EXPECT_EQ(warm.snapshot().sequence, 1);
+}
+
+TEST_F(CPU32Test, ForkBranchesExecution) {
+    std::vector<uint32_t> program = {
+            0x02010064, // 0: MOV R1, 100
+            0x02020800, // 1: MOV R2, 0x800
+            0xFF000000, // 2: HLT            (decision point)
+            0x05010300, // 3: ADD R1, R3
+            0x04010200, // 4: STORE R1, R2
+            0x32010000, // 5: PUSH R1
+            0xFF000000  // 6: HLT
+    };
+    CPU32 parent(4 * Memory32::PAGE_WORDS);
+    parent.loadProgram(program, 0);
+    parent.run();
+
+    std::vector<CPU32> branches;
+    for (uint32_t i = 0; i < 3; ++i) {
+        branches.push_back(parent.fork());
+        CPU32& branch = branches.back();
+        EXPECT_EQ(branch.GetProgramCounter()->GetState(), 3);
+        branch.halted = false;
+        branch.GetRegisters()[3]->loadValue(i);
+        branch.run();
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(branches[i].GetRegisters()[1]->GetState(), 100 + i);
+        EXPECT_EQ(branches[i].GetMemory()->load(0x800), 100 + i);
+        EXPECT_EQ(branches[i].GetMemory()->load(4 * Memory32::PAGE_WORDS - 1), 100 + i);
+    }
+    EXPECT_EQ(parent.GetRegisters()[1]->GetState(), 100);
+    EXPECT_EQ(parent.GetMemory()->load(0x800), 0);
+    EXPECT_EQ(parent.GetStackPointer()->GetState(), 4 * Memory32::PAGE_WORDS);
+
+    // Code written into a fork does not leak into the parent's decoded blocks
+    CPU32 patched = parent.fork();
+    patched.GetMemory()->store(3, 0x02010007); // MOV R1, 7
+    patched.halted = false;
+    patched.run();
+    EXPECT_EQ(patched.GetRegisters()[1]->GetState(), 7);
+    parent.halted = false;
+    parent.run();
+    EXPECT_EQ(parent.GetRegisters()[1]->GetState(), 100);
+}
+
+TEST_F(CPU32Test, ForkKeepsTheDispatchMode) {
+    std::vector<uint32_t> program = {
+            0x02010000, // 0: MOV R1, 0
+            0x02020000, // 1: MOV R2, 0
+            0xE5010001, // 2: ADD R1, 1
+            0x05020100, // 3: ADD R2, R1
+            0x100103E8, // 4: CMP R1, 1000
+            0x14000002, // 5: JNZ 2
+            0xFF000000  // 6: HALT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 parent(1024);
+        parent.SetDispatchMode(mode);
+        parent.loadProgram(program, 0);
+        parent.run(500); // Part way through the loop, with its blocks compiled
+
+        CPU32 child = parent.fork();
+        EXPECT_EQ(child.GetDispatchMode(), parent.GetDispatchMode());
+        EXPECT_EQ(child.run(100000).reason, StopReason32::Halted);
+        EXPECT_EQ(child.GetRegisters()[2]->GetState(), 500500);
+        parent.run(100000);
+        EXPECT_EQ(parent.GetRegisters()[2]->GetState(), 500500);
+    }
+}
+
+TEST_F(CPU32Test, FullAddressSpaceStackStartsAtTop) {
+    CPU32 machine(Memory32::ADDRESS_SPACE);
+    std::vector<uint32_t> program = {
+            0x32010000, // PUSH R1
+            0x33030000, // POP R3
+            0xFF000000  // HALT
+    };
+    machine.loadProgram(program, 0);
+    machine.GetRegisters()[1]->loadValue(0x12345678);
+    EXPECT_EQ(machine.GetStackPointer()->GetState(), 0);
+    machine.run();
+    EXPECT_EQ(machine.GetMemory()->load(0xFFFFFFFF), 0x12345678);
+    EXPECT_EQ(machine.GetRegisters()[3]->GetState(), 0x12345678);
+    EXPECT_EQ(machine.GetStackPointer()->GetState(), 0);
+    EXPECT_EQ(machine.GetMemory()->residentPages(), 2); // Program page and stack page
+}
+
+// Tests for Dispatch Modes
+TEST_F(CPU32Test, DispatchModesProduceSameResult) {
+    std::vector<uint32_t> program = {
+            0x02010005, // MOV R1, 5
+            0x02020003, // MOV R2, 3
+            0x05010200, // ADD R1, R2
+            0x09030300, // XOR R3, R3
+            0x32010000, // PUSH R1
+            0x33040000, // POP R4
+            0xFF000000  // HALT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        machine.run();
+        EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 8);
+        EXPECT_EQ(machine.GetRegisters()[4]->GetState(), 8);
+        EXPECT_EQ(machine.GetZeroFlag(), true);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 7);
+        EXPECT_EQ(machine.halted, true);
+    }
+}
+
+TEST_F(CPU32Test, UnknownOpcodeTrapsInEveryDispatchMode) {
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram({0x02010001, 0xDEADBEEF, 0x02010002}, 0); // MOV R1, 1; <invalid>; MOV R1, 2
+        machine.run();
+        EXPECT_EQ(machine.halted, true);
+        EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 1);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 2);
+    }
+}
+
+// Tests for the Decode Cache
+TEST_F(CPU32Test, UntakenJumpFallsThrough) {
+    std::vector<uint32_t> program = {
+            0x11010200, // CMP R1, R2
+            0x13000003, // JZ 3
+            0x02030001, // MOV R3, 1
+            0xFF000000  // HALT
+    };
+    cpu->loadProgram(program, 0);
+    cpu->GetRegisters()[1]->loadValue(1);
+    cpu->GetRegisters()[2]->loadValue(2);
+    cpu->run();
+    EXPECT_EQ(cpu->GetRegisters()[3]->GetState(), 1);
+    EXPECT_EQ(cpu->GetProgramCounter()->GetState(), 4);
+}
+
+TEST_F(CPU32Test, SelfModifyingCodeIsReexecuted) {
+    std::vector<uint32_t> program = {
+            0x02010001, // 0: MOV R1, 1
+            0x04020300, // 1: STORE R2, R3  (overwrites address 0 with MOV R1, 7)
+            0x10040001, // 2: CMP R4, 1
+            0x13000006, // 3: JZ 6
+            0xE5040001, // 4: ADD R4, 1
+            0x12000000, // 5: JMP 0
+            0xFF000000  // 6: HALT
+    };
+    cpu->loadProgram(program, 0);
+    cpu->GetRegisters()[2]->loadValue(0x02010007);
+    cpu->GetRegisters()[3]->loadValue(0);
+    cpu->run();
+    EXPECT_EQ(cpu->GetRegisters()[1]->GetState(), 7);
+    EXPECT_EQ(cpu->GetRegisters()[4]->GetState(), 1);
+}
+
+TEST_F(CPU32Test, ReloadedProgramIsDecodedAgain) {
+    cpu->loadProgram({0x02010001, 0xFF000000}, 0); // MOV R1, 1
+    cpu->run();
+    EXPECT_EQ(cpu->GetRegisters()[1]->GetState(), 1);
+
+    cpu->halted = false;
+    cpu->loadProgram({0x02010002, 0xFF000000}, 0); // MOV R1, 2
+    cpu->run();
+    EXPECT_EQ(cpu->GetRegisters()[1]->GetState(), 2);
+}
+
+TEST_F(CPU32Test, SelfModifyingCodeAtTheTopOfMemoryIsReexecuted) {
+    std::vector<uint32_t> low = {
+            0x10040002, // 0: CMP R4, 2
+            0x13000004, // 1: JZ 4
+            0x32050000, // 2: PUSH R5
+            0x31000000, // 3: RET  (back to 0xFFFFFFFC)
+            0xFF000000  // 4: HALT
+    };
+    // The top block either ends exactly at 2^32 with a jump or runs on into address 0
+    for (uint32_t last : {0x12000000u /* JMP 0 */, 0xE5060001u /* ADD R6, 1 */}) {
+        std::vector<uint32_t> high = {
+                0x02010001, // 0xFFFFFFFC: MOV R1, 1
+                0x04020300, // 0xFFFFFFFD: STORE R2, R3  (overwrites 0xFFFFFFFC with MOV R1, 7)
+                0xE5040001, // 0xFFFFFFFE: ADD R4, 1
+                last        // 0xFFFFFFFF
+        };
+        for (auto mode : {CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+            CPU32 machine(Memory32::ADDRESS_SPACE);
+            machine.SetDispatchMode(mode);
+            machine.loadProgram(high, 0xFFFFFFFC);
+            machine.loadProgram(low, 0);
+            machine.GetRegisters()[2]->loadValue(0x02010007);
+            machine.GetRegisters()[3]->loadValue(0xFFFFFFFC);
+            machine.GetRegisters()[5]->loadValue(0xFFFFFFFC);
+            machine.GetStackPointer()->loadValue(0x8000); // Clear of the code at the top
+            EXPECT_EQ(machine.run(1000).reason, StopReason32::Halted);
+            EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 7);
+            EXPECT_EQ(machine.GetRegisters()[4]->GetState(), 2);
+        }
+    }
+}
+
+// Tests for Block Execution
+TEST_F(CPU32Test, BlockLoopMatchesTableDispatch) {
+    std::vector<uint32_t> program = {
+            0x02010000, // 0: MOV R1, 0
+            0x02020000, // 1: MOV R2, 0
+            0xE5010001, // 2: ADD R1, 1
+            0x05020100, // 3: ADD R2, R1
+            0x10010064, // 4: CMP R1, 100
+            0x14000002, // 5: JNZ 2
+            0xFF000000  // 6: HALT
+    };
+    for (auto mode : {CPU32::DispatchMode::Table, CPU32::DispatchMode::Blocks}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        machine.run();
+        EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 100);
+        EXPECT_EQ(machine.GetRegisters()[2]->GetState(), 5050);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 7);
+    }
+}
+
+TEST_F(CPU32Test, StoreIntoSameBlockIsSeen) {
+    std::vector<uint32_t> program = {
+            0x04020300, // 0: STORE R2, R3  (overwrites address 1 with MOV R1, 9)
+            0x02010001, // 1: MOV R1, 1
+            0xFF000000  // 2: HALT
+    };
+    cpu->loadProgram(program, 0);
+    cpu->GetRegisters()[2]->loadValue(0x02010009);
+    cpu->GetRegisters()[3]->loadValue(1);
+    cpu->run();
+    EXPECT_EQ(cpu->GetRegisters()[1]->GetState(), 9);
+}
+
+TEST_F(CPU32Test, CallAndRetAcrossBlocks) {
+    std::vector<uint32_t> program = {
+            0x30000003, // 0: CALL 3
+            0xE5010001, // 1: ADD R1, 1
+            0xFF000000, // 2: HALT
+            0xE5010002, // 3: ADD R1, 2
+            0x31000000  // 4: RET
+    };
+    cpu->loadProgram(program, 0);
+    cpu->run();
+    EXPECT_EQ(cpu->GetRegisters()[1]->GetState(), 3);
+    EXPECT_EQ(cpu->GetProgramCounter()->GetState(), 3);
+    EXPECT_EQ(cpu->GetStackPointer()->GetState(), 1024);
+}
+
+// Tests for the JIT
+TEST_F(CPU32Test, JitLoopMatchesInterpreter) {
+    std::vector<uint32_t> program = {
+            0x02010000, // 0: MOV R1, 0
+            0x02020000, // 1: MOV R2, 0
+            0xE5010001, // 2: ADD R1, 1
+            0x05020100, // 3: ADD R2, R1
+            0x10012710, // 4: CMP R1, 10000
+            0x14000002, // 5: JNZ 2
+            0x32020000, // 6: PUSH R2
+            0x33030000, // 7: POP R3
+            0xFF000000  // 8: HALT
+    };
+    CPU32 interpreted(1024);
+    interpreted.SetDispatchMode(CPU32::DispatchMode::Table);
+    interpreted.loadProgram(program, 0);
+    interpreted.run();
+
+    cpu->SetDispatchMode(CPU32::DispatchMode::JIT);
+    cpu->loadProgram(program, 0);
+    cpu->run();
+
+    for (size_t i = 0; i < 16; ++i) {
+        EXPECT_EQ(cpu->GetRegisters()[i]->GetState(), interpreted.GetRegisters()[i]->GetState()) << "R" << i;
+    }
+    EXPECT_EQ(cpu->GetRegisters()[3]->GetState(), 50005000);
+    EXPECT_EQ(cpu->GetFlagsRegister()->getFlags(), interpreted.GetFlagsRegister()->getFlags());
+    EXPECT_EQ(cpu->GetProgramCounter()->GetState(), interpreted.GetProgramCounter()->GetState());
+}
+
+TEST_F(CPU32Test, JitRandomProgramsMatchInterpreter) {
+    // Random straight-line ALU bodies inside a counted loop, run compiled and interpreted
+    std::mt19937 random(1234);
+    const uint32_t aluOpcodes[] = {0x01, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x10, 0x11, 0xE5, 0x02};
+    for (int trial = 0; trial < 50; ++trial) {
+        std::vector<uint32_t> program = {
+                0x020E0040, // 0: MOV R14, 64 (loop counter)
+                0x020D0001, // 1: MOV R13, 1
+        };
+        size_t bodyLength = 1 + random() % 20;
+        for (size_t i = 0; i < bodyLength; ++i) {
+            uint32_t opcode = aluOpcodes[random() % std::size(aluOpcodes)];
+            uint32_t dest = random() % 8;
+            uint32_t source = random() % 14;
+            uint32_t immediate = random() % 0xFF00; // low byte never 0xFF
+            if (opcode == 0x02 || opcode == 0x10 || opcode == 0xE5) {
+                program.push_back((opcode << 24) | (dest << 16) | immediate);
+            } else {
+                program.push_back((opcode << 24) | (dest << 16) | (source << 8));
+            }
+        }
+        uint32_t conditional = 0x13 + random() % 6;
+        uint32_t skip = static_cast<uint32_t>(program.size()) + 2;
+        program.push_back((conditional << 24) | skip);  // Jcc over the next instruction
+        program.push_back(0x09000000);                  // XOR R0, R0
+        program.push_back(0x060E0D00);                  // SUB R14, R13
+        program.push_back(0x100E0000);                  // CMP R14, 0
+        program.push_back(0x14000002);                  // JNZ 2
+        program.push_back(0xFF000000);                  // HALT
+
+        std::vector<uint32_t> seeds(13);
+        for (auto& seed : seeds) {
+            seed = random();
+        }
+
+        CPU32 interpreted(1024);
+        interpreted.SetDispatchMode(CPU32::DispatchMode::Table);
+        CPU32 compiled(1024);
+        compiled.SetDispatchMode(CPU32::DispatchMode::JIT);
+        for (CPU32* machine : {&interpreted, &compiled}) {
+            machine->loadProgram(program, 0);
+            for (size_t i = 0; i < seeds.size(); ++i) {
+                machine->GetRegisters()[i]->loadValue(seeds[i]);
+            }
+            machine->run();
+        }
+
+        for (size_t i = 0; i < 16; ++i) {
+            ASSERT_EQ(compiled.GetRegisters()[i]->GetState(), interpreted.GetRegisters()[i]->GetState())
+                    << "trial " << trial << " R" << i;
+        }
+        ASSERT_EQ(compiled.GetFlagsRegister()->getFlags(), interpreted.GetFlagsRegister()->getFlags()) << "trial " << trial;
+        ASSERT_EQ(compiled.GetProgramCounter()->GetState(), interpreted.GetProgramCounter()->GetState());
+    }
+}
+
+// Tests for the Observation Policy
+TEST_F(CPU32Test, UnobservedCpuMatchesObservedCpu) {
+    static_assert(!std::is_polymorphic_v<FastCPU32::RegisterType>);
+    static_assert(!std::is_polymorphic_v<FastCPU32::FlagsType>);
+
+    std::vector<uint32_t> program = {
+            0x02010000, // 0: MOV R1, 0
+            0x02020000, // 1: MOV R2, 0
+            0xE5010001, // 2: ADD R1, 1
+            0x05020100, // 3: ADD R2, R1
+            0x32020000, // 4: PUSH R2
+            0x33030000, // 5: POP R3
+            0x100103E8, // 6: CMP R1, 1000
+            0x14000002, // 7: JNZ 2
+            0xFF000000  // 8: HALT
+    };
+    for (auto mode : {CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 observed(1024);
+        FastCPU32 unobserved(1024);
+        observed.SetDispatchMode(mode);
+        unobserved.SetDispatchMode(mode);
+        observed.loadProgram(program, 0);
+        unobserved.loadProgram(program, 0);
+        observed.run();
+        unobserved.run();
+
+        for (size_t i = 0; i < 16; ++i) {
+            EXPECT_EQ(unobserved.GetRegisters()[i]->GetState(), observed.GetRegisters()[i]->GetState());
+        }
+        EXPECT_EQ(unobserved.GetRegisters()[3]->GetState(), 500500);
+        EXPECT_EQ(unobserved.GetState(), observed.GetState());
+    }
+}
+
+TEST_F(CPU32Test, RegisterFieldsUseTheirLowFourBits) {
+    // Register fields above 15 wrap around rather than reach pc, sp or the flags
+    std::vector<uint32_t> program = {
+            0x02110005, // 0: MOV R17, 5       R1
+            0x01F21100, // 1: MOV R242, R17    R2, R1
+            0xE5F30007, // 2: ADD R243, 7      R3
+            0x05230100, // 3: ADD R35, R1      R3
+            0x32430000, // 4: PUSH R67         R3
+            0x33840000, // 5: POP R132         R4
+            0xFF000000  // 6: HLT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        RunResult32 result = machine.run(100);
+        EXPECT_EQ(result.reason, StopReason32::Halted);
+        EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 5);
+        EXPECT_EQ(machine.GetRegisters()[2]->GetState(), 5);
+        EXPECT_EQ(machine.GetRegisters()[3]->GetState(), 12);
+        EXPECT_EQ(machine.GetRegisters()[4]->GetState(), 12);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 7);
+        EXPECT_EQ(machine.GetStackPointer()->GetState(), 1024);
+    }
+}
+
+TEST_F(CPU32Test, ObservedProgramCounterNotifies) {
+    class Counter : public IObserver {
+    public:
+        int updates = 0;
+        void Update(uint32_t) override { ++updates; }
+    } counter;
+
+    cpu->GetProgramCounter()->Attach(&counter);
+    cpu->loadProgram({0x00000000, 0x00000000, 0xFF000000}, 0); // NOP; NOP; HLT
+    cpu->run();
+    EXPECT_GE(counter.updates, 3);
+    cpu->GetProgramCounter()->Detach(&counter);
+}
+
+TEST_F(CPU32Test, RegisterViewsShareTheRegisterFile) {
+    const RegisterFile32& file = cpu->GetRegisterFile();
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(&file) % 64, 0u);
+    EXPECT_EQ(file.sp, cpu->GetMemory()->getSize());
+
+    cpu->GetRegisters()[5]->loadValue(42);
+    EXPECT_EQ(file.registers[5], 42);
+
+    cpu->loadProgram({0x02060007, 0x10060007, 0xFF000000}, 0); // MOV R6, 7; CMP R6, 7; HLT
+    cpu->run();
+    EXPECT_EQ(cpu->GetRegisters()[6]->GetState(), 7);
+    EXPECT_EQ(file.pc, cpu->GetProgramCounter()->GetState());
+    EXPECT_TRUE(cpu->GetFlagsRegister()->isFlagSet(Flags32::ZERO));
+}
+
+TEST_F(CPU32Test, ObservedRegisterWriteNotifies) {
+    class Counter : public IObserver {
+    public:
+        int updates = 0;
+        void Update(uint32_t) override { ++updates; }
+    } counter;
+
+    cpu->GetRegisters()[1]->Attach(&counter);
+    cpu->loadProgram({0x02010005, 0x02020005, 0xFF000000}, 0); // MOV R1, 5; MOV R2, 5; HLT
+    cpu->run();
+    EXPECT_EQ(counter.updates, 1);
+    cpu->GetRegisters()[1]->Detach(&counter);
+}
+
+TEST_F(CPU32Test, FlagsAreResolvedWhenRead) {
+    cpu->GetFlagsRegister()->setFlag(Flags32::INTERRUPT);
+    cpu->GetRegisters()[1]->loadValue(0xFFFFFFFF);
+    cpu->GetRegisters()[2]->loadValue(1);
+    cpu->loadProgram({0x05010200, 0xFF000000}, 0); // ADD R1, R2; HLT
+    cpu->run();
+    EXPECT_EQ(cpu->GetFlagsRegister()->getFlags(),
+              Flags32::INTERRUPT | Flags32::CARRY | Flags32::ZERO | Flags32::PARITY);
+    EXPECT_EQ(cpu->GetFlagsRegister()->getFlagNames(), "CARRY ZERO INTERRUPT PARITY");
+
+    cpu->GetFlagsRegister()->clearFlag(Flags32::CARRY);
+    EXPECT_EQ(cpu->GetFlagsRegister()->getFlags(), Flags32::INTERRUPT | Flags32::ZERO | Flags32::PARITY);
+}
+
+TEST_F(CPU32Test, BoundedRunStopsExactlyAtBudget) {
+    std::vector<uint32_t> program = {
+            0xE5010001, // 0: ADD R1, 1
+            0x12000000, // 1: JMP 0
+    };
+    for (auto mode : {CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        for (int slice = 0; slice < 100; ++slice) {
+            RunResult32 result = machine.run(1001);
+            ASSERT_EQ(result.reason, StopReason32::BudgetExhausted);
+            ASSERT_EQ(result.instructions, 1001);
+            ASSERT_EQ(result.cycles, 1001);
+        }
+        EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 50050) << static_cast<int>(mode);
+    }
+}
+
+TEST_F(CPU32Test, BoundedRunReportsHalt) {
+    cpu->loadProgram({0x02010001, 0x02020002, 0xFF000000}, 0); // MOV R1, 1; MOV R2, 2; HLT
+    RunResult32 result = cpu->run(1000);
+    EXPECT_EQ(result.reason, StopReason32::Halted);
+    EXPECT_EQ(result.instructions, 3);
+    EXPECT_EQ(cpu->run(1000).instructions, 0);
+}
+
+TEST_F(CPU32Test, BoundedRunStopsAtBreakpoint) {
+    std::vector<uint32_t> program = {
+            0x02010000, // 0: MOV R1, 0
+            0xE5010001, // 1: ADD R1, 1
+            0x1001000A, // 2: CMP R1, 10
+            0x14000001, // 3: JNZ 1
+            0xFF000000  // 4: HALT
+    };
+    for (auto mode : {CPU32::DispatchMode::Table, CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        machine.addBreakpoint(2);
+        for (uint32_t expected = 1; expected <= 10; ++expected) {
+            RunResult32 result = machine.run(CPU32::UNLIMITED);
+            ASSERT_EQ(result.reason, StopReason32::Breakpoint);
+            ASSERT_EQ(machine.GetProgramCounter()->GetState(), 2);
+            ASSERT_EQ(machine.GetRegisters()[1]->GetState(), expected);
+        }
+        machine.removeBreakpoint(2);
+        EXPECT_EQ(machine.run(CPU32::UNLIMITED).reason, StopReason32::Halted);
+    }
+}
+
+TEST_F(CPU32Test, BoundedRunReportsPreciseFault) {
+    std::vector<uint32_t> program = {
+            0x02020001, // 0: MOV R2, 1
+            0xE2037FFF, // 1: MOV R3, imm32
+            0x00100000, // 2: (1 << 20)
+            0x03010300, // 3: LOAD R1, R3
+            0xFF000000  // 4: HALT
+    };
+    for (auto mode : {CPU32::DispatchMode::Table, CPU32::DispatchMode::Blocks}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        RunResult32 result = machine.run(100);
+        EXPECT_EQ(result.reason, StopReason32::Fault);
+        EXPECT_FALSE(result.fault.empty());
+        EXPECT_EQ(result.instructions, 2);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 3);
+        EXPECT_FALSE(machine.halted);
+    }
+}
+
+TEST_F(CPU32Test, BlockInstructions) {
+    std::vector<uint32_t> program = {
+            0x02010100, // 0: MOV R1, 0x100
+            0x02020007, // 1: MOV R2, 7
+            0x02030040, // 2: MOV R3, 64
+            0x51010203, // 3: BFILL R1, R2, R3
+            0x02040200, // 4: MOV R4, 0x200
+            0x50040103, // 5: BMOV R4, R1, R3
+            0x52010403, // 6: BCMP R1, R4, R3
+            0x13000009, // 7: JZ 9
+            0xFF000000, // 8: HLT
+            0x02050001, // 9: MOV R5, 1
+            0x04050100, // 10: STORE R5, [R1]
+            0x52010403, // 11: BCMP R1, R4, R3
+            0xFF000000  // 12: HLT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        machine.run();
+        EXPECT_EQ(machine.GetMemory()->load(0x200 + 63), 7);
+        EXPECT_EQ(machine.GetMemory()->load(0x200 + 64), 0);
+        EXPECT_EQ(machine.GetRegisters()[5]->GetState(), 1); // The first BCMP found the copies equal
+        EXPECT_FALSE(machine.GetZeroFlag());
+        EXPECT_TRUE(machine.GetFlagsRegister()->isFlagSet(Flags32::CARRY)); // First difference: 1 below 7
+    }
+}
+
+TEST_F(CPU32Test, AtomicInstructions) {
+    std::vector<uint32_t> program = {
+            0x02010100, // 0: MOV R1, 0x100
+            0x02020005, // 1: MOV R2, 5
+            0x61020100, // 2: XADD R2, R1      [0x100] = 5, R2 = 0
+            0x02030009, // 3: MOV R3, 9
+            0x60020103, // 4: CAS R2, R1, R3   fails: R2 = 5
+            0x60020103, // 5: CAS R2, R1, R3   [0x100] = 9
+            0x62000000, // 6: FENCE
+            0xFF000000  // 7: HLT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        machine.run();
+        EXPECT_EQ(machine.GetMemory()->load(0x100), 9);
+        EXPECT_EQ(machine.GetRegisters()[2]->GetState(), 5);
+        EXPECT_TRUE(machine.GetZeroFlag()); // The second CAS swapped
+    }
+}
+
+TEST_F(CPU32Test, MultiplyDivideAndShiftInstructions) {
+    std::vector<uint32_t> program = {
+            0xE201FFFF, // 0: MOV R1, imm32
+            0x12345678, // 1
+            0xE202FFFF, // 2: MOV R2, imm32
+            0x9ABCDEF0, // 3
+            0x01030100, // 4: MOV R3, R1
+            0x20030200, // 5: MUL R3, R2
+            0x01040100, // 6: MOV R4, R1
+            0x21040200, // 7: MULH R4, R2
+            0xE205FFFF, // 8: MOV R5, imm32
+            0xFFFFFFF9, // 9: -7
+            0x02060002, // 10: MOV R6, 2
+            0x01070500, // 11: MOV R7, R5
+            0x25070600, // 12: SDIV R7, R6
+            0x01080500, // 13: MOV R8, R5
+            0x26080600, // 14: SMOD R8, R6
+            0x01090500, // 15: MOV R9, R5
+            0x23090600, // 16: DIV R9, R6
+            0x010A0500, // 17: MOV R10, R5
+            0x240A0600, // 18: MOD R10, R6
+            0x020B0004, // 19: MOV R11, 4
+            0x010C0500, // 20: MOV R12, R5
+            0x290C0B00, // 21: SAR R12, R11
+            0x010D0100, // 22: MOV R13, R1
+            0x2A0D0B00, // 23: ROL R13, R11
+            0x2D0E0100, // 24: CLZ R14, R1
+            0x2C0F0200, // 25: POPCNT R15, R2
+            0x02000001, // 26: MOV R0, 1
+            0x27020000, // 27: SHL R2, R0      carries out the top bit and flips the sign
+            0xFF000000  // 28: HLT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        machine.run();
+        auto registers = machine.GetRegisters();
+        EXPECT_EQ(registers[3]->GetState(), 0x242D2080u);
+        EXPECT_EQ(registers[4]->GetState(), 0x0B00EA4Eu);
+        EXPECT_EQ(registers[7]->GetState(), static_cast<uint32_t>(-3));
+        EXPECT_EQ(registers[8]->GetState(), static_cast<uint32_t>(-1));
+        EXPECT_EQ(registers[9]->GetState(), 0x7FFFFFFCu);
+        EXPECT_EQ(registers[10]->GetState(), 1);
+        EXPECT_EQ(registers[12]->GetState(), 0xFFFFFFFFu);
+        EXPECT_EQ(registers[13]->GetState(), 0x23456781u);
+        EXPECT_EQ(registers[14]->GetState(), 3);
+        EXPECT_EQ(registers[15]->GetState(), 19);
+        EXPECT_EQ(registers[2]->GetState(), 0x3579BDE0u);
+        EXPECT_TRUE(machine.GetFlagsRegister()->isFlagSet(Flags32::CARRY));
+        EXPECT_TRUE(machine.GetFlagsRegister()->isFlagSet(Flags32::OVERFLOW));
+        EXPECT_FALSE(machine.GetFlagsRegister()->isFlagSet(Flags32::SIGN));
+    }
+}
+
+TEST_F(CPU32Test, DivisionByZeroFaults) {
+    std::vector<uint32_t> program = {
+            0x02010005, // 0: MOV R1, 5
+            0x02020000, // 1: MOV R2, 0
+            0x25010200, // 2: SDIV R1, R2
+            0xFF000000  // 3: HLT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        RunResult32 result = machine.run(100);
+        EXPECT_EQ(result.reason, StopReason32::Fault);
+        EXPECT_EQ(result.fault, "Division by zero");
+        EXPECT_EQ(result.instructions, 2);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 2);
+        EXPECT_EQ(machine.GetRegisters()[1]->GetState(), 5);
+    }
+}
+
+TEST_F(CPU32Test, VectorInstructions) {
+    std::vector<uint32_t> program = {
+            0x02010100, // 0: MOV R1, 0x100
+            0x02020104, // 1: MOV R2, 0x104
+            0x80010100, // 2: VLOAD V1, R1
+            0x80020200, // 3: VLOAD V2, R2
+            0x82010200, // 4: VADD V1, V2
+            0x89030100, // 5: VSUM R3, V1
+            0x02040016, // 6: MOV R4, 22
+            0x8A030400, // 7: VSPLAT V3, R4
+            0x87030100, // 8: VCMPEQ V3, V1
+            0x02050108, // 9: MOV R5, 0x108
+            0x81010500, // 10: VSTORE V1, R5
+            0x86020200, // 11: VXOR V2, V2
+            0x88020100, // 12: VCMPGT V2, V1     no lane of 0 is above V1
+            0xFF000000  // 13: HLT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        machine.GetMemory()->storeBlock(0x100, std::vector<uint32_t>{1, 2, 3, 4, 10, 20, 30, 40});
+        machine.run();
+        const RegisterFile32& file = machine.GetRegisterFile();
+        EXPECT_EQ(file.vectors[1], (Vector32{{11, 22, 33, 44}}));
+        EXPECT_EQ(file.vectors[2], Vector32{});
+        EXPECT_EQ(file.vectors[3], (Vector32{{0, ~0u, 0, 0}}));
+        EXPECT_EQ(machine.GetRegisters()[3]->GetState(), 110);
+        EXPECT_EQ(machine.GetMemory()->load(0x10B), 44);
+        EXPECT_TRUE(machine.GetZeroFlag());
+
+        std::string path = ::testing::TempDir() + "cpu32_vector_checkpoint.bin";
+        machine.saveCheckpoint(path);
+        CPU32 warm(1024);
+        warm.loadCheckpoint(path);
+        EXPECT_EQ(warm.GetRegisterFile().vectors[1], file.vectors[1]);
+        EXPECT_EQ(machine.fork().GetRegisterFile().vectors[3], file.vectors[3]);
+        EXPECT_EQ(machine.snapshot().vectors[1], file.vectors[1]);
+    }
+}
+
+TEST_F(CPU32Test, VectorLoadPastTheEndFaults) {
+    std::vector<uint32_t> program = {
+            0x020103FE, // 0: MOV R1, 1022
+            0x80010100, // 1: VLOAD V1, R1
+            0xFF000000  // 2: HLT
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        machine.loadProgram(program, 0);
+        RunResult32 result = machine.run(100);
+        EXPECT_EQ(result.reason, StopReason32::Fault);
+        EXPECT_EQ(result.instructions, 1);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 1);
+        EXPECT_EQ(machine.GetRegisterFile().vectors[1], Vector32{});
+    }
+}
+
+TEST_F(CPU32Test, TimerInterruptPreemptsALoop) {
+    std::vector<uint32_t> program = {
+            0x02020064, // 0: MOV R2, 100
+            0x41021000, // 1: OUT R2, 0x10     timer PERIOD
+            0x02020003, // 2: MOV R2, 3
+            0x41021100, // 3: OUT R2, 0x11     timer CONTROL = ENABLE | PERIODIC
+            0x70000000, // 4: EI
+            0x10030005, // 5: CMP R3, 5
+            0x15000005, // 6: JL 5
+            0x71000000, // 7: DI
+            0xFF000000, // 8: HLT
+            0x02040001, // 9: MOV R4, 1        handler for line 0
+            0x05030400, // 10: ADD R3, R4      (the flags it changes are restored by IRET)
+            0x72000000  // 11: IRET
+    };
+    for (auto mode : {CPU32::DispatchMode::Map, CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        auto timer = std::make_shared<IntervalTimerDevice32>(machine.GetInterrupts(), 0);
+        machine.GetInterrupts()->attach(timer);
+        machine.GetBus()->attachPorts(0x10, 3, timer);
+        machine.GetInterrupts()->setVectorTable(0x100);
+        machine.GetMemory()->store(0x100, 9);
+        machine.loadProgram(program, 0);
+
+        RunResult32 result = machine.run(100000);
+        EXPECT_EQ(result.reason, StopReason32::Halted);
+        EXPECT_EQ(machine.GetRegisters()[3]->GetState(), 5);
+        EXPECT_GE(result.cycles, 500);
+        EXPECT_LT(result.cycles, 600);
+        EXPECT_EQ(machine.GetStackPointer()->GetState(), 1024);
+        EXPECT_FALSE(machine.GetFlagsRegister()->isFlagSet(FlagBits32::INTERRUPT));
+    }
+}
+
+TEST_F(CPU32Test, HaltSleepsUntilTheTimerExpires) {
+    std::vector<uint32_t> program = {
+            0x020203E8, // 0: MOV R2, 1000
+            0x41021000, // 1: OUT R2, 0x10     timer PERIOD
+            0x02020001, // 2: MOV R2, 1
+            0x41021100, // 3: OUT R2, 0x11     one-shot
+            0x70000000, // 4: EI
+            0xFF000000, // 5: HLT              sleeps until the timer
+            0x02050007, // 6: MOV R5, 7
+            0xFF000000, // 7: HLT              nothing left to wait for
+            0x72000000  // 8: IRET             handler for line 1
+    };
+    for (auto mode : {CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded, CPU32::DispatchMode::Blocks}) {
+        CPU32 machine(1024);
+        machine.SetDispatchMode(mode);
+        auto timer = std::make_shared<IntervalTimerDevice32>(machine.GetInterrupts(), 1);
+        machine.GetInterrupts()->attach(timer);
+        machine.GetBus()->attachPorts(0x10, 3, timer);
+        machine.GetInterrupts()->setVectorTable(0x100);
+        machine.GetMemory()->store(0x101, 8);
+        machine.loadProgram(program, 0);
+
+        RunResult32 result = machine.run(100000);
+        EXPECT_EQ(result.reason, StopReason32::Halted);
+        EXPECT_EQ(machine.GetRegisters()[5]->GetState(), 7);
+        EXPECT_EQ(result.instructions, 9);
+        EXPECT_GE(result.cycles, 1000);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 8);
+    }
+}
+
+TEST_F(CPU32Test, ForkKeepsAnArmedTimer) {
+    std::vector<uint32_t> program = {
+            0x020203E8, // 0: MOV R2, 1000
+            0x41021000, // 1: OUT R2, 0x10     timer PERIOD
+            0x02020001, // 2: MOV R2, 1
+            0x41021100, // 3: OUT R2, 0x11     one-shot
+            0x70000000, // 4: EI
+            0xFF000000, // 5: HLT              sleeps until the timer
+            0x02050007, // 6: MOV R5, 7
+            0xFF000000, // 7: HLT
+            0x72000000  // 8: IRET             handler for line 1
+    };
+    CPU32 parent(1024);
+    auto timer = std::make_shared<IntervalTimerDevice32>(parent.GetInterrupts(), 1);
+    parent.GetInterrupts()->attach(timer);
+    parent.GetBus()->attachPorts(0x10, 3, timer);
+    parent.GetInterrupts()->setVectorTable(0x100);
+    parent.GetMemory()->store(0x101, 8);
+    parent.loadProgram(program, 0);
+    parent.run(5);
+    uint32_t left = timer->read(IntervalTimerDevice32::COUNT);
+    EXPECT_GT(left, 0);
+
+    CPU32 child = parent.fork();
+    EXPECT_EQ(child.GetBus()->in(0x12), left);
+    EXPECT_EQ(child.GetInterrupts()->nextDeadline(), left);
+    RunResult32 result = child.run(100000);
+    EXPECT_EQ(result.reason, StopReason32::Halted);
+    EXPECT_EQ(child.GetRegisters()[5]->GetState(), 7);
+    EXPECT_EQ(child.GetProgramCounter()->GetState(), 8);
+
+    // The parent's timer is still its own, and still armed
+    EXPECT_EQ(timer->read(IntervalTimerDevice32::COUNT), left);
+    parent.run(100000);
+    EXPECT_EQ(parent.GetRegisters()[5]->GetState(), 7);
+}
+
+TEST_F(CPU32Test, RaisedInterruptWaitsForEI) {
+    std::vector<uint32_t> program = {
+            0xFF000000, // 0: HLT
+            0x70000000, // 1: EI
+            0xFF000000, // 2: HLT
+            0xFF000000, // 3: HLT
+            0x0206002A, // 4: MOV R6, 42       handler for line 2
+            0x72000000  // 5: IRET
+    };
+    cpu->loadProgram(program, 0);
+    cpu->GetInterrupts()->setVectorTable(0x100);
+    cpu->GetMemory()->store(0x102, 4);
+    cpu->run(100);
+    cpu->GetInterrupts()->raise(2);
+    cpu->halted = false;
+    cpu->GetProgramCounter()->loadValue(1);
+    RunResult32 result = cpu->run(100);
+    // Taken straight after EI, before the HLT it would otherwise stop at
+    EXPECT_EQ(result.reason, StopReason32::Halted);
+    EXPECT_EQ(cpu->GetRegisters()[6]->GetState(), 42);
+    EXPECT_EQ(cpu->GetProgramCounter()->GetState(), 3);
+    EXPECT_EQ(result.instructions, 4);
+
+    // A halted CPU with interrupts on resumes after its HLT
+    cpu->GetRegisters()[6]->loadValue(0);
+    cpu->GetInterrupts()->raise(2);
+    result = cpu->run(100);
+    EXPECT_EQ(cpu->GetRegisters()[6]->GetState(), 42);
+    EXPECT_EQ(cpu->GetProgramCounter()->GetState(), 4);
+    EXPECT_EQ(result.instructions, 3);
+}
+
+TEST_F(CPU32Test, BlockInstructionFaultIsPrecise) {
+    std::vector<uint32_t> program = {
+            0x02010300, // 0: MOV R1, 0x300
+            0x02030200, // 1: MOV R3, 0x200 (runs past the end of memory)
+            0x51010203, // 2: BFILL R1, R2, R3
+            0xFF000000  // 3: HLT
+    };
+    cpu->loadProgram(program, 0);
+    cpu->GetRegisters()[2]->loadValue(5);
+    RunResult32 result = cpu->run(100);
+    EXPECT_EQ(result.reason, StopReason32::Fault);
+    EXPECT_EQ(cpu->GetProgramCounter()->GetState(), 2);
+    EXPECT_EQ(cpu->GetMemory()->load(0x300), 0); // Checked before anything was written
+}
+
+TEST_F(CPU32Test, GuardedMemoryReportsPreciseFault) {
+    for (auto mode : {CPU32::DispatchMode::Table, CPU32::DispatchMode::Blocks}) {
+        CPU32 machine(1024, Memory32::Mode::Guarded);
+        machine.SetDispatchMode(mode);
+        std::vector<uint32_t> program = {
+                0x02010001, // 0: MOV R1, 1
+                0x02027000, // 1: MOV R2, 0x7000
+                0x03030200, // 2: LOAD R3, [R2]  (past the end of memory)
+                0xFF000000  // 3: HLT
+        };
+        machine.loadProgram(program, 0);
+        RunResult32 result = machine.run(100);
+        EXPECT_EQ(result.reason, StopReason32::Fault);
+        EXPECT_EQ(result.instructions, 2);
+        EXPECT_EQ(machine.GetProgramCounter()->GetState(), 2);
+        EXPECT_THROW(machine.run(), std::out_of_range);
+    }
+}
+
+TEST_F(CPU32Test, StopRequestEndsRun) {
+    cpu->loadProgram({0x12000000}, 0); // JMP 0
+    cpu->requestStop(StopReason32::IOWait);
+    RunResult32 result = cpu->run(1000);
+    EXPECT_EQ(result.reason, StopReason32::IOWait);
+    EXPECT_EQ(result.instructions, 0);
+    EXPECT_EQ(cpu->run(1000).reason, StopReason32::BudgetExhausted);
+}
+
+TEST_F(CPU32Test, RunUntilStopsAtDeadline) {
+    cpu->SetDispatchMode(CPU32::DispatchMode::JIT);
+    cpu->loadProgram({0xE5010001, 0x12000000}, 0); // ADD R1, 1; JMP 0
+    RunResult32 expired = cpu->runUntil(std::chrono::steady_clock::now());
+    EXPECT_EQ(expired.reason, StopReason32::BudgetExhausted);
+    EXPECT_EQ(expired.instructions, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    RunResult32 result = cpu->runUntil(start + std::chrono::milliseconds(20));
+    EXPECT_EQ(result.reason, StopReason32::BudgetExhausted);
+    EXPECT_GT(result.instructions, 0);
+    EXPECT_GE(std::chrono::steady_clock::now(), start + std::chrono::milliseconds(20));
+}
+
+TEST_F(CPU32Test, ProfilerSeesEveryDispatchMode) {
+    std::vector<uint32_t> program = {
+            0x02010000, // 0: MOV R1, 0
+            0x30000005, // 1: CALL 5
+            0x10010003, // 2: CMP R1, 3
+            0x14000001, // 3: JNZ 1
+            0xFF000000, // 4: HALT
+            0xE5010001, // 5: ADD R1, 1
+            0x31000000, // 6: RET
+    };
+    for (auto mode : {CPU32::DispatchMode::Table, CPU32::DispatchMode::Threaded,
+                      CPU32::DispatchMode::Blocks, CPU32::DispatchMode::JIT}) {
+        CPU32 machine(1024);
+        auto profiler = std::make_shared<Profiler32>();
+        machine.SetDispatchMode(mode);
+        machine.SetProfiler(profiler);
+        machine.loadProgram(program, 0);
+        machine.run();
+
+        EXPECT_EQ(profiler->instructions(), 1 + 3 * 5 + 1);
+        EXPECT_EQ(profiler->opcodeCounts()[0x30], 3);
+        EXPECT_EQ(profiler->pcCounts().at(5), 3);
+        EXPECT_EQ(profiler->branches().at(3).taken, 2);
+        EXPECT_EQ(profiler->branches().at(3).notTaken, 1);
+        auto calls = profiler->calls();
+        EXPECT_EQ(calls[5].calls, 3);
+        EXPECT_EQ(calls[5].exclusive, 6);
+        EXPECT_EQ(calls[5].inclusive, 6);
+
+        std::ostringstream out;
+        profiler->writeCollapsedStacks(out);
+        EXPECT_EQ(out.str(), "root 11\nroot;0x00000005 6\n");
+    }
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <CPU32/Checkpoint32.hpp>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+static std::string checkpointPath(const std::string& name) {
+    return ::testing::TempDir() + name;
+}
+
+static CheckpointHeader32 readHeader(const std::string& path) {
+    CheckpointHeader32 header{};
+    std::ifstream file(path, std::ios::binary);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return header;
+}
+
+TEST(Checkpoint32Test, StoresMemorySparsely) {
+    Memory32 memory(16 * Memory32::PAGE_WORDS);
+    memory.store(5, 1);                                    // page 0: RAW
+    memory.fill(2 * Memory32::PAGE_WORDS, Memory32::PAGE_WORDS, 7); // page 2: FILL
+    memory.store(4 * Memory32::PAGE_WORDS, 3);
+    memory.store(4 * Memory32::PAGE_WORDS, 0);             // page 4: written, but zero again
+
+    std::string path = checkpointPath("checkpoint32_sparse.bin");
+    CheckpointHeader32 state{};
+    state.pc = 42;
+    Checkpoint32::save(path, state, memory);
+
+    CheckpointHeader32 header = readHeader(path);
+    EXPECT_EQ(header.version, CheckpointHeader32::VERSION);
+    EXPECT_EQ(header.pc, 42);
+    EXPECT_EQ(header.pageCount, 2);
+    EXPECT_EQ(header.rawPages, 1);
+    EXPECT_EQ(header.dataOffset % Checkpoint32::ALIGNMENT, 0);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    EXPECT_EQ(static_cast<uint64_t>(file.tellg()), header.dataOffset + Memory32::PAGE_WORDS * sizeof(uint32_t));
+
+    Memory32 restored(16 * Memory32::PAGE_WORDS);
+    restored.store(9 * Memory32::PAGE_WORDS, 5); // Replaced by the checkpoint
+    EXPECT_EQ(Checkpoint32::load(path, restored).pc, 42);
+    EXPECT_EQ(restored.load(5), 1);
+    EXPECT_EQ(restored.load(3 * Memory32::PAGE_WORDS - 1), 7);
+    EXPECT_EQ(restored.load(9 * Memory32::PAGE_WORDS), 0);
+    EXPECT_EQ(restored.writtenPages(), (std::vector<uint32_t>{0, 2}));
+}
+
+TEST(Checkpoint32Test, LargeCheckpointsAreMapped) {
+    const uint32_t pages = 2 * Checkpoint32::MAP_THRESHOLD;
+    Memory32 memory(pages * Memory32::PAGE_WORDS + 100); // A short last page
+    for (uint32_t i = 0; i < memory.getSize(); i += 7) {
+        memory.store(i, i);
+    }
+    std::string path = checkpointPath("checkpoint32_large.bin");
+    Checkpoint32::save(path, CheckpointHeader32{}, memory);
+
+    for (auto mode : {Memory32::Mode::Checked, Memory32::Mode::Guarded}) {
+        Memory32 restored(memory.getSize(), mode);
+        Checkpoint32::load(path, restored);
+        for (uint32_t i = 0; i < restored.getSize(); ++i) {
+            ASSERT_EQ(restored.load(i), i % 7 == 0 ? i : 0);
+        }
+        if (restored.getMode() == Memory32::Mode::Checked) {
+            EXPECT_EQ(restored.residentPages(), 0); // Mapped, not copied
+        }
+        restored.store(3, 99); // Copy-on-write: the file is untouched
+    }
+    Memory32 again(memory.getSize());
+    Checkpoint32::load(path, again);
+    EXPECT_EQ(again.load(3), 0);
+}
+
+TEST(Checkpoint32Test, RejectsMismatchedOrDamagedFiles) {
+    Memory32 memory(4 * Memory32::PAGE_WORDS);
+    memory.store(1, 1);
+    std::string path = checkpointPath("checkpoint32_damaged.bin");
+    Checkpoint32::save(path, CheckpointHeader32{}, memory);
+
+    Memory32 other(8 * Memory32::PAGE_WORDS);
+    EXPECT_THROW(Checkpoint32::load(path, other), std::invalid_argument);
+
+    CheckpointHeader32 header = readHeader(path);
+    auto rewrite = [&](const CheckpointHeader32& changed) {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.write(reinterpret_cast<const char*>(&changed), sizeof(changed));
+    };
+    CheckpointHeader32 future = header;
+    future.version = CheckpointHeader32::VERSION + 1;
+    rewrite(future);
+    EXPECT_THROW(Checkpoint32::load(path, memory), std::runtime_error);
+
+    CheckpointHeader32 truncated = header;
+    truncated.rawPages = 2;
+    rewrite(truncated);
+    EXPECT_THROW(Checkpoint32::load(path, memory), std::runtime_error);
+
+    // A page count far past the end of the file is rejected before anything is allocated
+    CheckpointHeader32 oversized = header;
+    oversized.pageCount = 0xFFFFFFF0;
+    rewrite(oversized);
+    EXPECT_THROW(Checkpoint32::load(path, memory), std::runtime_error);
+
+    CheckpointHeader32 garbage = header;
+    std::memcpy(garbage.magic, "NOTACKPT", 8);
+    rewrite(garbage);
+    EXPECT_THROW(Checkpoint32::load(path, memory), std::runtime_error);
+    EXPECT_EQ(memory.load(1), 1); // Nothing was touched
+    EXPECT_THROW(Checkpoint32::load(checkpointPath("checkpoint32_missing.bin"), memory), std::runtime_error);
+}
+
+TEST(Checkpoint32Test, LoadsVersion1Files) {
+    // Version 1 had no vector registers: its header stops where they begin, and the page
+    // directory follows straight after
+    constexpr size_t V1_HEADER_BYTES = offsetof(CheckpointHeader32, vectors);
+    auto writeVersion1 = [](const std::string& path, CheckpointHeader32 header,
+                            const std::vector<CheckpointPage32>& directory, const std::vector<uint32_t>& raw) {
+        std::memcpy(header.magic, CheckpointHeader32::MAGIC, sizeof(header.magic));
+        header.version = 1;
+        header.headerBytes = V1_HEADER_BYTES;
+        header.pageCount = static_cast<uint32_t>(directory.size());
+        header.rawPages = static_cast<uint32_t>(raw.size() / Memory32::PAGE_WORDS);
+        uint64_t directoryEnd = V1_HEADER_BYTES + directory.size() * sizeof(CheckpointPage32);
+        header.dataOffset = (directoryEnd + Checkpoint32::ALIGNMENT - 1) / Checkpoint32::ALIGNMENT * Checkpoint32::ALIGNMENT;
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), V1_HEADER_BYTES);
+        file.write(reinterpret_cast<const char*>(directory.data()),
+                   static_cast<std::streamsize>(directory.size() * sizeof(CheckpointPage32)));
+        std::vector<char> padding(header.dataOffset - directoryEnd);
+        file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        file.write(reinterpret_cast<const char*>(raw.data()), static_cast<std::streamsize>(raw.size() * sizeof(uint32_t)));
+    };
+    CheckpointHeader32 state{};
+    state.memorySize = 4 * Memory32::PAGE_WORDS;
+    for (uint32_t i = 0; i < 16; ++i) {
+        state.registers[i] = i * 3;
+    }
+    state.pc = 7;
+    state.sp = 0x3FF;
+    std::memset(state.vectors, 0xAB, sizeof(state.vectors)); // Not written: a v1 file has none
+
+    std::vector<uint32_t> raw(Memory32::PAGE_WORDS);
+    raw[5] = 55;
+    std::string path = checkpointPath("checkpoint32_version1.bin");
+    writeVersion1(path, state, {{1, CheckpointPage32::RAW, 0}, {3, CheckpointPage32::FILL, 9}}, raw);
+
+    Memory32 memory(state.memorySize);
+    CheckpointHeader32 header = Checkpoint32::load(path, memory);
+    EXPECT_EQ(header.version, 1);
+    EXPECT_EQ(std::memcmp(header.registers, state.registers, sizeof(state.registers)), 0);
+    EXPECT_EQ(header.pc, 7);
+    EXPECT_EQ(header.sp, 0x3FF);
+    for (const auto& vector : header.vectors) {
+        EXPECT_EQ(vector[0] | vector[1] | vector[2] | vector[3], 0);
+    }
+    EXPECT_EQ(memory.load(Memory32::PAGE_WORDS + 5), 55);
+    EXPECT_EQ(memory.load(3 * Memory32::PAGE_WORDS + 100), 9);
+    EXPECT_EQ(memory.load(2 * Memory32::PAGE_WORDS), 0);
+}
@@ -23,3 +23,10 @@ TEST_F(Clock32Test, Tick) {
     clock->tick();
     EXPECT_EQ(clock->GetState(), false);
 }
+
+TEST_F(Clock32Test, CountsCycles) {
+    clock->tick();
+    clock->tick(5);
+    EXPECT_EQ(clock->GetCycles(), 6);
+    EXPECT_EQ(clock->GetState(), false);
+}
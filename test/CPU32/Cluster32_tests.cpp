@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <CPU32/Cluster32.hpp>
+
+TEST(Cluster32Test, CoresStartWithTheirOwnIdAndStack) {
+    Cluster32 cluster(3, 1 << 16);
+    ASSERT_EQ(cluster.size(), 3);
+    for (uint32_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(cluster.core(i).GetRegisters()[0]->GetState(), i);
+        EXPECT_EQ(cluster.core(i).GetStackPointer()->GetState(), (1u << 16) - i * Cluster32::STACK_WORDS);
+    }
+    EXPECT_TRUE(cluster.GetMemory()->isConcurrent());
+    EXPECT_THROW(Cluster32(17, 1 << 16), std::invalid_argument);
+}
+
+TEST(Cluster32Test, FetchAddCountsEveryIncrement) {
+    std::vector<uint32_t> program = {
+            0x02012000, // 0: MOV R1, 0x2000
+            0x020303E8, // 1: MOV R3, 1000
+            0x02040001, // 2: MOV R4, 1
+            0x61040100, // 3: XADD R4, R1
+            0x02050001, // 4: MOV R5, 1
+            0x06030500, // 5: SUB R3, R5
+            0x10030000, // 6: CMP R3, 0
+            0x14000002, // 7: JNZ 2
+            0xFF000000  // 8: HLT
+    };
+    Cluster32 cluster(4, 1 << 16);
+    cluster.loadProgram(program, 0);
+    auto results = cluster.run();
+    ASSERT_EQ(results.size(), 4);
+    for (const auto& result : results) {
+        EXPECT_EQ(result.reason, StopReason32::Halted);
+        EXPECT_EQ(result.instructions, 3 + 1000 * 6);
+    }
+    EXPECT_EQ(cluster.GetMemory()->load(0x2000), 4000);
+}
+
+TEST(Cluster32Test, CompareAndSwapLockGuardsPlainUpdates) {
+    // Each core takes a spin lock 500 times around a plain LOAD/ADD/STORE
+    std::vector<uint32_t> program = {
+            0x02012000, // 0: MOV R1, 0x2000  (counter)
+            0x02022001, // 1: MOV R2, 0x2001  (lock)
+            0x020301F4, // 2: MOV R3, 500
+            0x02070001, // 3: MOV R7, 1
+            0x02040000, // 4: MOV R4, 0
+            0x60040207, // 5: CAS R4, R2, R7
+            0x14000004, // 6: JNZ 4
+            0x62000000, // 7: FENCE
+            0x03050100, // 8: LOAD R5, [R1]
+            0x05050700, // 9: ADD R5, R7
+            0x04050100, // 10: STORE R5, [R1]
+            0x62000000, // 11: FENCE
+            0x04040200, // 12: STORE R4, [R2]  (R4 is 0 after a successful CAS)
+            0x06030700, // 13: SUB R3, R7
+            0x10030000, // 14: CMP R3, 0
+            0x14000004, // 15: JNZ 4
+            0xFF000000  // 16: HLT
+    };
+    Cluster32 cluster(4, 1 << 16);
+    cluster.loadProgram(program, 0);
+    for (const auto& result : cluster.run()) {
+        EXPECT_EQ(result.reason, StopReason32::Halted);
+    }
+    EXPECT_EQ(cluster.GetMemory()->load(0x2000), 2000);
+    EXPECT_EQ(cluster.GetMemory()->load(0x2001), 0);
+}
+
+TEST(Cluster32Test, BudgetAppliesPerCore) {
+    Cluster32 cluster(2, 1 << 16);
+    cluster.loadProgram({0x12000000}, 0); // JMP 0
+    for (const auto& result : cluster.run(Cluster32::SLICE + 5)) {
+        EXPECT_EQ(result.reason, StopReason32::BudgetExhausted);
+        EXPECT_EQ(result.instructions, Cluster32::SLICE + 5);
+    }
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <CPU32/DecodeCache32.hpp>
+
+class DecodeCache32Test : public ::testing::Test {
+protected:
+    using Cache = DecodeCache32<void (*)()>;
+
+    std::shared_ptr<Memory32> memory = std::make_shared<Memory32>(2048);
+    Cache cache{memory};
+
+    Cache::Entry makeEntry(uint32_t instruction, uint8_t length) {
+        Cache::Entry entry;
+        entry.instruction = instruction;
+        entry.length = length;
+        return entry;
+    }
+};
+
+TEST_F(DecodeCache32Test, SlotsStartEmpty) {
+    EXPECT_EQ(cache.slot(0).length, 0);
+    EXPECT_EQ(cache.slot(2047).length, 0);
+}
+
+TEST_F(DecodeCache32Test, InsertedEntryIsReturned) {
+    cache.insert(5, makeEntry(0x02010001, 1));
+    EXPECT_EQ(cache.slot(5).instruction, 0x02010001);
+    EXPECT_EQ(cache.slot(5).length, 1);
+}
+
+TEST_F(DecodeCache32Test, StoreToInstructionInvalidatesIt) {
+    cache.insert(5, makeEntry(0x02010001, 1));
+    memory->store(5, 0x02010002);
+    EXPECT_EQ(cache.slot(5).length, 0);
+}
+
+TEST_F(DecodeCache32Test, StoreToTrailingWordInvalidatesInstruction) {
+    cache.insert(10, makeEntry(0xE4FFFFFF, 3));
+    cache.insert(13, makeEntry(0xFF000000, 1));
+    memory->store(12, 0x1234);
+    EXPECT_EQ(cache.slot(10).length, 0);
+    EXPECT_EQ(cache.slot(13).length, 1);
+}
+
+TEST_F(DecodeCache32Test, StoreNextToInstructionKeepsIt) {
+    cache.insert(10, makeEntry(0x02010001, 1));
+    memory->store(11, 0x1234);
+    memory->store(9, 0x1234);
+    EXPECT_EQ(cache.slot(10).length, 1);
+}
+
+TEST_F(DecodeCache32Test, OutOfBoundsSlot) {
+    EXPECT_THROW(cache.slot(4096), std::out_of_range);
+}
@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include <CPU32/Bus32.hpp>
+#include <CPU32/Devices32.hpp>
+#include <sstream>
+
+TEST(Devices32Test, ConsoleBuffersOutputUntilFlushed) {
+    std::ostringstream out;
+    ConsoleDevice32 console(out);
+    for (char c : std::string("hello")) {
+        console.write(ConsoleDevice32::DATA, static_cast<uint32_t>(c));
+    }
+    EXPECT_EQ(out.str(), "");
+    console.flush();
+    EXPECT_EQ(out.str(), "hello");
+}
+
+TEST(Devices32Test, ConsoleFlushesWhenBufferFills) {
+    std::ostringstream out;
+    ConsoleDevice32 console(out);
+    for (size_t i = 0; i < ConsoleDevice32::BUFFER_SIZE; ++i) {
+        console.write(ConsoleDevice32::DATA, 'x');
+    }
+    EXPECT_EQ(out.str().size(), ConsoleDevice32::BUFFER_SIZE);
+}
+
+TEST(Devices32Test, ConsoleInput) {
+    std::ostringstream out;
+    ConsoleDevice32 console(out);
+    EXPECT_FALSE(console.ready(ConsoleDevice32::DATA));
+    console.feed("ab");
+    EXPECT_TRUE(console.ready(ConsoleDevice32::DATA));
+    EXPECT_EQ(console.read(ConsoleDevice32::STATUS), 2);
+    EXPECT_EQ(console.read(ConsoleDevice32::DATA), 'a');
+    EXPECT_EQ(console.read(ConsoleDevice32::DATA), 'b');
+    EXPECT_FALSE(console.ready(ConsoleDevice32::DATA));
+}
+
+TEST(Devices32Test, TimerCountsFromItsSource) {
+    uint64_t now = 0x100000005;
+    TimerDevice32 timer([&] { return now; });
+    now += 0x200000003;
+    EXPECT_EQ(timer.read(TimerDevice32::LOW), 3);
+    EXPECT_EQ(timer.read(TimerDevice32::HIGH), 2);
+
+    timer.write(TimerDevice32::LOW, 0);
+    now += 7;
+    EXPECT_EQ(timer.read(TimerDevice32::LOW), 7);
+    EXPECT_EQ(timer.read(TimerDevice32::HIGH), 0);
+}
+
+TEST(Devices32Test, IntervalTimerRaisesItsLine) {
+    uint64_t now = 0;
+    auto controller = std::make_shared<InterruptController32>([&] { return now; });
+    auto timer = std::make_shared<IntervalTimerDevice32>(controller, 3);
+    controller->attach(timer);
+    EXPECT_EQ(controller->nextEvent(), InterruptController32::NEVER);
+
+    timer->write(IntervalTimerDevice32::PERIOD, 100);
+    timer->write(IntervalTimerDevice32::CONTROL, IntervalTimerDevice32::ENABLE | IntervalTimerDevice32::PERIODIC);
+    EXPECT_EQ(controller->nextEvent(), 100);
+    now = 40;
+    EXPECT_EQ(timer->read(IntervalTimerDevice32::COUNT), 60);
+
+    now = 350; // Missed expiries collapse into one
+    controller->expire(now);
+    EXPECT_EQ(controller->pending(), 1u << 3);
+    EXPECT_EQ(controller->nextDeadline(), 450);
+    EXPECT_EQ(controller->nextEvent(), 450); // Interrupts are disabled
+    controller->setEnabled(true);
+    EXPECT_EQ(controller->nextEvent(), 0);
+    EXPECT_EQ(controller->acknowledge(), 3);
+    EXPECT_EQ(controller->acknowledge(), -1);
+    EXPECT_EQ(controller->nextEvent(), 450);
+
+    timer->write(IntervalTimerDevice32::CONTROL, IntervalTimerDevice32::ENABLE); // One-shot
+    controller->expire(now + 100);
+    EXPECT_EQ(controller->nextDeadline(), InterruptController32::NEVER);
+    EXPECT_EQ(timer->read(IntervalTimerDevice32::CONTROL), 0);
+    EXPECT_THROW(controller->raise(32), std::out_of_range);
+}
+
+TEST(Devices32Test, BlockDeviceTransfersWholeBlocks) {
+    std::string path = ::testing::TempDir() + "devices32_disk.bin";
+    std::remove(path.c_str());
+    auto memory = std::make_shared<Memory32>(4 * Memory32::PAGE_WORDS);
+    BlockDevice32 disk(path, memory);
+    EXPECT_EQ(disk.read(BlockDevice32::BLOCKS), 0);
+
+    memory->fill(Memory32::PAGE_WORDS, BlockDevice32::BLOCK_WORDS, 0xABCD);
+    disk.write(BlockDevice32::BLOCK, 2);
+    disk.write(BlockDevice32::ADDRESS, Memory32::PAGE_WORDS);
+    disk.write(BlockDevice32::COMMAND, BlockDevice32::WRITE);
+    EXPECT_EQ(disk.read(BlockDevice32::COMMAND), BlockDevice32::STATUS_OK);
+    EXPECT_EQ(disk.read(BlockDevice32::BLOCKS), 3);
+
+    disk.write(BlockDevice32::ADDRESS, 2 * Memory32::PAGE_WORDS);
+    disk.write(BlockDevice32::COMMAND, BlockDevice32::READ);
+    EXPECT_EQ(memory->compare(Memory32::PAGE_WORDS, 2 * Memory32::PAGE_WORDS, BlockDevice32::BLOCK_WORDS),
+              BlockDevice32::BLOCK_WORDS);
+
+    disk.write(BlockDevice32::BLOCK, 0); // Never written: a hole in the file
+    disk.write(BlockDevice32::COMMAND, BlockDevice32::READ);
+    EXPECT_EQ(memory->load(2 * Memory32::PAGE_WORDS), 0);
+
+    disk.write(BlockDevice32::ADDRESS, 4 * Memory32::PAGE_WORDS - 1); // Buffer runs off the end
+    disk.write(BlockDevice32::COMMAND, BlockDevice32::READ);
+    EXPECT_EQ(disk.read(BlockDevice32::COMMAND), BlockDevice32::STATUS_ERROR);
+}
+
+TEST(Devices32Test, MemoryMappedBlockDeviceDoesNotKeepItsMemoryAlive) {
+    std::string path = ::testing::TempDir() + "devices32_mapped_disk.bin";
+    std::weak_ptr<Memory32> released;
+    std::weak_ptr<Device32> device;
+    {
+        auto memory = std::make_shared<Memory32>(4 * Memory32::PAGE_WORDS);
+        auto disk = std::make_shared<BlockDevice32>(path, memory);
+        Bus32 bus(memory);
+        bus.attachMemory(3 * Memory32::PAGE_WORDS, 4, disk);
+        released = memory;
+        device = disk;
+    }
+    EXPECT_TRUE(released.expired());
+    EXPECT_TRUE(device.expired());
+}
+
+TEST(Devices32Test, ForkedBlockDeviceTransfersIntoTheForkedMemory) {
+    std::string path = ::testing::TempDir() + "devices32_forked_disk.bin";
+    std::remove(path.c_str());
+    auto memory = std::make_shared<Memory32>(4 * Memory32::PAGE_WORDS);
+    auto disk = std::make_shared<BlockDevice32>(path, memory);
+    Bus32 bus(memory);
+    bus.attachPorts(0, 4, disk);
+    bus.attachMemory(3 * Memory32::PAGE_WORDS, 4, disk);
+    memory->fill(0, BlockDevice32::BLOCK_WORDS, 0x77);
+    bus.out(BlockDevice32::COMMAND, BlockDevice32::WRITE); // Block 0 from address 0
+
+    auto forkedMemory = memory->fork();
+    auto forked = bus.fork(forkedMemory);
+    forked->out(BlockDevice32::ADDRESS, Memory32::PAGE_WORDS);
+    forked->out(BlockDevice32::COMMAND, BlockDevice32::READ);
+    EXPECT_EQ(forkedMemory->load(Memory32::PAGE_WORDS), 0x77);
+    EXPECT_EQ(memory->load(Memory32::PAGE_WORDS), 0);
+    EXPECT_EQ(bus.in(BlockDevice32::ADDRESS), 0); // The parent's registers are its own
+
+    // The mapped registers are the forked device's too
+    forkedMemory->store(3 * Memory32::PAGE_WORDS + BlockDevice32::ADDRESS, 2 * Memory32::PAGE_WORDS);
+    forkedMemory->store(3 * Memory32::PAGE_WORDS + BlockDevice32::COMMAND, BlockDevice32::READ);
+    EXPECT_EQ(forkedMemory->load(2 * Memory32::PAGE_WORDS + 5), 0x77);
+    EXPECT_EQ(memory->load(2 * Memory32::PAGE_WORDS + 5), 0);
+    EXPECT_EQ(forked->in(BlockDevice32::ADDRESS), 2 * Memory32::PAGE_WORDS);
+}
+
+TEST(Devices32Test, ForkedBlockDeviceSharesTheDisk) {
+    std::string path = ::testing::TempDir() + "devices32_shared_disk.bin";
+    std::remove(path.c_str());
+    auto memory = std::make_shared<Memory32>(4 * Memory32::PAGE_WORDS);
+    auto disk = std::make_shared<BlockDevice32>(path, memory);
+    Bus32 bus(memory);
+    bus.attachPorts(0, 4, disk);
+
+    // A block the fork writes is on the parent's disk too, once the fork's bus flushes
+    auto forkedMemory = memory->fork();
+    auto forked = bus.fork(forkedMemory);
+    forkedMemory->fill(0, BlockDevice32::BLOCK_WORDS, 0x55);
+    forked->out(BlockDevice32::BLOCK, 1);
+    forked->out(BlockDevice32::COMMAND, BlockDevice32::WRITE);
+    forked->flush();
+    EXPECT_EQ(bus.in(BlockDevice32::BLOCKS), 2);
+    bus.out(BlockDevice32::BLOCK, 1);
+    bus.out(BlockDevice32::ADDRESS, Memory32::PAGE_WORDS);
+    bus.out(BlockDevice32::COMMAND, BlockDevice32::READ);
+    EXPECT_EQ(memory->load(Memory32::PAGE_WORDS + 9), 0x55);
+}
+
+TEST(Devices32Test, MemoryMappedTransferOnAConcurrentMemory) {
+    std::string path = ::testing::TempDir() + "devices32_concurrent_disk.bin";
+    std::remove(path.c_str());
+    auto memory = std::make_shared<Memory32>(4 * Memory32::PAGE_WORDS);
+    auto disk = std::make_shared<BlockDevice32>(path, memory);
+    memory->mapDevice(3 * Memory32::PAGE_WORDS, 4, disk);
+    memory->setConcurrent(true);
+    uint32_t registers = 3 * Memory32::PAGE_WORDS;
+
+    // The device's transfers take the memory lock, so the store must not hold it
+    memory->fill(0, BlockDevice32::BLOCK_WORDS, 0x55);
+    memory->store(registers + BlockDevice32::COMMAND, BlockDevice32::WRITE);
+    memory->store(registers + BlockDevice32::ADDRESS, Memory32::PAGE_WORDS);
+    memory->store(registers + BlockDevice32::COMMAND, BlockDevice32::READ);
+    EXPECT_EQ(memory->load(Memory32::PAGE_WORDS + 9), 0x55);
+
+    std::vector<uint32_t> command = {0, 2 * Memory32::PAGE_WORDS, BlockDevice32::READ};
+    memory->storeBlock(registers, command);
+    EXPECT_EQ(memory->load(2 * Memory32::PAGE_WORDS + 9), 0x55);
+    EXPECT_EQ(memory->compareExchange(registers + BlockDevice32::COMMAND, BlockDevice32::STATUS_OK,
+                                      BlockDevice32::WRITE), BlockDevice32::STATUS_OK);
+    EXPECT_EQ(memory->load(registers + BlockDevice32::COMMAND), BlockDevice32::STATUS_OK);
+}
+
+TEST(Devices32Test, BusRoutesPortsAndMemory) {
+    auto memory = std::make_shared<Memory32>(4 * Memory32::PAGE_WORDS);
+    Bus32 bus(memory);
+    uint64_t now = 0;
+    auto timer = std::make_shared<TimerDevice32>([&] { return now; });
+    bus.attachPorts(4, 2, timer);
+    EXPECT_THROW(bus.attachPorts(5, 1, timer), std::invalid_argument);
+    EXPECT_THROW(bus.attachPorts(255, 2, timer), std::out_of_range);
+    EXPECT_THROW(bus.attachPorts(0xFFFFFFFF, 2, timer), std::out_of_range); // first + count wraps
+    EXPECT_THROW(bus.attachPorts(1, 0xFFFFFFFF, timer), std::out_of_range);
+
+    now = 9;
+    EXPECT_EQ(bus.in(4), 9);
+    EXPECT_EQ(bus.in(7), 0); // Unattached
+    bus.out(4, 0);
+    EXPECT_EQ(bus.in(4), 0);
+
+    memory->store(2 * Memory32::PAGE_WORDS, 5);
+    bus.attachMemory(2 * Memory32::PAGE_WORDS, 2, timer);
+    now = 11;
+    EXPECT_EQ(memory->load(2 * Memory32::PAGE_WORDS), 2); // The device replaced the RAM (restarted at 9)
+    EXPECT_EQ(memory->residentPages(), 0);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <CPU32/JIT32.hpp>
+#include <CPU32/Flags32.hpp>
+
+#if CPU32_JIT_AVAILABLE
+
+class JIT32Test : public ::testing::Test {
+protected:
+    JIT32 jit;
+    RegisterFile32 state{};
+    JITCounters32 counters{};
+
+    static JIT32::Op op(uint32_t instruction, uint32_t pc, uint32_t immediate = 0) {
+        return {instruction, immediate, pc + 1, static_cast<uint8_t>(instruction >> 24),
+                static_cast<uint8_t>(instruction >> 16), static_cast<uint8_t>(instruction >> 8)};
+    }
+
+    void run(const JITCode32* code) {
+        ASSERT_NE(code, nullptr);
+        counters = {0, 1000};
+        code->entry(&state, &counters);
+    }
+};
+
+TEST_F(JIT32Test, StraightLineArithmetic) {
+    std::vector<JIT32::Op> ops = {
+            op(0x02010005, 0), // MOV R1, 5
+            op(0x02020003, 1), // MOV R2, 3
+            op(0x05010200, 2), // ADD R1, R2
+            op(0x06020100, 3), // SUB R2, R1
+    };
+    auto code = jit.compile(ops, 0);
+    run(code);
+    EXPECT_EQ(state.registers[1], 8);
+    EXPECT_EQ(state.registers[2], static_cast<uint32_t>(-5));
+    EXPECT_TRUE(state.flags & Flags32::SIGN);
+    EXPECT_FALSE(state.flags & Flags32::ZERO);
+    EXPECT_EQ(state.pc, 4);
+    EXPECT_EQ(code->length, 4);
+    EXPECT_EQ(code->readMask, 0);
+    EXPECT_EQ(code->writeMask, 0b110);
+}
+
+TEST_F(JIT32Test, UnsupportedInstructionEndsNativeCode) {
+    std::vector<JIT32::Op> ops = {
+            op(0x02010005, 10), // MOV R1, 5
+            op(0x03020100, 11), // LOAD R2, R1
+            op(0x02030001, 12), // MOV R3, 1
+    };
+    auto code = jit.compile(ops, 10);
+    run(code);
+    EXPECT_EQ(code->length, 1);
+    EXPECT_EQ(state.pc, 11);
+}
+
+TEST_F(JIT32Test, NothingToCompile) {
+    EXPECT_EQ(jit.compile({op(0x31000000, 0)}, 0), nullptr); // RET
+}
+
+TEST_F(JIT32Test, SelfLoopRunsNatively) {
+    std::vector<JIT32::Op> ops = {
+            op(0xE5010001, 0), // ADD R1, 1
+            op(0x10010064, 1), // CMP R1, 100
+            op(0x14000000, 2), // JNZ 0
+    };
+    auto code = jit.compile(ops, 0);
+    state.registers[1] = 0;
+    run(code);
+    EXPECT_EQ(state.registers[1], 100);
+    EXPECT_EQ(counters.iterations, 100);
+    EXPECT_EQ(state.pc, 3);
+    EXPECT_TRUE(state.flags & Flags32::ZERO);
+}
+
+TEST_F(JIT32Test, SelfLoopStopsAtIterationBudget) {
+    std::vector<JIT32::Op> ops = {
+            op(0xE5010001, 0), // ADD R1, 1
+            op(0x12000000, 1), // JMP 0
+    };
+    auto code = jit.compile(ops, 0);
+    run(code);
+    EXPECT_EQ(counters.iterations, 1000);
+    EXPECT_EQ(state.registers[1], 1000);
+    EXPECT_EQ(state.pc, 0);
+}
+
+TEST_F(JIT32Test, LeavesUntouchedStateAlone) {
+    state.sp = 0x1234;
+    state.registers[7] = 77;
+    state.registers[1] = 1;
+    auto code = jit.compile({op(0x05010100, 0)}, 0); // ADD R1, R1
+    run(code);
+    EXPECT_EQ(state.registers[1], 2);
+    EXPECT_EQ(state.registers[7], 77);
+    EXPECT_EQ(state.sp, 0x1234);
+}
+
+TEST_F(JIT32Test, ConditionalJumps) {
+    struct Case { uint8_t opcode; uint32_t flags; bool taken; };
+    std::vector<Case> cases = {
+            {0x13, Flags32::ZERO, true}, {0x13, 0, false},
+            {0x14, 0, true}, {0x14, Flags32::ZERO, false},
+            {0x15, Flags32::SIGN, true}, {0x15, 0, false},
+            {0x16, 0, true}, {0x16, Flags32::ZERO, false}, {0x16, Flags32::SIGN, false},
+            {0x17, Flags32::ZERO, true}, {0x17, Flags32::SIGN, true}, {0x17, 0, false},
+            {0x18, 0, true}, {0x18, Flags32::ZERO | Flags32::SIGN, true}, {0x18, Flags32::SIGN, false},
+    };
+    for (const auto& c : cases) {
+        auto code = jit.compile({op((c.opcode << 24) | 0x40, 5)}, 5);
+        state.flags = c.flags;
+        run(code);
+        EXPECT_EQ(state.pc, c.taken ? 0x40u : 6u) << std::hex << int(c.opcode) << " flags " << c.flags;
+        EXPECT_EQ(state.flags, c.flags);
+    }
+}
+
+TEST(JIT32FlushTest, FullRegionFlushesAndCompilesAgain) {
+    JIT32 jit(4096);
+    ASSERT_EQ(jit.capacity(), 4096);
+    JIT32::Op add = {0x05010100, 0, 1, 0x05, 1, 1}; // ADD R1, R1
+    size_t compiled = 0;
+    while (jit.compile({add}, 0)) {
+        ++compiled;
+    }
+    EXPECT_GT(compiled, 0);
+    EXPECT_TRUE(jit.full());
+    EXPECT_LE(jit.used(), jit.capacity());
+    EXPECT_GT(jit.used(), jit.capacity() / 2);
+
+    jit.flush();
+    EXPECT_FALSE(jit.full());
+    EXPECT_EQ(jit.used(), 0);
+    EXPECT_EQ(jit.flushes(), 1);
+    auto code = jit.compile({add}, 0);
+    ASSERT_NE(code, nullptr);
+    RegisterFile32 state{};
+    state.registers[1] = 21;
+    JITCounters32 counters{0, 1};
+    code->entry(&state, &counters);
+    EXPECT_EQ(state.registers[1], 42);
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <CPU32/LazyFlags32.hpp>
+
+TEST(LazyFlags32Test, NothingPendingKeepsFlags) {
+    LazyFlags32 lazy;
+    EXPECT_FALSE(lazy.pending());
+    EXPECT_EQ(lazy.resolve(Flags32::INTERRUPT | Flags32::CARRY), Flags32::INTERRUPT | Flags32::CARRY);
+}
+
+TEST(LazyFlags32Test, AddCarryAndOverflow) {
+    LazyFlags32 lazy;
+    lazy.record(LazyFlags32::ADD, 0xFFFFFFFF, 1, 0);
+    EXPECT_EQ(lazy.resolve(Flags32::INTERRUPT), Flags32::INTERRUPT | Flags32::CARRY | Flags32::ZERO | Flags32::PARITY);
+
+    lazy.record(LazyFlags32::ADD, 0x7FFFFFFF, 1, 0x80000000);
+    EXPECT_EQ(lazy.resolve(0), Flags32::SIGN | Flags32::OVERFLOW | Flags32::PARITY);
+}
+
+TEST(LazyFlags32Test, SubBorrowAndOverflow) {
+    LazyFlags32 lazy;
+    lazy.record(LazyFlags32::SUB, 3, 8, static_cast<uint32_t>(-5));
+    EXPECT_EQ(lazy.resolve(0), Flags32::CARRY | Flags32::SIGN);
+
+    lazy.record(LazyFlags32::SUB, 0x80000000, 1, 0x7FFFFFFF);
+    EXPECT_EQ(lazy.resolve(0), Flags32::OVERFLOW | Flags32::PARITY);
+}
+
+TEST(LazyFlags32Test, LogicClearsCarryAndOverflow) {
+    LazyFlags32 lazy;
+    lazy.record(LazyFlags32::LOGIC, 0xF0, 0x0F, 0x03);
+    EXPECT_EQ(lazy.resolve(Flags32::CARRY | Flags32::OVERFLOW), Flags32::PARITY);
+}
+
+TEST(LazyFlags32Test, DirectTakesCarryAndOverflowAsGiven) {
+    LazyFlags32 lazy;
+    lazy.record(LazyFlags32::DIRECT, 1, 0, 0x80000000);
+    EXPECT_EQ(lazy.resolve(0), Flags32::CARRY | Flags32::SIGN | Flags32::PARITY);
+    lazy.record(LazyFlags32::DIRECT, 0, 1, 0);
+    EXPECT_EQ(lazy.resolve(0), Flags32::OVERFLOW | Flags32::ZERO | Flags32::PARITY);
+}
+
+TEST(LazyFlags32Test, ZeroOnlyRecordKeepsOtherFlags) {
+    LazyFlags32 lazy;
+    lazy.record(LazyFlags32::SUB, 1, 2, 0xFFFFFFFF);
+    lazy.recordZero(0);
+    EXPECT_TRUE(lazy.isSet(Flags32::ZERO, 0));
+    EXPECT_TRUE(lazy.isSet(Flags32::SIGN, 0));
+    EXPECT_TRUE(lazy.isSet(Flags32::CARRY, 0));
+
+    lazy.clear();
+    lazy.recordZero(5);
+    EXPECT_EQ(lazy.resolve(Flags32::ZERO | Flags32::SIGN), Flags32::SIGN);
+}
+
+TEST(LazyFlags32Test, FlagNamesOnDemand) {
+    EXPECT_EQ(Flags32::names(0), "None");
+    EXPECT_EQ(Flags32::names(Flags32::ZERO | Flags32::PARITY), "ZERO PARITY");
+}
@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+#include <CPU32/LockstepCPU32.hpp>
+#include <random>
+
+namespace {
+
+// Counts R1 down to 0, adding odd values to R2 and subtracting even ones in a
+// subroutine, so lanes with different R1 split and join at every iteration
+const std::vector<uint32_t> divergentProgram = {
+        0x02020000, // 0: MOV R2, 0
+        0x02070001, // 1: MOV R7, 1
+        0x02060000, // 2: MOV R6, 0
+        0x10010000, // 3: CMP R1, 0
+        0x1300000E, // 4: JZ 14
+        0x01030100, // 5: MOV R3, R1
+        0x07030700, // 6: AND R3, R7
+        0x1300000A, // 7: JZ 10
+        0x05020100, // 8: ADD R2, R1
+        0x1200000B, // 9: JMP 11
+        0x30000012, // 10: CALL 18
+        0x06010700, // 11: SUB R1, R7
+        0x12000003, // 12: JMP 3
+        0x00000000, // 13: NOP
+        0x02040100, // 14: MOV R4, 0x100
+        0x04020400, // 15: STORE R2, [R4]
+        0x03050400, // 16: LOAD R5, [R4]
+        0xFF000000, // 17: HLT
+        0x32010000, // 18: PUSH R1
+        0x06020100, // 19: SUB R2, R1
+        0x33080000, // 20: POP R8
+        0x31000000  // 21: RET
+};
+
+} // namespace
+
+TEST(LockstepCPU32Test, LanesMatchIndependentRuns) {
+    constexpr size_t lanes = 100;
+    LockstepCPU32 lockstep(lanes, 4096);
+    lockstep.loadProgram(divergentProgram, 0);
+    std::mt19937 random(3);
+    std::vector<uint32_t> inputs(lanes);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        inputs[lane] = random() % 40;
+        lockstep.setRegister(lane, 1, inputs[lane]);
+    }
+
+    auto result = lockstep.run();
+    EXPECT_TRUE(result.finished);
+    uint64_t retired = 0;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        FastCPU32 cpu(4096);
+        cpu.loadProgram(divergentProgram, 0);
+        cpu.GetRegisters()[1]->loadValue(inputs[lane]);
+        RunResult32 alone = cpu.run(1'000'000);
+        retired += alone.instructions;
+
+        ASSERT_TRUE(lockstep.stopped(lane));
+        EXPECT_EQ(lockstep.stopReason(lane), StopReason32::Halted);
+        for (uint8_t i = 0; i < 16; ++i) {
+            EXPECT_EQ(lockstep.getRegister(lane, i), cpu.GetRegisters()[i]->GetState()) << "lane " << lane;
+        }
+        EXPECT_EQ(lockstep.getProgramCounter(lane), cpu.GetProgramCounter()->GetState());
+        EXPECT_EQ(lockstep.getStackPointer(lane), cpu.GetStackPointer()->GetState());
+        EXPECT_EQ(lockstep.getZeroFlag(lane), cpu.GetZeroFlag());
+        EXPECT_EQ(lockstep.GetMemory(lane)->digest(), cpu.GetMemory()->digest());
+    }
+    EXPECT_EQ(result.laneInstructions, retired);
+    EXPECT_LT(result.steps, retired);
+}
+
+TEST(LockstepCPU32Test, LanesStopOnTheirOwn) {
+    std::vector<uint32_t> program = {
+            0x10010000, // 0: CMP R1, 0
+            0x13000005, // 1: JZ 5
+            0x10010001, // 2: CMP R1, 1
+            0x13000006, // 3: JZ 6
+            0x03020100, // 4: LOAD R2, [R1]
+            0xFF000000, // 5: HLT
+            0x40000000  // 6: IN
+    };
+    LockstepCPU32 lockstep(4, 1024);
+    lockstep.loadProgram(program, 0);
+    lockstep.setRegister(1, 1, 1);
+    lockstep.setRegister(2, 1, 0x9000); // Past the end of memory
+    lockstep.setRegister(3, 1, 2);
+
+    auto result = lockstep.run();
+    EXPECT_TRUE(result.finished);
+    EXPECT_EQ(lockstep.stopReason(0), StopReason32::Halted);
+    EXPECT_EQ(lockstep.getProgramCounter(0), 6);
+    EXPECT_EQ(lockstep.stopReason(1), StopReason32::Fault);
+    EXPECT_EQ(lockstep.getProgramCounter(1), 6);
+    EXPECT_EQ(lockstep.stopReason(2), StopReason32::Fault);
+    EXPECT_EQ(lockstep.getProgramCounter(2), 4);
+    EXPECT_EQ(lockstep.stopReason(3), StopReason32::Halted);
+    EXPECT_EQ(lockstep.getRegister(3, 2), 0x10010001);
+    // Lanes 1 and 2 do not retire the instruction they fault on
+    EXPECT_EQ(result.laneInstructions, 3 + 4 + 4 + 6);
+}
+
+TEST(LockstepCPU32Test, ArithmeticLanesMatchIndependentRuns) {
+    std::vector<uint32_t> program = {
+            0x01030100, 0x20030200, // 0: MOV R3, R1; MUL R3, R2
+            0x01040100, 0x21040200, // 2: MOV R4, R1; MULH R4, R2
+            0x01050100, 0x22050200, // 4: MOV R5, R1; MULHS R5, R2
+            0x01060100, 0x27060200, // 6: MOV R6, R1; SHL R6, R2
+            0x01070100, 0x28070200, // 8: MOV R7, R1; SHR R7, R2
+            0x01080100, 0x29080200, // 10: MOV R8, R1; SAR R8, R2
+            0x01090100, 0x2A090200, // 12: MOV R9, R1; ROL R9, R2
+            0x010A0100, 0x2B0A0200, // 14: MOV R10, R1; ROR R10, R2
+            0x2C0B0100, 0x2D0C0100, // 16: POPCNT R11, R1; CLZ R12, R1
+            0x010D0100, 0x250D0200, // 18: MOV R13, R1; SDIV R13, R2
+            0x010E0100, 0x240E0200, // 20: MOV R14, R1; MOD R14, R2
+            0xFF000000              // 22: HLT
+    };
+    constexpr size_t lanes = 40;
+    LockstepCPU32 lockstep(lanes, 1024);
+    lockstep.loadProgram(program, 0);
+    std::mt19937 random(5);
+    std::vector<std::pair<uint32_t, uint32_t>> inputs(lanes);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        inputs[lane] = {static_cast<uint32_t>(random()), lane % 7 == 0 ? 0 : static_cast<uint32_t>(random())};
+        lockstep.setRegister(lane, 1, inputs[lane].first);
+        lockstep.setRegister(lane, 2, inputs[lane].second);
+    }
+
+    EXPECT_TRUE(lockstep.run().finished);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        FastCPU32 cpu(1024);
+        cpu.loadProgram(program, 0);
+        cpu.GetRegisters()[1]->loadValue(inputs[lane].first);
+        cpu.GetRegisters()[2]->loadValue(inputs[lane].second);
+        RunResult32 alone = cpu.run(100);
+
+        EXPECT_EQ(lockstep.stopReason(lane), alone.reason) << "lane " << lane;
+        EXPECT_EQ(lockstep.getProgramCounter(lane), cpu.GetProgramCounter()->GetState());
+        for (uint8_t i = 0; i < 16; ++i) {
+            EXPECT_EQ(lockstep.getRegister(lane, i), cpu.GetRegisters()[i]->GetState()) << "lane " << lane;
+        }
+        EXPECT_EQ(lockstep.getZeroFlag(lane), cpu.GetZeroFlag());
+        EXPECT_EQ(lockstep.getSignFlag(lane), cpu.GetFlagsRegister()->isFlagSet(Flags32::SIGN));
+    }
+    EXPECT_EQ(lockstep.fault(0), "Division by zero");
+}
+
+TEST(LockstepCPU32Test, LanesLeavingTheProgramFault) {
+    std::vector<uint32_t> program = {
+            0x10010000, // 0: CMP R1, 0
+            0x13000004, // 1: JZ 4
+            0x30000101, // 2: CALL 0x101, past the end of the program
+            0xFF000000, // 3: HLT
+            0x02020007  // 4: MOV R2, 7, then runs off the end
+    };
+    LockstepCPU32 lockstep(2, 1024);
+    lockstep.loadProgram(program, 0);
+    lockstep.setRegister(1, 1, 1);
+
+    auto result = lockstep.run();
+    EXPECT_TRUE(result.finished);
+    EXPECT_EQ(lockstep.stopReason(0), StopReason32::Fault);
+    EXPECT_EQ(lockstep.fault(0), "PC outside the program");
+    EXPECT_EQ(lockstep.getProgramCounter(0), 5);
+    EXPECT_EQ(lockstep.getRegister(0, 2), 7);
+    EXPECT_EQ(lockstep.stopReason(1), StopReason32::Fault);
+    EXPECT_EQ(lockstep.fault(1), "PC outside the program");
+    EXPECT_EQ(lockstep.getProgramCounter(1), 0x101);
+    EXPECT_EQ(lockstep.getStackPointer(1), 1023);
+}
+
+TEST(LockstepCPU32Test, StackOverflowInCallLeavesSPAsCPU32Does) {
+    // CALL 0 recurses until SP wraps below 0 and the store faults
+    LockstepCPU32 lockstep(1, 1024);
+    lockstep.loadProgram({0x30000000}, 0);
+    auto result = lockstep.run();
+    EXPECT_EQ(lockstep.stopReason(0), StopReason32::Fault);
+    EXPECT_EQ(result.laneInstructions, 1024);
+
+    // The same CALL on CPU32 with the stack already full
+    FastCPU32 cpu(1024);
+    cpu.loadProgram({0x30000000}, 0);
+    cpu.GetStackPointer()->loadValue(0);
+    EXPECT_EQ(cpu.run(10).reason, StopReason32::Fault);
+    EXPECT_EQ(lockstep.getStackPointer(0), cpu.GetStackPointer()->GetState());
+    EXPECT_EQ(lockstep.getStackPointer(0), 0xFFFFFFFF);
+}
+
+TEST(LockstepCPU32Test, ImmediatesMatchIndependentRuns) {
+    // A low byte of 0xFF adds a trailing word, but only MOV reg, imm32 reads it
+    std::vector<uint32_t> program = {
+            0x020100FF, 0x00001234, // 0: MOV R1, 255
+            0xE50200FF, 0x00001234, // 2: ADD R2, 255
+            0x100200FF, 0x00001234, // 4: CMP R2, 255
+            0xE2030012,             // 6: MOV R3, imm32 without a trailing word
+            0xE20400FF, 0xDEADBEEF, // 7: MOV R4, 0xDEADBEEF
+            0xFF000000              // 9: HLT
+    };
+    constexpr size_t lanes = 8;
+    LockstepCPU32 lockstep(lanes, 1024);
+    lockstep.loadProgram(program, 0);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        lockstep.setRegister(lane, 2, static_cast<uint32_t>(lane * 4));
+    }
+
+    EXPECT_TRUE(lockstep.run().finished);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        FastCPU32 cpu(1024);
+        cpu.loadProgram(program, 0);
+        cpu.GetRegisters()[2]->loadValue(static_cast<uint32_t>(lane * 4));
+        cpu.run(100);
+
+        EXPECT_EQ(lockstep.getProgramCounter(lane), cpu.GetProgramCounter()->GetState());
+        for (uint8_t i = 0; i < 16; ++i) {
+            EXPECT_EQ(lockstep.getRegister(lane, i), cpu.GetRegisters()[i]->GetState()) << "lane " << lane;
+        }
+        EXPECT_EQ(lockstep.getZeroFlag(lane), cpu.GetZeroFlag());
+        EXPECT_EQ(lockstep.getSignFlag(lane), cpu.GetFlagsRegister()->isFlagSet(Flags32::SIGN));
+    }
+    EXPECT_EQ(lockstep.getRegister(0, 1), 0xFF);
+    EXPECT_EQ(lockstep.getRegister(1, 2), 0x103);
+    EXPECT_EQ(lockstep.getRegister(0, 3), 0);
+    EXPECT_EQ(lockstep.getRegister(0, 4), 0xDEADBEEF);
+}
+
+TEST(LockstepCPU32Test, RunStopsAtTheStepBudget) {
+    LockstepCPU32 lockstep(20, 4096);
+    lockstep.loadProgram(divergentProgram, 0);
+    for (size_t lane = 0; lane < 20; ++lane) {
+        lockstep.setRegister(lane, 1, static_cast<uint32_t>(lane));
+    }
+    auto first = lockstep.run(10);
+    EXPECT_EQ(first.steps, 10);
+    EXPECT_FALSE(first.finished);
+    EXPECT_FALSE(lockstep.stopped(19));
+    EXPECT_EQ(lockstep.stopReason(19), StopReason32::BudgetExhausted);
+
+    auto rest = lockstep.run();
+    EXPECT_TRUE(rest.finished);
+    for (size_t lane = 0; lane < 20; ++lane) {
+        EXPECT_EQ(lockstep.stopReason(lane), StopReason32::Halted);
+    }
+    EXPECT_EQ(lockstep.getRegister(19, 2), 10); // 19 - 18 + 17 - ... + 1
+    EXPECT_NE(LockstepCPU32::vectorISA(), nullptr);
+    EXPECT_THROW(LockstepCPU32(0, 16), std::invalid_argument);
+}
@@ -3,6 +3,9 @@
 //
 #include <gtest/gtest.h>
 #include <CPU32/Memory32.hpp>
+#include <fstream>
+#include <map>
+#include <thread>
 
 class Memory32Test : public ::testing::Test {
 protected:
@@ -22,3 +25,523 @@ TEST_F(Memory32Test, OutOfBoundsAccess) {
     EXPECT_THROW(memory->load(2048), std::out_of_range);
     EXPECT_THROW(memory->store(2048, 42), std::out_of_range);
 }
+
+class WriteRecorder : public IObserver {
+public:
+    std::vector<uint32_t> addresses;
+
+    void Update(uint32_t address) override {
+        addresses.push_back(address);
+    }
+};
+
+TEST_F(Memory32Test, WatchedStoreNotifiesObservers) {
+    WriteRecorder recorder;
+    memory->Attach(&recorder);
+    memory->watch(10);
+
+    memory->store(10, 1);
+    memory->store(2000 % 1024, 2); // Same page as address 10
+    EXPECT_EQ(recorder.addresses, (std::vector<uint32_t>{10, 2000 % 1024}));
+
+    memory->Detach(&recorder);
+    memory->store(10, 3);
+    EXPECT_EQ(recorder.addresses.size(), 2);
+}
+
+TEST_F(Memory32Test, UnwatchedStoreIsSilent) {
+    Memory32 large(4096);
+    WriteRecorder recorder;
+    large.Attach(&recorder);
+    large.watch(10);
+
+    large.store(Memory32::PAGE_WORDS + 10, 1); // Different page
+    EXPECT_TRUE(recorder.addresses.empty());
+    EXPECT_TRUE(large.isWatched(5));
+    EXPECT_FALSE(large.isWatched(Memory32::PAGE_WORDS + 10));
+}
+
+TEST_F(Memory32Test, UntouchedMemoryReadsAsZero) {
+    EXPECT_EQ(memory->load(0), 0);
+    EXPECT_EQ(memory->load(1023), 0);
+    EXPECT_EQ(memory->residentPages(), 0);
+
+    memory->store(5, 0); // Zero into an untouched page needs no storage
+    EXPECT_EQ(memory->residentPages(), 0);
+    memory->store(5, 7);
+    EXPECT_EQ(memory->residentPages(), 1);
+    EXPECT_EQ(memory->load(4), 0);
+}
+
+TEST_F(Memory32Test, FullAddressSpaceOnlyAllocatesTouchedPages) {
+    Memory32 full(Memory32::ADDRESS_SPACE);
+    EXPECT_EQ(full.getSize(), Memory32::ADDRESS_SPACE);
+
+    full.store(0, 1);
+    full.store(0xFFFFFFFF, 2);
+    full.store(0x80000000, 3);
+    EXPECT_EQ(full.load(0), 1);
+    EXPECT_EQ(full.load(0xFFFFFFFF), 2);
+    EXPECT_EQ(full.load(0x80000000), 3);
+    EXPECT_EQ(full.load(0x40000000), 0);
+    EXPECT_EQ(full.residentPages(), 3);
+}
+
+TEST_F(Memory32Test, WatchedUntouchedPageNotifiesOnFirstStore) {
+    WriteRecorder recorder;
+    memory->Attach(&recorder);
+    memory->watch(10);
+
+    memory->store(11, 5);
+    EXPECT_TRUE(memory->isWatched(11));
+    EXPECT_EQ(memory->load(11), 5);
+    EXPECT_EQ(recorder.addresses, (std::vector<uint32_t>{11}));
+    memory->Detach(&recorder);
+}
+
+static std::string writeImage(const std::string& name, const std::vector<uint32_t>& words) {
+    std::string path = ::testing::TempDir() + name;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(uint32_t)));
+    return path;
+}
+
+TEST_F(Memory32Test, MappedImageReadsFileWords) {
+    std::vector<uint32_t> words(Memory32::PAGE_WORDS + 3);
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] = static_cast<uint32_t>(i * 3 + 1);
+    }
+    std::string path = writeImage("memory32_image.bin", words);
+
+    Memory32 large(4 * Memory32::PAGE_WORDS);
+    EXPECT_EQ(large.mapImage(path, Memory32::PAGE_WORDS), words.size());
+    EXPECT_EQ(large.load(Memory32::PAGE_WORDS), 1);
+    EXPECT_EQ(large.load(2 * Memory32::PAGE_WORDS + 2), words.back());
+    EXPECT_EQ(large.load(2 * Memory32::PAGE_WORDS + 3), 0); // Past the end of the file
+    EXPECT_EQ(large.load(0), 0);
+    EXPECT_EQ(large.residentPages(), 0); // Nothing was copied
+}
+
+TEST_F(Memory32Test, MappedImageIsCopyOnWrite) {
+    std::string path = writeImage("memory32_shared.bin", {10, 20, 30});
+    Memory32 first(1024);
+    Memory32 second(1024);
+    first.mapImage(path);
+    second.mapImage(path);
+
+    first.store(1, 99);
+    EXPECT_EQ(first.load(1), 99);
+    EXPECT_EQ(second.load(1), 20);
+
+    Memory32 third(1024);
+    third.mapImage(path);
+    EXPECT_EQ(third.load(1), 20); // The file itself is untouched
+}
+
+TEST_F(Memory32Test, MapImageRejectsBadPlacement) {
+    std::string path = writeImage("memory32_small.bin", {1, 2});
+    EXPECT_THROW(memory->mapImage(path, 1), std::invalid_argument);
+    EXPECT_THROW(memory->mapImage(path + ".missing"), std::runtime_error);
+    Memory32 tiny(1);
+    EXPECT_THROW(tiny.mapImage(path), std::out_of_range);
+}
+
+TEST_F(Memory32Test, MapImageNotifiesWatchedPages) {
+    WriteRecorder recorder;
+    memory->Attach(&recorder);
+    memory->store(0, 5);
+    memory->watch(0);
+
+    memory->mapImage(writeImage("memory32_watched.bin", {7}));
+    EXPECT_EQ(memory->load(0), 7);
+    EXPECT_EQ(memory->residentPages(), 0);
+    EXPECT_EQ(recorder.addresses.size(), Memory32::PAGE_WORDS);
+    memory->Detach(&recorder);
+}
+
+TEST_F(Memory32Test, GuardedModeFaultsLikeCheckedMode) {
+    Memory32 guarded(1024, Memory32::Mode::Guarded);
+    if (guarded.getMode() != Memory32::Mode::Guarded) {
+        GTEST_SKIP() << "guard pages are not available in this build";
+    }
+    guarded.store(100, 42);
+    EXPECT_EQ(guarded.load(100), 42);
+    EXPECT_EQ(guarded.load(101), 0);
+    // volatile so the unused loads are not optimised away
+    volatile uint32_t value = 0;
+    EXPECT_THROW(value = guarded.load(2048), std::out_of_range);
+    EXPECT_THROW(guarded.store(0xFFFFFFFF, 1), std::out_of_range);
+    // The handler is still in place after a fault has been thrown through it
+    EXPECT_THROW(value = guarded.load(4096), std::out_of_range);
+    EXPECT_EQ(value, 0);
+    EXPECT_EQ(guarded.load(100), 42);
+}
+
+TEST_F(Memory32Test, AccessAtSizeFaultsInEitherMode) {
+    // 1000 words end part way into a host page, 1024 on its boundary (where one is 4 KiB)
+    for (size_t size : {size_t(1000), size_t(1024)}) {
+        for (auto mode : {Memory32::Mode::Checked, Memory32::Mode::Guarded}) {
+            Memory32 memory(size, mode);
+            auto last = static_cast<uint32_t>(size - 1);
+            memory.store(last, 7);
+            EXPECT_EQ(memory.load(last), 7);
+            volatile uint32_t value = 0;
+            EXPECT_THROW(memory.store(static_cast<uint32_t>(size), 7), std::out_of_range);
+            EXPECT_THROW(value = memory.load(static_cast<uint32_t>(size)), std::out_of_range);
+            EXPECT_EQ(value, 0);
+        }
+    }
+    EXPECT_EQ(Memory32(1000, Memory32::Mode::Guarded).getMode(), Memory32::Mode::Checked);
+}
+
+TEST_F(Memory32Test, GuardedModeKeepsWatchingAndImages) {
+    Memory32 guarded(4 * Memory32::PAGE_WORDS, Memory32::Mode::Guarded);
+    if (guarded.getMode() != Memory32::Mode::Guarded) {
+        GTEST_SKIP() << "guard pages are not available in this build";
+    }
+    WriteRecorder recorder;
+    guarded.Attach(&recorder);
+    guarded.watch(Memory32::PAGE_WORDS);
+    guarded.store(Memory32::PAGE_WORDS + 1, 5);
+    guarded.store(1, 5);
+    EXPECT_EQ(recorder.addresses, (std::vector<uint32_t>{Memory32::PAGE_WORDS + 1}));
+
+    std::string path = writeImage("memory32_guarded.bin", {7, 8, 9});
+    guarded.mapImage(path, 2 * Memory32::PAGE_WORDS);
+    EXPECT_EQ(guarded.load(2 * Memory32::PAGE_WORDS + 2), 9);
+    guarded.store(2 * Memory32::PAGE_WORDS, 1);
+    Memory32 other(Memory32::PAGE_WORDS);
+    other.mapImage(path);
+    EXPECT_EQ(other.load(0), 7);
+    guarded.Detach(&recorder);
+}
+
+TEST_F(Memory32Test, GuardedModeReadsImagesInOnLargerHostPages) {
+    Memory32 guarded(4 * Memory32::PAGE_WORDS, Memory32::Mode::Guarded);
+    if (guarded.getMode() != Memory32::Mode::Guarded) {
+        GTEST_SKIP() << "guard pages are not available in this build";
+    }
+    for (uint32_t address = 0; address < 4 * Memory32::PAGE_WORDS; ++address) {
+        guarded.store(address, 5);
+    }
+    std::vector<uint32_t> words(Memory32::PAGE_WORDS + 2, 7);
+    std::string path = writeImage("memory32_large_pages.bin", words);
+
+    Memory32::overrideHostPageSize(16 * 1024); // As on a 16K page host
+    EXPECT_EQ(guarded.mapImage(path, Memory32::PAGE_WORDS), words.size());
+    Memory32::overrideHostPageSize(0);
+
+    EXPECT_EQ(guarded.load(Memory32::PAGE_WORDS - 1), 5); // Neighbours are untouched
+    EXPECT_EQ(guarded.load(Memory32::PAGE_WORDS), 7);
+    EXPECT_EQ(guarded.load(2 * Memory32::PAGE_WORDS + 1), 7);
+    EXPECT_EQ(guarded.load(2 * Memory32::PAGE_WORDS + 2), 0); // Past the end of the file
+    EXPECT_EQ(guarded.load(3 * Memory32::PAGE_WORDS), 5);
+    guarded.store(Memory32::PAGE_WORDS, 1);
+    Memory32 other(2 * Memory32::PAGE_WORDS);
+    other.mapImage(path);
+    EXPECT_EQ(other.load(0), 7); // The file itself is untouched
+}
+
+TEST_F(Memory32Test, GuardedFullAddressSpaceHasNoGuard) {
+    Memory32 full(Memory32::ADDRESS_SPACE, Memory32::Mode::Guarded);
+    if (full.getMode() != Memory32::Mode::Guarded) {
+        GTEST_SKIP() << "guard pages are not available in this build";
+    }
+    full.store(0xFFFFFFFF, 3);
+    EXPECT_EQ(full.load(0xFFFFFFFF), 3);
+    EXPECT_EQ(full.residentPages(), 1);
+    EXPECT_EQ(full.load(0x80000000), 0);
+}
+
+TEST_F(Memory32Test, BlockStoreAndLoadCrossPages) {
+    Memory32 large(4 * Memory32::PAGE_WORDS);
+    std::vector<uint32_t> words(Memory32::PAGE_WORDS + 10);
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] = static_cast<uint32_t>(i + 1);
+    }
+    large.storeBlock(Memory32::PAGE_WORDS - 5, words);
+    EXPECT_EQ(large.load(Memory32::PAGE_WORDS - 5), 1);
+    EXPECT_EQ(large.load(2 * Memory32::PAGE_WORDS + 4), words.back());
+
+    std::vector<uint32_t> out(words.size() + 2);
+    auto loaded = large.loadBlock(Memory32::PAGE_WORDS - 6, out);
+    EXPECT_EQ(loaded.size(), out.size());
+    EXPECT_EQ(out.front(), 0);
+    EXPECT_EQ(out[1], 1);
+    EXPECT_EQ(out.back(), 0);
+
+    EXPECT_THROW(large.storeBlock(4 * Memory32::PAGE_WORDS - 1, words), std::out_of_range);
+    EXPECT_EQ(large.load(4 * Memory32::PAGE_WORDS - 1), 0); // Nothing was written
+}
+
+TEST_F(Memory32Test, FillAndCompare) {
+    Memory32 large(4 * Memory32::PAGE_WORDS);
+    large.fill(0, 0, 7);
+    large.fill(100, 1500, 0);
+    EXPECT_EQ(large.residentPages(), 0); // Zero fills leave untouched pages alone
+
+    large.fill(100, 1500, 9);
+    large.fill(2000, 1500, 9);
+    EXPECT_EQ(large.load(1599), 9);
+    EXPECT_EQ(large.load(1600), 0);
+    EXPECT_EQ(large.compare(100, 2000, 1500), 1500);
+
+    large.store(2000 + 1200, 3);
+    EXPECT_EQ(large.compare(100, 2000, 1500), 1200);
+    EXPECT_EQ(large.compare(3000, 3500, 0), 0);
+    EXPECT_THROW(large.compare(0, 4000, 200), std::out_of_range);
+}
+
+TEST_F(Memory32Test, CopyHandlesOverlap) {
+    Memory32 large(8 * Memory32::PAGE_WORDS);
+    std::vector<uint32_t> words(3000);
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] = static_cast<uint32_t>(i);
+    }
+    large.storeBlock(1000, words);
+
+    large.copy(1500, 1000, 3000); // Overlapping, destination above source
+    for (uint32_t i = 0; i < 3000; i += 250) {
+        EXPECT_EQ(large.load(1500 + i), i);
+    }
+    large.copy(1000, 1500, 3000); // And back down again
+    for (uint32_t i = 0; i < 3000; i += 250) {
+        EXPECT_EQ(large.load(1000 + i), i);
+    }
+    EXPECT_THROW(large.copy(0, 8 * Memory32::PAGE_WORDS - 1, 2), std::out_of_range);
+}
+
+TEST_F(Memory32Test, BulkStoresNotifyWatchedPages) {
+    WriteRecorder recorder;
+    memory->Attach(&recorder);
+    memory->watch(0);
+    memory->fill(10, 3, 1);
+    memory->copy(20, 10, 2);
+    EXPECT_EQ(recorder.addresses, (std::vector<uint32_t>{10, 11, 12, 20, 21}));
+    memory->Detach(&recorder);
+}
+
+TEST_F(Memory32Test, GuardedModeBulkOperations) {
+    Memory32 guarded(8 * Memory32::PAGE_WORDS, Memory32::Mode::Guarded);
+    if (guarded.getMode() != Memory32::Mode::Guarded) {
+        GTEST_SKIP() << "guard pages are not available in this build";
+    }
+    guarded.fill(1000, 3000, 4);
+    guarded.store(1000, 1);
+    guarded.copy(1001, 1000, 3000);
+    EXPECT_EQ(guarded.load(1001), 1);
+    EXPECT_EQ(guarded.load(4000), 4);
+    EXPECT_EQ(guarded.compare(1001, 1000, 1), 1);
+    EXPECT_EQ(guarded.compare(1002, 1001, 2000), 0);
+    EXPECT_EQ(guarded.compare(1003, 1002, 2000), 2000);
+
+    std::vector<uint32_t> out(4);
+    guarded.loadBlock(999, out);
+    EXPECT_EQ(out, (std::vector<uint32_t>{0, 1, 1, 4}));
+    EXPECT_THROW(guarded.fill(8 * Memory32::PAGE_WORDS - 2, 3, 1), std::out_of_range);
+}
+
+class RegisterDevice : public Device32 {
+public:
+    std::map<uint32_t, uint32_t> registers;
+
+    uint32_t read(uint32_t offset) override { return registers[offset] + 1000; }
+    void write(uint32_t offset, uint32_t value) override { registers[offset] = value; }
+};
+
+TEST_F(Memory32Test, MappedDeviceSeesLoadsAndStores) {
+    Memory32 large(4 * Memory32::PAGE_WORDS);
+    auto device = std::make_shared<RegisterDevice>();
+    large.mapDevice(Memory32::PAGE_WORDS, 16, device);
+
+    large.store(Memory32::PAGE_WORDS + 3, 7);
+    EXPECT_EQ(device->registers[3], 7);
+    EXPECT_EQ(large.load(Memory32::PAGE_WORDS + 3), 1007);
+    large.store(5, 9); // RAM on either side is unaffected
+    large.store(2 * Memory32::PAGE_WORDS, 9);
+    EXPECT_EQ(large.load(5), 9);
+    EXPECT_EQ(large.load(2 * Memory32::PAGE_WORDS), 9);
+
+    std::vector<uint32_t> out(2);
+    large.loadBlock(Memory32::PAGE_WORDS + 2, out);
+    EXPECT_EQ(out, (std::vector<uint32_t>{1000, 1007}));
+    large.fill(Memory32::PAGE_WORDS, 2, 4);
+    EXPECT_EQ(device->registers[1], 4);
+    EXPECT_EQ(large.residentPages(), 2);
+
+    EXPECT_THROW(large.mapDevice(Memory32::PAGE_WORDS + 1, 1, device), std::invalid_argument);
+    EXPECT_THROW(large.mapDevice(Memory32::PAGE_WORDS, 1, device), std::invalid_argument); // Overlap
+    EXPECT_THROW(large.mapDevice(3 * Memory32::PAGE_WORDS, 2 * Memory32::PAGE_WORDS, device), std::out_of_range);
+}
+
+TEST_F(Memory32Test, DirtyPagesFollowWrites) {
+    for (auto mode : {Memory32::Mode::Checked, Memory32::Mode::Guarded}) {
+        Memory32 large(8 * Memory32::PAGE_WORDS, mode);
+        EXPECT_TRUE(large.dirtyPages().empty());
+
+        large.store(5, 0); // Changes nothing in an untouched page (checked mode)
+        large.store(Memory32::PAGE_WORDS + 1, 7);
+        large.fill(3 * Memory32::PAGE_WORDS + 1000, 100, 2);
+        EXPECT_TRUE(large.isDirty(Memory32::PAGE_WORDS));
+        EXPECT_FALSE(large.isDirty(2 * Memory32::PAGE_WORDS));
+        std::vector<uint32_t> expected = {1, 3, 4};
+        if (large.getMode() == Memory32::Mode::Guarded) {
+            expected.insert(expected.begin(), 0);
+        }
+        EXPECT_EQ(large.dirtyPages(), expected);
+
+        large.clearDirty();
+        EXPECT_TRUE(large.dirtyPages().empty());
+        EXPECT_FALSE(large.isDirty(Memory32::PAGE_WORDS));
+        large.store(Memory32::PAGE_WORDS + 2, 8); // Clean again, so the next store marks it
+        large.copy(6 * Memory32::PAGE_WORDS, Memory32::PAGE_WORDS, 2);
+        EXPECT_EQ(large.dirtyPages(), (std::vector<uint32_t>{1, 6}));
+        EXPECT_EQ(large.load(6 * Memory32::PAGE_WORDS + 1), 7);
+    }
+}
+
+TEST_F(Memory32Test, ResetReturnsToZero) {
+    for (auto mode : {Memory32::Mode::Checked, Memory32::Mode::Guarded}) {
+        Memory32 large(4 * Memory32::PAGE_WORDS, mode);
+        WriteRecorder recorder;
+        large.Attach(&recorder);
+        large.watch(Memory32::PAGE_WORDS);
+        large.fill(0, 2 * Memory32::PAGE_WORDS, 9);
+        recorder.addresses.clear();
+
+        large.reset();
+        EXPECT_EQ(large.load(10), 0);
+        EXPECT_EQ(large.load(Memory32::PAGE_WORDS + 10), 0);
+        EXPECT_TRUE(large.dirtyPages().empty());
+        EXPECT_TRUE(large.isWatched(Memory32::PAGE_WORDS));
+        EXPECT_EQ(recorder.addresses.size(), Memory32::PAGE_WORDS); // The watched page changed
+        if (large.getMode() == Memory32::Mode::Checked) {
+            EXPECT_EQ(large.residentPages(), 0);
+        }
+    }
+}
+
+TEST_F(Memory32Test, ForkSharesPagesCopyOnWrite) {
+    auto parent = std::make_shared<Memory32>(8 * Memory32::PAGE_WORDS);
+    parent->store(1, 10);
+    parent->store(Memory32::PAGE_WORDS + 1, 20);
+    auto child = parent->fork();
+    EXPECT_EQ(child->load(1), 10);
+    EXPECT_EQ(child->load(Memory32::PAGE_WORDS + 1), 20);
+
+    child->store(1, 11);  // The child copies page 0
+    parent->store(Memory32::PAGE_WORDS + 1, 21); // The parent copies page 1
+    child->store(2 * Memory32::PAGE_WORDS, 30); // A page only the child has
+    EXPECT_EQ(parent->load(1), 10);
+    EXPECT_EQ(child->load(1), 11);
+    EXPECT_EQ(parent->load(Memory32::PAGE_WORDS + 1), 21);
+    EXPECT_EQ(child->load(Memory32::PAGE_WORDS + 1), 20);
+    EXPECT_EQ(parent->load(2 * Memory32::PAGE_WORDS), 0);
+    EXPECT_EQ(parent->residentPages(), 2);
+    EXPECT_EQ(child->residentPages(), 3);
+
+    // Once the child is gone the parent writes its pages in place again
+    child.reset();
+    parent->store(2, 12);
+    parent->fill(3, 2, 13);
+    EXPECT_EQ(parent->load(1), 10);
+    EXPECT_EQ(parent->load(4), 13);
+
+    // Forks of forks, and bulk writes, copy too
+    auto first = parent->fork();
+    auto second = first->fork();
+    second->fill(0, 3 * Memory32::PAGE_WORDS, 5);
+    EXPECT_EQ(parent->load(1), 10);
+    EXPECT_EQ(first->load(1), 10);
+    EXPECT_EQ(second->load(1), 5);
+}
+
+TEST_F(Memory32Test, ForkCarriesDirtyStateAndImages) {
+    std::vector<uint32_t> image(Memory32::PAGE_WORDS, 0xAB);
+    std::string path = ::testing::TempDir() + "memory32_fork_image.bin";
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size() * sizeof(uint32_t)));
+    }
+    Memory32 parent(4 * Memory32::PAGE_WORDS);
+    parent.mapImage(path, 0);
+    parent.clearDirty();
+    parent.store(2 * Memory32::PAGE_WORDS, 1);
+    auto child = parent.fork();
+    EXPECT_EQ(child->dirtyPages(), (std::vector<uint32_t>{2}));
+
+    parent.store(0, 1); // Both sides see the same private mapping, so both copy
+    child->store(1, 2);
+    EXPECT_EQ(parent.load(0), 1);
+    EXPECT_EQ(parent.load(1), 0xAB);
+    EXPECT_EQ(child->load(0), 0xAB);
+    EXPECT_EQ(child->load(1), 2);
+
+    Memory32 guarded(4 * Memory32::PAGE_WORDS, Memory32::Mode::Guarded);
+    guarded.store(Memory32::PAGE_WORDS + 5, 7);
+    auto copy = guarded.fork();
+    EXPECT_EQ(copy->getMode(), Memory32::Mode::Checked);
+    copy->store(Memory32::PAGE_WORDS + 5, 8);
+    EXPECT_EQ(guarded.load(Memory32::PAGE_WORDS + 5), 7);
+    EXPECT_EQ(copy->load(Memory32::PAGE_WORDS + 5), 8);
+}
+
+TEST_F(Memory32Test, AtomicOperations) {
+    for (auto mode : {Memory32::Mode::Checked, Memory32::Mode::Guarded}) {
+        Memory32 mem(4096, mode);
+        WriteRecorder recorder;
+        mem.Attach(&recorder);
+        mem.watch(20);
+
+        EXPECT_EQ(mem.fetchAdd(20, 5), 0);
+        EXPECT_EQ(mem.fetchAdd(20, 0xFFFFFFFF), 5);
+        EXPECT_EQ(mem.load(20), 4);
+        EXPECT_EQ(mem.compareExchange(20, 3, 9), 4); // Fails, nothing written
+        EXPECT_EQ(mem.compareExchange(20, 4, 9), 4);
+        EXPECT_EQ(mem.load(20), 9);
+        EXPECT_EQ(recorder.addresses, (std::vector<uint32_t>{20, 20, 20}));
+        EXPECT_TRUE(mem.isDirty(20));
+        EXPECT_THROW(mem.fetchAdd(4096, 1), std::out_of_range);
+        mem.Detach(&recorder);
+    }
+}
+
+TEST_F(Memory32Test, ConcurrentWritesQueueForOwner) {
+    Memory32 mem(4096);
+    mem.setConcurrent(true);
+    WriteRecorder mine;
+    WriteRecorder unclaimed;
+    mem.Attach(&mine);
+    mem.Attach(&unclaimed);
+    mem.claim(&mine);
+    mem.watch(7);
+
+    mem.store(7, 1); // From the owner thread: delivered at once
+    std::thread([&] {
+        mem.store(7, 2);
+        mem.fetchAdd(7, 1);
+    }).join();
+    EXPECT_EQ(mine.addresses, (std::vector<uint32_t>{7}));
+    EXPECT_EQ(unclaimed.addresses, (std::vector<uint32_t>{7, 7, 7}));
+
+    mem.deliverWrites();
+    EXPECT_EQ(mine.addresses, (std::vector<uint32_t>{7, 7, 7}));
+    EXPECT_EQ(mem.load(7), 3);
+    mem.Detach(&mine);
+    mem.Detach(&unclaimed);
+}
+
+TEST_F(Memory32Test, DigestFollowsContents) {
+    Memory32 first(4096);
+    Memory32 second(4096);
+    EXPECT_EQ(first.digest(), second.digest());
+    first.store(3000, 7);
+    EXPECT_NE(first.digest(), second.digest());
+    second.store(100, 1); // Written, then zero again
+    second.store(100, 0);
+    second.fill(2990, 20, 0);
+    second.store(3000, 7);
+    EXPECT_EQ(first.digest(), second.digest());
+    second.store(3001, 7);
+    EXPECT_NE(first.digest(), second.digest());
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <CPU32/Profiler32.hpp>
+#include <sstream>
+
+TEST(Profiler32Test, CountsOpcodesPcsAndBranches) {
+    Profiler32 profiler;
+    profiler.retire(0, 0x02, 1, 1);
+    profiler.retire(1, 0x14, 2, 0);  // JNZ taken
+    profiler.retire(0, 0x02, 1, 1);
+    profiler.retire(1, 0x14, 2, 2);  // JNZ not taken
+    EXPECT_EQ(profiler.instructions(), 4);
+    EXPECT_EQ(profiler.opcodeCounts()[0x02], 2);
+    EXPECT_EQ(profiler.pcCounts().at(1), 2);
+    EXPECT_EQ(profiler.branches().at(1).taken, 1);
+    EXPECT_EQ(profiler.branches().at(1).notTaken, 1);
+}
+
+TEST(Profiler32Test, InclusiveAndExclusivePerCallTarget) {
+    Profiler32 profiler;
+    profiler.retire(0, 0x30, 1, 10);  // CALL 10
+    profiler.retire(10, 0x00, 11, 11);
+    profiler.retire(11, 0x30, 12, 20); // CALL 20
+    profiler.retire(20, 0x00, 21, 21);
+    profiler.retire(21, 0x31, 22, 12); // RET
+    profiler.retire(12, 0x31, 13, 1);  // RET
+    profiler.retire(1, 0xFF, 2, 2);
+
+    auto calls = profiler.calls();
+    EXPECT_EQ(calls[10].calls, 1);
+    EXPECT_EQ(calls[10].exclusive, 3);
+    EXPECT_EQ(calls[10].inclusive, 5);
+    EXPECT_EQ(calls[20].exclusive, 2);
+    EXPECT_EQ(calls[20].inclusive, 2);
+
+    profiler.setSymbol(20, "leaf");
+    std::ostringstream out;
+    profiler.writeCollapsedStacks(out);
+    EXPECT_EQ(out.str(), "root 2\nroot;0x0000000A 3\nroot;0x0000000A;leaf 2\n");
+}
+
+TEST(Profiler32Test, RecursionCountsInclusiveOnce) {
+    Profiler32 profiler;
+    profiler.retire(0, 0x30, 1, 10);   // CALL 10
+    profiler.retire(10, 0x30, 11, 10); // CALL 10 (recursive)
+    profiler.retire(10, 0x31, 11, 11); // RET
+    profiler.retire(11, 0x31, 12, 1);  // RET
+    auto calls = profiler.calls();
+    EXPECT_EQ(calls[10].calls, 2);
+    EXPECT_EQ(calls[10].inclusive, 3);
+    EXPECT_EQ(calls[10].exclusive, 3);
+}
+
+TEST(Profiler32Test, UnmatchedReturnStaysAtRoot) {
+    Profiler32 profiler;
+    profiler.retire(0, 0x31, 1, 5);
+    profiler.retire(5, 0xFF, 6, 6);
+    std::ostringstream out;
+    profiler.writeCollapsedStacks(out);
+    EXPECT_EQ(out.str(), "root 2\n");
+}
+
+TEST(Profiler32Test, DeepRecursionDoesNotExhaustTheHostStack) {
+    // 0: CALL 0 over and over makes the call tree one level deeper per instruction
+    constexpr uint64_t depth = 200'000;
+    auto profiler = std::make_unique<Profiler32>();
+    for (uint64_t i = 0; i < depth; ++i) {
+        profiler->retire(0, 0x30, 1, 0);
+    }
+    auto calls = profiler->calls();
+    EXPECT_EQ(calls[0].calls, depth);
+    EXPECT_EQ(calls[0].exclusive, depth - 1);
+    EXPECT_EQ(calls[0].inclusive, depth - 1);
+
+    // The output is quadratic in the depth, so only walk it: a stream without a
+    // buffer discards everything written to it
+    std::ostream discard(nullptr);
+    profiler->writeCollapsedStacks(discard);
+
+    profiler->reset();
+    EXPECT_EQ(profiler->instructions(), 0);
+    for (uint64_t i = 0; i < depth; ++i) {
+        profiler->retire(0, 0x30, 1, 0);
+    }
+    profiler.reset();
+}
@@ -26,4 +26,33 @@ TEST_F(Register32Test, LoadValue) {
 TEST_F(Register32Test, LoadMaxValue) {
     reg->loadValue(0xFFFFFFFF);
     EXPECT_EQ(reg->GetState(), 4294967295);
-}
\ No newline at end of file
+}
+
+class CountingObserver : public IObserver {
+public:
+    int updates = 0;
+    uint32_t last = 0;
+
+    void Update(uint32_t state) override {
+        ++updates;
+        last = state;
+    }
+};
+
+TEST_F(Register32Test, ObservedRegisterNotifies) {
+    CountingObserver observer;
+    reg->Attach(&observer);
+    reg->loadValue(7);
+    reg->loadValue(9);
+    EXPECT_EQ(observer.updates, 2);
+    EXPECT_EQ(observer.last, 9);
+}
+
+TEST_F(Register32Test, UnobservedRegisterIsPlainValue) {
+    static_assert(!std::is_polymorphic_v<BasicRegister32<NoObservers>>);
+    static_assert(sizeof(BasicRegister32<NoObservers>) == sizeof(uint32_t));
+
+    BasicRegister32<NoObservers> plain;
+    plain.loadValue(42);
+    EXPECT_EQ(plain.GetState(), 42);
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <CPU32/Devices32.hpp>
+#include <CPU32/Scheduler32.hpp>
+#include <deque>
+#include <sstream>
+
+namespace {
+
+// A bounded FIFO: OUT waits while it is full and IN while it is empty
+class PipeDevice32 : public Device32 {
+public:
+    explicit PipeDevice32(size_t capacity) : capacity(capacity) {}
+
+    uint32_t read(uint32_t) override {
+        uint32_t value = words.front();
+        words.pop_front();
+        return value;
+    }
+    void write(uint32_t, uint32_t value) override { words.push_back(value); }
+    bool ready(uint32_t) override { return !words.empty(); }
+    bool writable(uint32_t) override { return words.size() < capacity; }
+
+private:
+    size_t capacity;
+    std::deque<uint32_t> words;
+};
+
+std::shared_ptr<FastCPU32> guest(const std::vector<uint32_t>& program) {
+    auto cpu = std::make_shared<FastCPU32>(1024);
+    cpu->loadProgram(program, 0);
+    return cpu;
+}
+
+} // namespace
+
+TEST(Scheduler32Test, GuestsTakeTurnsOnOneThread) {
+    std::vector<uint32_t> program = {
+            0x02020000, // 0: MOV R2, 0
+            0x02070001, // 1: MOV R7, 1
+            0x05020100, // 2: ADD R2, R1
+            0x06010700, // 3: SUB R1, R7
+            0x14000002, // 4: JNZ 2
+            0xFF000000  // 5: HLT
+    };
+    Scheduler32 scheduler(50);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        auto cpu = guest(program);
+        cpu->GetRegisters()[1]->loadValue(i % 100 + 1);
+        scheduler.spawn(cpu);
+    }
+    EXPECT_EQ(scheduler.run(), 0);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        uint32_t n = i % 100 + 1;
+        ASSERT_TRUE(scheduler.finished(i));
+        EXPECT_EQ(scheduler.result(i).reason, StopReason32::Halted);
+        EXPECT_EQ(scheduler.result(i).instructions, 3 + 3 * n);
+        EXPECT_EQ(scheduler.cpu(i).GetRegisters()[2]->GetState(), n * (n + 1) / 2);
+    }
+}
+
+TEST(Scheduler32Test, GuestsWaitForInputUntilFed) {
+    std::vector<uint32_t> echo = {
+            0x40010100, // 0: IN R1, 1
+            0x41010100, // 1: OUT R1, 1
+            0x1001000A, // 2: CMP R1, '\n'
+            0x14000000, // 3: JNZ 0
+            0xFF000000  // 4: HLT
+    };
+    std::vector<std::ostringstream> outputs(10); // Outlive the consoles, which flush into them
+    std::vector<std::shared_ptr<ConsoleDevice32>> consoles;
+    Scheduler32 scheduler;
+    for (auto& out : outputs) {
+        auto cpu = guest(echo);
+        consoles.push_back(std::make_shared<ConsoleDevice32>(out));
+        cpu->GetBus()->attachPorts(1, 1, consoles.back());
+        scheduler.spawn(cpu);
+    }
+    EXPECT_EQ(scheduler.run(), 10);
+    for (size_t i = 0; i < 10; i += 2) {
+        consoles[i]->feed("guest " + std::to_string(i) + "\n");
+    }
+    EXPECT_EQ(scheduler.run(), 5);
+    for (size_t i = 0; i < 10; ++i) {
+        EXPECT_EQ(scheduler.finished(i), i % 2 == 0);
+        EXPECT_EQ(outputs[i].str(), i % 2 == 0 ? "guest " + std::to_string(i) + "\n" : "");
+    }
+    EXPECT_EQ(scheduler.result(1).reason, StopReason32::IOWait);
+}
+
+TEST(Scheduler32Test, ProducerAndConsumerShareAPipe) {
+    std::vector<uint32_t> producer = {
+            0x02010064, // 0: MOV R1, 100
+            0x02070001, // 1: MOV R7, 1
+            0x41010200, // 2: OUT R1, 2
+            0x06010700, // 3: SUB R1, R7
+            0x14000002, // 4: JNZ 2
+            0xFF000000  // 5: HLT
+    };
+    std::vector<uint32_t> consumer = {
+            0x02020000, // 0: MOV R2, 0
+            0x02030064, // 1: MOV R3, 100
+            0x02070001, // 2: MOV R7, 1
+            0x40010200, // 3: IN R1, 2
+            0x05020100, // 4: ADD R2, R1
+            0x06030700, // 5: SUB R3, R7
+            0x14000003, // 6: JNZ 3
+            0xFF000000  // 7: HLT
+    };
+    auto pipe = std::make_shared<PipeDevice32>(4);
+    auto writer = guest(producer);
+    auto reader = guest(consumer);
+    writer->GetBus()->attachPorts(2, 1, pipe);
+    reader->GetBus()->attachPorts(2, 1, pipe);
+
+    Scheduler32 scheduler;
+    auto readerId = scheduler.spawn(reader);
+    auto writerId = scheduler.spawn(writer);
+    EXPECT_EQ(scheduler.run(), 0);
+    EXPECT_EQ(scheduler.result(writerId).reason, StopReason32::Halted);
+    EXPECT_EQ(scheduler.result(readerId).reason, StopReason32::Halted);
+    EXPECT_EQ(reader->GetRegisters()[2]->GetState(), 5050);
+}
+
+TEST(Scheduler32Test, GuestBudgetEndsItsRun) {
+    Scheduler32 scheduler(300);
+    auto spinner = scheduler.spawn(guest({0x12000000}), 1000); // JMP 0
+    auto faulty = scheduler.spawn(guest({0x02027000, 0x03030200})); // LOAD past the end of memory
+    EXPECT_EQ(scheduler.run(), 0);
+    EXPECT_TRUE(scheduler.finished(spinner));
+    EXPECT_EQ(scheduler.result(spinner).reason, StopReason32::BudgetExhausted);
+    EXPECT_EQ(scheduler.result(spinner).instructions, 1000);
+    EXPECT_TRUE(scheduler.finished(faulty));
+    EXPECT_EQ(scheduler.result(faulty).reason, StopReason32::Fault);
+    EXPECT_EQ(scheduler.result(faulty).instructions, 1);
+    EXPECT_THROW(Scheduler32(0), std::invalid_argument);
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <CPU32/Vector32.hpp>
+#include <random>
+
+namespace {
+
+Vector32 randomVector(std::mt19937& random) {
+    Vector32 v;
+    for (auto& lane : v.lane) {
+        // Small values too, so the comparisons see equal lanes
+        lane = random() % 2 ? static_cast<uint32_t>(random()) : random() % 4;
+    }
+    return v;
+}
+
+} // namespace
+
+TEST(Vector32Test, LaneOperationsMatchScalar) {
+    std::mt19937 random(7);
+    for (int round = 0; round < 1000; ++round) {
+        Vector32 a = randomVector(random);
+        Vector32 b = randomVector(random);
+        Vector32 add = VectorALU32::apply<VectorALU32::ADD>(a, b);
+        Vector32 sub = VectorALU32::apply<VectorALU32::SUB>(a, b);
+        Vector32 andLanes = VectorALU32::apply<VectorALU32::AND>(a, b);
+        Vector32 orLanes = VectorALU32::apply<VectorALU32::OR>(a, b);
+        Vector32 xorLanes = VectorALU32::apply<VectorALU32::XOR>(a, b);
+        Vector32 equal = VectorALU32::apply<VectorALU32::CMPEQ>(a, b);
+        Vector32 greater = VectorALU32::apply<VectorALU32::CMPGT>(a, b);
+        for (size_t i = 0; i < Vector32::LANES; ++i) {
+            uint32_t x = a.lane[i];
+            uint32_t y = b.lane[i];
+            EXPECT_EQ(add.lane[i], x + y);
+            EXPECT_EQ(sub.lane[i], x - y);
+            EXPECT_EQ(andLanes.lane[i], x & y);
+            EXPECT_EQ(orLanes.lane[i], x | y);
+            EXPECT_EQ(xorLanes.lane[i], x ^ y);
+            EXPECT_EQ(equal.lane[i], x == y ? ~0u : 0u);
+            EXPECT_EQ(greater.lane[i], static_cast<int32_t>(x) > static_cast<int32_t>(y) ? ~0u : 0u);
+        }
+    }
+}
+
+TEST(Vector32Test, ReductionsAndSplat) {
+    Vector32 v{{0xFFFFFFFF, 0, 3, 0x80000000}};
+    EXPECT_EQ(VectorALU32::sum(v), 0x80000002u); // wraps
+    EXPECT_EQ(VectorALU32::nonZeroLanes(v), 0b1101u);
+    EXPECT_EQ(VectorALU32::nonZeroLanes(Vector32{}), 0u);
+    EXPECT_EQ(VectorALU32::splat(9), (Vector32{{9, 9, 9, 9}}));
+}
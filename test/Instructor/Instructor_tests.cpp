@@ -169,6 +169,52 @@ TEST_F(InstructorTest, AssembleStoreImmediate32) {
     }
 }
 
+// Test for the three-register block instructions (BMOV, BFILL, BCMP)
+TEST_F(InstructorTest, AssembleBlockInstructions) {
+    std::string code = R"(
+        BMOV r1, r2, r3
+        BFILL r4, r5, r6
+        BCMP r7, r8, r9
+    )";
+
+    std::vector<uint32_t> expectedInstructions = {
+            0x50010203, 0x51040506, 0x52070809
+    };
+
+    std::vector<uint32_t> actualInstructions = instructor.assemble(code);
+
+    EXPECT_EQ(expectedInstructions.size(), actualInstructions.size());
+    for (size_t i = 0; i < expectedInstructions.size(); ++i) {
+        std::cout << "Expected: " << std::hex << std::setw(8) << std::setfill('0') << expectedInstructions[i]
+                  << ", Actual: " << std::hex << std::setw(8) << std::setfill('0') << actualInstructions[i] << std::endl;
+        EXPECT_EQ(expectedInstructions[i], actualInstructions[i]);
+    }
+    EXPECT_THROW(instructor.assemble("BMOV r1, r2"), std::runtime_error);
+}
+
+// Test for IN/OUT with and without a port number
+TEST_F(InstructorTest, AssembleInOutPorts) {
+    std::string code = R"(
+        IN r1
+        IN r2, 3
+        OUT r4, 0x10
+    )";
+
+    std::vector<uint32_t> expectedInstructions = {
+            0x40010000, 0x40020300, 0x41041000
+    };
+
+    std::vector<uint32_t> actualInstructions = instructor.assemble(code);
+
+    EXPECT_EQ(expectedInstructions.size(), actualInstructions.size());
+    for (size_t i = 0; i < expectedInstructions.size(); ++i) {
+        std::cout << "Expected: " << std::hex << std::setw(8) << std::setfill('0') << expectedInstructions[i]
+                  << ", Actual: " << std::hex << std::setw(8) << std::setfill('0') << actualInstructions[i] << std::endl;
+        EXPECT_EQ(expectedInstructions[i], actualInstructions[i]);
+    }
+    EXPECT_THROW(instructor.assemble("OUT r1, 256"), std::runtime_error);
+}
+
 // Test for handling invalid instructions
 TEST_F(InstructorTest, AssembleInvalidInstruction) {
     std::string code = R"(
@@ -178,4 +224,89 @@ TEST_F(InstructorTest, AssembleInvalidInstruction) {
     EXPECT_THROW({
                      instructor.assemble(code);
                  }, std::runtime_error);
-}
\ No newline at end of file
+}
+
+// Test for the atomic instructions
+TEST_F(InstructorTest, AssembleAtomics) {
+    std::string code = R"(
+        CAS r1, r2, r3
+        XADD r4, r5
+        FENCE
+    )";
+
+    std::vector<uint32_t> expectedInstructions = {
+            0x60010203, 0x61040500, 0x62000000
+    };
+
+    std::vector<uint32_t> actualInstructions = instructor.assemble(code);
+
+    EXPECT_EQ(expectedInstructions.size(), actualInstructions.size());
+    for (size_t i = 0; i < expectedInstructions.size(); ++i) {
+        EXPECT_EQ(expectedInstructions[i], actualInstructions[i]);
+    }
+    EXPECT_THROW(instructor.assemble("CAS r1, r2"), std::runtime_error);
+}
+
+// Test for the interrupt instructions
+TEST_F(InstructorTest, AssembleInterrupts) {
+    std::string code = R"(
+        EI
+        DI
+        IRET
+    )";
+
+    std::vector<uint32_t> expectedInstructions = {
+            0x70000000, 0x71000000, 0x72000000
+    };
+
+    std::vector<uint32_t> actualInstructions = instructor.assemble(code);
+
+    EXPECT_EQ(expectedInstructions.size(), actualInstructions.size());
+    for (size_t i = 0; i < expectedInstructions.size(); ++i) {
+        EXPECT_EQ(expectedInstructions[i], actualInstructions[i]);
+    }
+}
+
+TEST_F(InstructorTest, AssembleMultiplyDivideAndShift) {
+    std::string code = R"(
+        MUL R1, R2
+        MULHS R3, R4
+        SMOD R5, R6
+        ROR R7, R8
+        CLZ R9, R10
+    )";
+
+    std::vector<uint32_t> expectedInstructions = {
+            0x20010200, 0x22030400, 0x26050600, 0x2B070800, 0x2D090A00
+    };
+
+    std::vector<uint32_t> actualInstructions = instructor.assemble(code);
+
+    EXPECT_EQ(expectedInstructions.size(), actualInstructions.size());
+    for (size_t i = 0; i < expectedInstructions.size(); ++i) {
+        EXPECT_EQ(expectedInstructions[i], actualInstructions[i]);
+    }
+}
+
+TEST_F(InstructorTest, AssembleVectorInstructions) {
+    std::string code = R"(
+        VLOAD V1, R2
+        VADD V1, V3
+        VCMPGT V4, V5
+        VSUM R6, V1
+        VSPLAT V7, R8
+        VSTORE V1, R2
+    )";
+
+    std::vector<uint32_t> expectedInstructions = {
+            0x80010200, 0x82010300, 0x88040500, 0x89060100, 0x8A070800, 0x81010200
+    };
+
+    std::vector<uint32_t> actualInstructions = instructor.assemble(code);
+
+    EXPECT_EQ(expectedInstructions.size(), actualInstructions.size());
+    for (size_t i = 0; i < expectedInstructions.size(); ++i) {
+        EXPECT_EQ(expectedInstructions[i], actualInstructions[i]);
+    }
+    EXPECT_THROW(instructor.assemble("VADD V1, R2"), std::runtime_error);
+}